@@ -0,0 +1,149 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+#include "core.hpp"
+#include "../../../vulkan-headers/include/vulkan/vulkan.h"
+
+#include "thread_pool.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+constexpr int32_t tile_size = 64;
+
+// Screen space triangle, as fed to the Rasterizer
+struct Triangle {
+    glm::vec3 v0, v1, v2;
+
+    uint32_t vertices[3]; // Where the varyings of v0, v1 and v2 are in the draw's vertex data
+    uint32_t provoking; // Vertex that flat varyings come from, the first one of the unclipped triangle
+};
+
+// Tiles covering a render area. They are aligned to the framebuffer, not to the render area, so they line up with other per tile data
+class TileGrid {
+    public:
+    TileGrid() = default;
+    TileGrid(const VkRect2D& area): _area{area} {
+        _origin_x = floor_to_tile(area.offset.x);
+        _origin_y = floor_to_tile(area.offset.y);
+        _tiles_x = (area.offset.x + area.extent.width - _origin_x + tile_size - 1) / tile_size;
+        _tiles_y = (area.offset.y + area.extent.height - _origin_y + tile_size - 1) / tile_size;
+    }
+
+    size_t n_tiles() const {
+        return _tiles_x * _tiles_y;
+    }
+
+    // Tile bounds, clipped to the render area
+    VkRect2D tile_rect(size_t tile) const {
+        int32_t x0 = _origin_x + (tile % _tiles_x) * tile_size;
+        int32_t y0 = _origin_y + (tile / _tiles_x) * tile_size;
+
+        int32_t x1 = std::min<int32_t>(x0 + tile_size, _area.offset.x + _area.extent.width);
+        int32_t y1 = std::min<int32_t>(y0 + tile_size, _area.offset.y + _area.extent.height);
+
+        x0 = std::max(x0, _area.offset.x);
+        y0 = std::max(y0, _area.offset.y);
+
+        return VkRect2D{{x0, y0}, {(uint32_t)(x1 - x0), (uint32_t)(y1 - y0)}};
+    }
+
+    // Column and row of the tile containing a screen space coordinate, not clamped to the grid
+    int32_t tile_x(float x) const {
+        return (int32_t)std::floor((x - _origin_x) / tile_size);
+    }
+
+    int32_t tile_y(float y) const {
+        return (int32_t)std::floor((y - _origin_y) / tile_size);
+    }
+
+    size_t tiles_x() const {
+        return _tiles_x;
+    }
+
+    size_t tiles_y() const {
+        return _tiles_y;
+    }
+
+    private:
+    static int32_t floor_to_tile(int32_t coord){
+        return (int32_t)std::floor((float)coord / tile_size) * tile_size;
+    }
+
+    VkRect2D _area{};
+    int32_t _origin_x = 0, _origin_y = 0;
+    size_t _tiles_x = 0, _tiles_y = 0;
+};
+
+// Sorts triangles into fixed size screen tiles, so every tile can be rasterized on its own thread.
+// Triangles are binned in chunks in parallel, walking the chunks in order keeps the submission order within a tile
+class TileBinner {
+    public:
+    static constexpr size_t chunk_size = 1024;
+
+    // Triangles are only binned into the tiles of `grid` that intersect `area`
+    void bin(ThreadPool& pool, const TileGrid& grid, const VkRect2D& area, const std::vector<Triangle>& triangles){
+        _grid = grid;
+
+        int32_t first_x = std::max(0, _grid.tile_x(area.offset.x)), last_x = std::min<int32_t>(_grid.tiles_x() - 1, _grid.tile_x(area.offset.x + area.extent.width - 1));
+        int32_t first_y = std::max(0, _grid.tile_y(area.offset.y)), last_y = std::min<int32_t>(_grid.tiles_y() - 1, _grid.tile_y(area.offset.y + area.extent.height - 1));
+
+        size_t n_chunks = (triangles.size() + chunk_size - 1) / chunk_size;
+        _chunks.resize(n_chunks);
+
+        pool.parallel_for(n_chunks, [&](size_t chunk){
+            auto& bins = _chunks[chunk];
+            bins.resize(n_tiles());
+            for(auto& bin : bins)
+                bin.clear();
+
+            size_t end = std::min(triangles.size(), (chunk + 1) * chunk_size);
+            for(size_t i = chunk * chunk_size; i < end; i++){
+                const auto& tri = triangles[i];
+
+                auto min_x = std::min(tri.v0.x, std::min(tri.v1.x, tri.v2.x));
+                auto max_x = std::max(tri.v0.x, std::max(tri.v1.x, tri.v2.x));
+                auto min_y = std::min(tri.v0.y, std::min(tri.v1.y, tri.v2.y));
+                auto max_y = std::max(tri.v0.y, std::max(tri.v1.y, tri.v2.y));
+
+                auto tile_x0 = std::max(first_x, _grid.tile_x(min_x));
+                auto tile_x1 = std::min(last_x, _grid.tile_x(max_x));
+                auto tile_y0 = std::max(first_y, _grid.tile_y(min_y));
+                auto tile_y1 = std::min(last_y, _grid.tile_y(max_y));
+
+                for(int32_t y = tile_y0; y <= tile_y1; y++)
+                    for(int32_t x = tile_x0; x <= tile_x1; x++)
+                        bins[y * _grid.tiles_x() + x].push_back(i);
+            }
+        });
+    }
+
+    size_t n_tiles() const {
+        return _grid.n_tiles();
+    }
+
+    VkRect2D tile_rect(size_t tile) const {
+        return _grid.tile_rect(tile);
+    }
+
+    bool empty(size_t tile) const {
+        for(const auto& bins : _chunks)
+            if(!bins[tile].empty())
+                return false;
+        return true;
+    }
+
+    // Calls f(triangle_index) for every triangle that touches `tile`, in submission order
+    template<typename F>
+    void for_each(size_t tile, F f) const {
+        for(const auto& bins : _chunks)
+            for(auto i : bins[tile])
+                f(i);
+    }
+
+    private:
+    TileGrid _grid;
+
+    std::vector<std::vector<std::vector<uint32_t>>> _chunks;
+};
\ No newline at end of file
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Blend states that can be evaluated on packed R8G8B8A8_UNORM texels without going through floats
+enum class Unorm8BlendMode {
+    Replace, // Blending disabled, or ONE / ZERO
+    Alpha, // SRC_ALPHA / ONE_MINUS_SRC_ALPHA, alpha ONE / ZERO
+    AlphaOver, // SRC_ALPHA / ONE_MINUS_SRC_ALPHA, alpha ONE / ONE_MINUS_SRC_ALPHA
+    Premultiplied, // ONE / ONE_MINUS_SRC_ALPHA for all channels
+    Additive // ONE / ONE for all channels
+};
+
+// Blends `count` fragment colours in `src` into the texels at `dst`, in place
+using Unorm8BlendFunction = void (*)(const uint32_t* src, uint32_t* dst, uint32_t count);
+
+namespace blend_kernels
+{
+    // Every mode except Replace and Additive is `out = saturate(S + (s * Fs + d * Fd) / 255)` per channel,
+    // with Fs = src alpha, Fd = 255 - src alpha and S = s on the channels that have the bit set below (16 bits per channel, R in the low bits).
+    // s * Fs + d * Fd never exceeds 255 * 255, so the sum fits 16 bits and one rounded division gives the exact UNORM result
+    struct Masks {
+        uint64_t src_factor, dst_factor, src;
+    };
+
+    constexpr uint64_t rgb_lanes = 0x0000'FFFF'FFFF'FFFF;
+    constexpr uint64_t alpha_lanes = 0xFFFF'0000'0000'0000;
+    constexpr uint64_t all_lanes = rgb_lanes | alpha_lanes;
+
+    template<Unorm8BlendMode Mode>
+    constexpr Masks masks(){
+        if constexpr (Mode == Unorm8BlendMode::Alpha) return Masks{rgb_lanes, rgb_lanes, alpha_lanes};
+        else if constexpr (Mode == Unorm8BlendMode::AlphaOver) return Masks{rgb_lanes, all_lanes, alpha_lanes};
+        else if constexpr (Mode == Unorm8BlendMode::Premultiplied) return Masks{0, all_lanes, all_lanes};
+        else return Masks{0, 0, 0};
+    }
+
+    // round(x / 255) for x in [0, 255 * 255]
+    constexpr uint32_t div255(uint32_t x){
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    template<Unorm8BlendMode Mode>
+    inline void scalar(const uint32_t* src, uint32_t* dst, uint32_t count){
+        if constexpr (Mode == Unorm8BlendMode::Replace) {
+            memcpy(dst, src, count * sizeof(uint32_t));
+            return;
+        }
+
+        constexpr auto m = masks<Mode>();
+        auto lane = [](uint64_t mask, int c) -> bool { return (mask >> (16 * c)) & 1; };
+
+        for(uint32_t i = 0; i < count; i++){
+            uint32_t s = src[i], d = dst[i], sa = s >> 24;
+
+            uint32_t out = 0;
+            for(int c = 0; c < 4; c++){
+                uint32_t sc = (s >> (8 * c)) & 0xFF, dc = (d >> (8 * c)) & 0xFF;
+
+                uint32_t r;
+                if constexpr (Mode == Unorm8BlendMode::Additive) {
+                    r = sc + dc;
+                } else {
+                    uint32_t sum = (lane(m.src_factor, c) ? sc * sa : 0) + (lane(m.dst_factor, c) ? dc * (255 - sa) : 0);
+                    r = (lane(m.src, c) ? sc : 0) + div255(sum);
+                }
+
+                out |= std::min<uint32_t>(r, 255) << (8 * c);
+            }
+
+            dst[i] = out;
+        }
+    }
+
+    #if defined(__x86_64__) || defined(__i386__)
+    // 2 texels widened to 16 bits per channel, in each 128-bit lane
+    template<Unorm8BlendMode Mode>
+    __attribute__((target("sse4.1")))
+    inline __m128i blend_wide(__m128i s, __m128i d){
+        constexpr auto m = masks<Mode>();
+        const auto round = _mm_set1_epi16(128);
+        const auto max = _mm_set1_epi16(255);
+
+        auto sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+        auto sum = _mm_mullo_epi16(d, _mm_and_si128(_mm_sub_epi16(max, sa), _mm_set1_epi64x(m.dst_factor)));
+        if constexpr (m.src_factor != 0)
+            sum = _mm_add_epi16(sum, _mm_mullo_epi16(s, _mm_and_si128(sa, _mm_set1_epi64x(m.src_factor))));
+
+        sum = _mm_add_epi16(sum, round);
+        auto q = _mm_srli_epi16(_mm_add_epi16(sum, _mm_srli_epi16(sum, 8)), 8);
+
+        return _mm_add_epi16(q, _mm_and_si128(s, _mm_set1_epi64x(m.src)));
+    }
+
+    template<Unorm8BlendMode Mode>
+    __attribute__((target("sse4.1")))
+    inline void sse41(const uint32_t* src, uint32_t* dst, uint32_t count){
+        const auto zero = _mm_setzero_si128();
+
+        uint32_t i = 0;
+        for(; i + 4 <= count; i += 4){
+            auto s = _mm_loadu_si128((const __m128i*)(src + i));
+            auto d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+            __m128i out;
+            if constexpr (Mode == Unorm8BlendMode::Replace)
+                out = s;
+            else if constexpr (Mode == Unorm8BlendMode::Additive)
+                out = _mm_adds_epu8(s, d);
+            else
+                out = _mm_packus_epi16(blend_wide<Mode>(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero)),
+                                       blend_wide<Mode>(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero)));
+
+            _mm_storeu_si128((__m128i*)(dst + i), out);
+        }
+
+        scalar<Mode>(src + i, dst + i, count - i);
+    }
+
+    template<Unorm8BlendMode Mode>
+    __attribute__((target("avx2")))
+    inline __m256i blend_wide(__m256i s, __m256i d){
+        constexpr auto m = masks<Mode>();
+        const auto round = _mm256_set1_epi16(128);
+        const auto max = _mm256_set1_epi16(255);
+
+        auto sa = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+        auto sum = _mm256_mullo_epi16(d, _mm256_and_si256(_mm256_sub_epi16(max, sa), _mm256_set1_epi64x(m.dst_factor)));
+        if constexpr (m.src_factor != 0)
+            sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(s, _mm256_and_si256(sa, _mm256_set1_epi64x(m.src_factor))));
+
+        sum = _mm256_add_epi16(sum, round);
+        auto q = _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_srli_epi16(sum, 8)), 8);
+
+        return _mm256_add_epi16(q, _mm256_and_si256(s, _mm256_set1_epi64x(m.src)));
+    }
+
+    // Unpacking and packing both work within 128-bit lanes, so the texel order survives the round trip
+    template<Unorm8BlendMode Mode>
+    __attribute__((target("avx2")))
+    inline void avx2(const uint32_t* src, uint32_t* dst, uint32_t count){
+        const auto zero = _mm256_setzero_si256();
+
+        uint32_t i = 0;
+        for(; i + 8 <= count; i += 8){
+            auto s = _mm256_loadu_si256((const __m256i*)(src + i));
+            auto d = _mm256_loadu_si256((const __m256i*)(dst + i));
+
+            __m256i out;
+            if constexpr (Mode == Unorm8BlendMode::Replace)
+                out = s;
+            else if constexpr (Mode == Unorm8BlendMode::Additive)
+                out = _mm256_adds_epu8(s, d);
+            else
+                out = _mm256_packus_epi16(blend_wide<Mode>(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero)),
+                                          blend_wide<Mode>(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero)));
+
+            _mm256_storeu_si256((__m256i*)(dst + i), out);
+        }
+
+        sse41<Mode>(src + i, dst + i, count - i);
+    }
+
+    template<Unorm8BlendMode Mode>
+    __attribute__((target("avx512f,avx512bw")))
+    inline __m512i blend_wide(__m512i s, __m512i d){
+        constexpr auto m = masks<Mode>();
+        const auto round = _mm512_set1_epi16(128);
+        const auto max = _mm512_set1_epi16(255);
+
+        auto sa = _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+        auto sum = _mm512_mullo_epi16(d, _mm512_and_si512(_mm512_sub_epi16(max, sa), _mm512_set1_epi64(m.dst_factor)));
+        if constexpr (m.src_factor != 0)
+            sum = _mm512_add_epi16(sum, _mm512_mullo_epi16(s, _mm512_and_si512(sa, _mm512_set1_epi64(m.src_factor))));
+
+        sum = _mm512_add_epi16(sum, round);
+        auto q = _mm512_srli_epi16(_mm512_add_epi16(sum, _mm512_srli_epi16(sum, 8)), 8);
+
+        return _mm512_add_epi16(q, _mm512_and_si512(s, _mm512_set1_epi64(m.src)));
+    }
+
+    template<Unorm8BlendMode Mode>
+    __attribute__((target("avx512f,avx512bw")))
+    inline void avx512(const uint32_t* src, uint32_t* dst, uint32_t count){
+        const auto zero = _mm512_setzero_si512();
+
+        uint32_t i = 0;
+        for(; i + 16 <= count; i += 16){
+            auto s = _mm512_loadu_si512(src + i);
+            auto d = _mm512_loadu_si512(dst + i);
+
+            __m512i out;
+            if constexpr (Mode == Unorm8BlendMode::Replace)
+                out = s;
+            else if constexpr (Mode == Unorm8BlendMode::Additive)
+                out = _mm512_adds_epu8(s, d);
+            else
+                out = _mm512_packus_epi16(blend_wide<Mode>(_mm512_unpacklo_epi8(s, zero), _mm512_unpacklo_epi8(d, zero)),
+                                          blend_wide<Mode>(_mm512_unpackhi_epi8(s, zero), _mm512_unpackhi_epi8(d, zero)));
+
+            _mm512_storeu_si512(dst + i, out);
+        }
+
+        sse41<Mode>(src + i, dst + i, count - i);
+    }
+    #endif
+
+    template<Unorm8BlendMode Mode>
+    inline Unorm8BlendFunction select(SimdLevel level){
+        switch (level) {
+            #if defined(__x86_64__) || defined(__i386__)
+            case SimdLevel::AVX512:
+                // The 16 bit lane ops need AVX-512BW on top of the foundation set
+                if(__builtin_cpu_supports("avx512bw"))
+                    return avx512<Mode>;
+                [[fallthrough]];
+            case SimdLevel::AVX2: return avx2<Mode>;
+            case SimdLevel::SSE41: return sse41<Mode>;
+            #endif
+            default: return scalar<Mode>;
+        }
+    }
+} // namespace blend_kernels
+
+inline Unorm8BlendFunction select_unorm8_blend(Unorm8BlendMode mode, SimdLevel level = simd_level()){
+    switch (mode) {
+        case Unorm8BlendMode::Replace: return blend_kernels::select<Unorm8BlendMode::Replace>(level);
+        case Unorm8BlendMode::Alpha: return blend_kernels::select<Unorm8BlendMode::Alpha>(level);
+        case Unorm8BlendMode::AlphaOver: return blend_kernels::select<Unorm8BlendMode::AlphaOver>(level);
+        case Unorm8BlendMode::Premultiplied: return blend_kernels::select<Unorm8BlendMode::Premultiplied>(level);
+        case Unorm8BlendMode::Additive: return blend_kernels::select<Unorm8BlendMode::Additive>(level);
+    }
+
+    return nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+#include "core.hpp"
+#include "../../../vulkan-headers/include/vulkan/vulkan.h"
+
+#include <array>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+// Vertex produced by clipping, `weights` are its barycentrics relative to the vertices of the unclipped triangle
+struct ClipVertex {
+    glm::vec4 position;
+    glm::vec3 weights;
+};
+
+// Clip space clipping against Vulkan's view volume -w <= x, y <= w, 0 <= z <= w.
+// The sides are never clipped geometrically: triangles within a guard band far outside of the viewport go to the rasterizer as they are,
+// which only visits pixels in the viewport anyway. Only near/far, w <= 0 and the guard band itself need actual clipping, which is rare
+class Clipper {
+    public:
+    enum Outcode : uint32_t {
+        Left = 1 << 0,
+        Right = 1 << 1,
+        Bottom = 1 << 2,
+        Top = 1 << 3,
+        Near = 1 << 4,
+        Far = 1 << 5,
+
+        W = 1 << 6,
+        GuardLeft = 1 << 7,
+        GuardRight = 1 << 8,
+        GuardBottom = 1 << 9,
+        GuardTop = 1 << 10
+    };
+
+    static constexpr uint32_t view_volume = Left | Right | Bottom | Top | Near | Far;
+    static constexpr uint32_t clip_planes = Near | Far | W | GuardLeft | GuardRight | GuardBottom | GuardTop;
+
+    // Screen space vertices have to stay within the range of the rasterizer's fixed point coordinates, see edge_kernels.hpp.
+    // Half of that is left for the viewport offset
+    static constexpr float guard_band = (1 << (15 - 1));
+    static constexpr float min_w = 1e-6f;
+
+    enum class Result { Reject, Accept, Clip };
+
+    Clipper() = default;
+    Clipper(const VkViewport& viewport) {
+        _guard_x = guard_band / std::max(std::abs(viewport.width) / 2, 1.0f);
+        _guard_y = guard_band / std::max(std::abs(viewport.height) / 2, 1.0f);
+    }
+
+    uint32_t outcode(const glm::vec4& v) const {
+        uint32_t code = 0;
+        if(v.x < -v.w) code |= Left;
+        if(v.x > v.w) code |= Right;
+        if(v.y < -v.w) code |= Bottom;
+        if(v.y > v.w) code |= Top;
+        if(v.z < 0) code |= Near;
+        if(v.z > v.w) code |= Far;
+
+        if(v.w < min_w) code |= W;
+        if(v.x < -_guard_x * v.w) code |= GuardLeft;
+        if(v.x > _guard_x * v.w) code |= GuardRight;
+        if(v.y < -_guard_y * v.w) code |= GuardBottom;
+        if(v.y > _guard_y * v.w) code |= GuardTop;
+
+        return code;
+    }
+
+    static Result classify(uint32_t c0, uint32_t c1, uint32_t c2){
+        // All vertices outside of the same plane
+        if((c0 & c1 & c2 & view_volume) != 0)
+            return Result::Reject;
+
+        if(((c0 | c1 | c2) & clip_planes) == 0)
+            return Result::Accept;
+
+        return Result::Clip;
+    }
+
+    // Clips the triangle against the planes its vertices are outside of, and calls f(a, b, c) for every triangle of the resulting polygon.
+    // The winding of the triangle is kept
+    template<typename F>
+    void clip(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2, uint32_t planes, F f) const {
+        Polygon in{}, out{};
+        in.n = 3;
+        in.v[0] = ClipVertex{v0, glm::vec3{1, 0, 0}};
+        in.v[1] = ClipVertex{v1, glm::vec3{0, 1, 0}};
+        in.v[2] = ClipVertex{v2, glm::vec3{0, 0, 1}};
+
+        for(uint32_t plane = 1; plane <= GuardTop; plane <<= 1){
+            if(!(planes & plane & clip_planes))
+                continue;
+
+            clip_polygon(in, out, plane);
+            std::swap(in, out);
+
+            if(in.n < 3)
+                return;
+        }
+
+        for(size_t i = 1; (i + 1) < in.n; i++)
+            f(in.v[0], in.v[i], in.v[i + 1]);
+    }
+
+    private:
+    struct Polygon {
+        size_t n;
+        std::array<ClipVertex, 3 + 7> v; // Every plane adds at most one vertex
+    };
+
+    float distance(const glm::vec4& v, uint32_t plane) const {
+        switch (plane) {
+            case Near: return v.z;
+            case Far: return v.w - v.z;
+            case W: return v.w - min_w;
+            case GuardLeft: return v.x + _guard_x * v.w;
+            case GuardRight: return _guard_x * v.w - v.x;
+            case GuardBottom: return v.y + _guard_y * v.w;
+            case GuardTop: return _guard_y * v.w - v.y;
+            default: assert(!"Not a clip plane"); return 0;
+        }
+    }
+
+    // Sutherland-Hodgman against a single plane
+    void clip_polygon(const Polygon& in, Polygon& out, uint32_t plane) const {
+        out.n = 0;
+
+        for(size_t i = 0; i < in.n; i++){
+            const auto& a = in.v[i];
+            const auto& b = in.v[(i + 1) % in.n];
+
+            float da = distance(a.position, plane), db = distance(b.position, plane);
+            if(da >= 0)
+                out.v[out.n++] = a;
+
+            if((da >= 0) != (db >= 0)){
+                // Always interpolate from the inside vertex, so an edge shared by two triangles is clipped to the exact same point
+                const auto& inside = (da >= 0) ? a : b;
+                const auto& outside = (da >= 0) ? b : a;
+                float d_in = std::max(da, db), d_out = std::min(da, db);
+
+                float t = d_in / (d_in - d_out);
+                out.v[out.n++] = ClipVertex{inside.position + t * (outside.position - inside.position), inside.weights + t * (outside.weights - inside.weights)};
+            }
+        }
+    }
+
+    float _guard_x = 1, _guard_y = 1;
+};
\ No newline at end of file
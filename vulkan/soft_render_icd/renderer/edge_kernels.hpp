@@ -0,0 +1,161 @@
+#pragma once
+
+#include "simd.hpp"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Vertices are snapped to 16.8 fixed point, edge functions are then exact products of two of those.
+// As long as vertices stay within +-2^15 pixels every edge value fits in 49 bits, which the kernels rely on
+constexpr int32_t subpixel_bits = 8;
+constexpr int64_t subpixel_one = int64_t{1} << subpixel_bits;
+constexpr int64_t subpixel_half = subpixel_one / 2;
+
+// Per triangle constants shared by every call of an edge kernel
+struct EdgeBlockSetup {
+    int64_t lane_offset[3][16]; // lane * (change of the edge value per pixel along x)
+    int64_t bias[3]; // 0 for top-left edges, -1 otherwise, so the sign test implements the fill rule
+    float inv_area;
+};
+
+// Normalized barycentrics per lane, only meaningful for lanes that are set in the returned coverage mask
+struct EdgeBlockResult {
+    alignas(64) float w0[16];
+    alignas(64) float w1[16];
+    alignas(64) float w2[16];
+};
+
+// Takes the three edge values at the first pixel center of a horizontal run of pixels
+using EdgeBlockFunction = uint32_t (*)(const EdgeBlockSetup&, const int64_t*, EdgeBlockResult&);
+
+struct EdgeKernel {
+    EdgeBlockFunction function;
+    int32_t width; // Pixels per call
+};
+
+namespace edge_kernels
+{
+    inline uint32_t scalar(const EdgeBlockSetup& in, const int64_t* e, EdgeBlockResult& out){
+        uint32_t mask = 0;
+        for(int i = 0; i < 4; i++){
+            auto w0 = e[0] + in.lane_offset[0][i];
+            auto w1 = e[1] + in.lane_offset[1][i];
+            auto w2 = e[2] + in.lane_offset[2][i];
+
+            if(((w0 + in.bias[0]) | (w1 + in.bias[1]) | (w2 + in.bias[2])) >= 0)
+                mask |= 1 << i;
+
+            // Goes through double like the vector paths, every edge value is exactly representable there
+            out.w0[i] = (float)(double)w0 * in.inv_area;
+            out.w1[i] = (float)(double)w1 * in.inv_area;
+            out.w2[i] = (float)(double)w2 * in.inv_area;
+        }
+
+        return mask;
+    }
+
+    #if defined(__x86_64__) || defined(__i386__)
+    // int64 -> double without AVX-512DQ, exact for |x| < 2^51
+    constexpr int64_t magic_int = 0x4338000000000000;
+    constexpr double magic_double = 6755399441055744.0;
+
+    __attribute__((target("sse4.1")))
+    inline uint32_t sse41(const EdgeBlockSetup& in, const int64_t* e, EdgeBlockResult& out){
+        const auto magic_i = _mm_set1_epi64x(magic_int);
+        const auto magic_d = _mm_set1_pd(magic_double);
+        const auto inv_area = _mm_set1_ps(in.inv_area);
+
+        auto outside = _mm_setzero_si128();
+        float* results[3] = {out.w0, out.w1, out.w2};
+        for(int k = 0; k < 3; k++){
+            auto base = _mm_set1_epi64x(e[k]);
+            auto bias = _mm_set1_epi64x(in.bias[k]);
+
+            auto lo = _mm_add_epi64(base, _mm_loadu_si128((const __m128i*)&in.lane_offset[k][0]));
+            auto hi = _mm_add_epi64(base, _mm_loadu_si128((const __m128i*)&in.lane_offset[k][2]));
+
+            // Pack the sign of lane 0..3 into one register to test all of them at once
+            auto sign = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(_mm_add_epi64(lo, bias)), _mm_castsi128_ps(_mm_add_epi64(hi, bias)), _MM_SHUFFLE(3, 1, 3, 1)));
+            outside = _mm_or_si128(outside, sign);
+
+            auto lo_f = _mm_cvtpd_ps(_mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(lo, magic_i)), magic_d));
+            auto hi_f = _mm_cvtpd_ps(_mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(hi, magic_i)), magic_d));
+            _mm_store_ps(results[k], _mm_mul_ps(_mm_movelh_ps(lo_f, hi_f), inv_area));
+        }
+
+        return ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF;
+    }
+
+    __attribute__((target("avx2")))
+    inline uint32_t avx2(const EdgeBlockSetup& in, const int64_t* e, EdgeBlockResult& out){
+        const auto magic_i = _mm256_set1_epi64x(magic_int);
+        const auto magic_d = _mm256_set1_pd(magic_double);
+        const auto inv_area = _mm256_set1_ps(in.inv_area);
+
+        auto outside_lo = _mm256_setzero_si256();
+        auto outside_hi = _mm256_setzero_si256();
+        float* results[3] = {out.w0, out.w1, out.w2};
+        for(int k = 0; k < 3; k++){
+            auto base = _mm256_set1_epi64x(e[k]);
+            auto bias = _mm256_set1_epi64x(in.bias[k]);
+
+            auto lo = _mm256_add_epi64(base, _mm256_loadu_si256((const __m256i*)&in.lane_offset[k][0]));
+            auto hi = _mm256_add_epi64(base, _mm256_loadu_si256((const __m256i*)&in.lane_offset[k][4]));
+
+            outside_lo = _mm256_or_si256(outside_lo, _mm256_add_epi64(lo, bias));
+            outside_hi = _mm256_or_si256(outside_hi, _mm256_add_epi64(hi, bias));
+
+            auto lo_f = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(lo, magic_i)), magic_d));
+            auto hi_f = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(hi, magic_i)), magic_d));
+            _mm256_store_ps(results[k], _mm256_mul_ps(_mm256_set_m128(hi_f, lo_f), inv_area));
+        }
+
+        uint32_t outside = _mm256_movemask_pd(_mm256_castsi256_pd(outside_lo)) | (_mm256_movemask_pd(_mm256_castsi256_pd(outside_hi)) << 4);
+        return ~outside & 0xFF;
+    }
+
+    __attribute__((target("avx512f")))
+    inline uint32_t avx512(const EdgeBlockSetup& in, const int64_t* e, EdgeBlockResult& out){
+        const auto magic_i = _mm512_set1_epi64(magic_int);
+        const auto magic_d = _mm512_set1_pd(magic_double);
+        const auto inv_area = _mm512_set1_ps(in.inv_area);
+        const auto zero = _mm512_setzero_si512();
+
+        auto outside_lo = _mm512_setzero_si512();
+        auto outside_hi = _mm512_setzero_si512();
+        float* results[3] = {out.w0, out.w1, out.w2};
+        for(int k = 0; k < 3; k++){
+            auto base = _mm512_set1_epi64(e[k]);
+            auto bias = _mm512_set1_epi64(in.bias[k]);
+
+            auto lo = _mm512_add_epi64(base, _mm512_loadu_si512(&in.lane_offset[k][0]));
+            auto hi = _mm512_add_epi64(base, _mm512_loadu_si512(&in.lane_offset[k][8]));
+
+            outside_lo = _mm512_or_si512(outside_lo, _mm512_add_epi64(lo, bias));
+            outside_hi = _mm512_or_si512(outside_hi, _mm512_add_epi64(hi, bias));
+
+            auto lo_f = _mm512_cvtpd_ps(_mm512_sub_pd(_mm512_castsi512_pd(_mm512_add_epi64(lo, magic_i)), magic_d));
+            auto hi_f = _mm512_cvtpd_ps(_mm512_sub_pd(_mm512_castsi512_pd(_mm512_add_epi64(hi, magic_i)), magic_d));
+            auto w = _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo_f)), _mm256_castps_pd(hi_f), 1));
+            _mm512_store_ps(results[k], _mm512_mul_ps(w, inv_area));
+        }
+
+        uint32_t outside = _mm512_cmplt_epi64_mask(outside_lo, zero) | (_mm512_cmplt_epi64_mask(outside_hi, zero) << 8);
+        return ~outside & 0xFFFF;
+    }
+    #endif
+} // namespace edge_kernels
+
+inline EdgeKernel select_edge_kernel(SimdLevel level = simd_level()){
+    switch (level) {
+        #if defined(__x86_64__) || defined(__i386__)
+        case SimdLevel::AVX512: return EdgeKernel{edge_kernels::avx512, 16};
+        case SimdLevel::AVX2: return EdgeKernel{edge_kernels::avx2, 8};
+        case SimdLevel::SSE41: return EdgeKernel{edge_kernels::sse41, 4};
+        #endif
+        default: return EdgeKernel{edge_kernels::scalar, 4};
+    }
+}
\ No newline at end of file
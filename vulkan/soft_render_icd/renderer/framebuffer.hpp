@@ -7,15 +7,17 @@
 #include <algorithm>
 
 #include "image.hpp"
+#include "render_pass.hpp"
 
 struct Framebuffer {
     Framebuffer(const VkFramebufferCreateInfo& info): _info{info} {
         assert(info.sType == VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO);
         assert((info.flags & VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT) == 0); // TODO: Support Imageless Framebuffers
 
-        // TODO: Renderpass
+        _render_pass = (RenderPass*)info.renderPass; // RenderPass handles are pointers to the RenderPass
+        assert(info.attachmentCount == _render_pass->n_attachments());
 
-        std::copy(info.pAttachments, info.pAttachments + info.attachmentCount, std::back_inserter(_attachments));
+        std::transform(info.pAttachments, info.pAttachments + info.attachmentCount, std::back_inserter(_attachments), [](VkImageView view){ return (ImageView*)view; });
     }
 
     const ImageView& operator[](size_t i) const {
@@ -34,7 +36,17 @@ struct Framebuffer {
         return _attachments.size();
     }
 
+    VkExtent2D extent() const {
+        return VkExtent2D{_info.width, _info.height};
+    }
+
+    // The render pass the framebuffer was created against, other render passes using it have to be compatible
+    const RenderPass& render_pass() const {
+        return *_render_pass;
+    }
+
     private:
     VkFramebufferCreateInfo _info;
+    RenderPass* _render_pass;
     std::vector<ImageView*> _attachments;
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+#include "../../../vulkan-headers/include/vulkan/vulkan.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// Coarse min/max depth kept next to a depth attachment, at 8x8 block and 64x64 tile granularity.
+// Writes only mark a block dirty, its range is recomputed from the depth values the next time it is queried.
+// A tile is only ever touched by the thread that owns it, so none of this needs synchronization
+class HiZBuffer {
+    public:
+    static constexpr int32_t block_size = 8;
+    static constexpr int32_t tile_size = 64;
+
+    struct Range {
+        float min, max;
+    };
+
+    HiZBuffer() = default;
+    HiZBuffer(uint32_t width, uint32_t height, uint32_t samples = 1): _width{width}, _height{height}, _samples{samples} {
+        _blocks_x = (width + block_size - 1) / block_size;
+        _blocks_y = (height + block_size - 1) / block_size;
+        _tiles_x = (width + tile_size - 1) / tile_size;
+        _tiles_y = (height + tile_size - 1) / tile_size;
+
+        _blocks.resize(_blocks_x * _blocks_y);
+        _tiles.resize(_tiles_x * _tiles_y);
+
+        invalidate();
+    }
+
+    // Depth memory changed behind our back, e.g. a copy or clear
+    void invalidate(){
+        for(auto& block : _blocks)
+            block.dirty = true;
+        for(auto& tile : _tiles)
+            tile.dirty = true;
+    }
+
+    void mark_dirty(int32_t x, int32_t y){
+        _blocks[(y / block_size) * _blocks_x + (x / block_size)].dirty = true;
+        _tiles[(y / tile_size) * _tiles_x + (x / tile_size)].dirty = true;
+    }
+
+    // `depth` is a row-linear D32 plane of _width x _height per sample, the range covers all samples
+    Range block_range(int32_t x, int32_t y, const float* depth){
+        auto& block = _blocks[(y / block_size) * _blocks_x + (x / block_size)];
+        if(block.dirty){
+            int32_t x0 = (x / block_size) * block_size, y0 = (y / block_size) * block_size;
+            int32_t x1 = std::min<int32_t>(x0 + block_size, _width), y1 = std::min<int32_t>(y0 + block_size, _height);
+
+            Range range{depth[y0 * _width + x0], depth[y0 * _width + x0]};
+            for(uint32_t s = 0; s < _samples; s++){
+                const auto* plane = depth + (size_t)s * _width * _height;
+                for(int32_t py = y0; py < y1; py++){
+                    for(int32_t px = x0; px < x1; px++){
+                        auto d = plane[py * _width + px];
+                        range.min = std::min(range.min, d);
+                        range.max = std::max(range.max, d);
+                    }
+                }
+            }
+
+            block.range = range;
+            block.dirty = false;
+        }
+
+        return block.range;
+    }
+
+    // Conservatively checks if any fragment with a depth in [min_z, max_z] can pass `Op` against any stored depth in `stored`
+    template<VkCompareOp Op>
+    static bool may_pass(float min_z, float max_z, Range stored){
+        if constexpr (Op == VK_COMPARE_OP_NEVER) return false;
+        else if constexpr (Op == VK_COMPARE_OP_LESS) return min_z < stored.max;
+        else if constexpr (Op == VK_COMPARE_OP_LESS_OR_EQUAL) return min_z <= stored.max;
+        else if constexpr (Op == VK_COMPARE_OP_GREATER) return max_z > stored.min;
+        else if constexpr (Op == VK_COMPARE_OP_GREATER_OR_EQUAL) return max_z >= stored.min;
+        else if constexpr (Op == VK_COMPARE_OP_EQUAL) return min_z <= stored.max && max_z >= stored.min;
+        else return true; // VK_COMPARE_OP_ALWAYS and VK_COMPARE_OP_NOT_EQUAL
+    }
+
+    Range tile_range(int32_t x, int32_t y, const float* depth){
+        auto& tile = _tiles[(y / tile_size) * _tiles_x + (x / tile_size)];
+        if(tile.dirty){
+            int32_t x0 = (x / tile_size) * tile_size, y0 = (y / tile_size) * tile_size;
+            int32_t x1 = std::min<int32_t>(x0 + tile_size, _width), y1 = std::min<int32_t>(y0 + tile_size, _height);
+
+            Range range = block_range(x0, y0, depth);
+            for(int32_t by = y0; by < y1; by += block_size){
+                for(int32_t bx = x0; bx < x1; bx += block_size){
+                    auto block = block_range(bx, by, depth);
+                    range.min = std::min(range.min, block.min);
+                    range.max = std::max(range.max, block.max);
+                }
+            }
+
+            tile.range = range;
+            tile.dirty = false;
+        }
+
+        return tile.range;
+    }
+
+    struct Entry {
+        Range range;
+        bool dirty;
+    };
+
+    uint32_t _width = 0, _height = 0, _samples = 1;
+    uint32_t _blocks_x = 0, _blocks_y = 0, _tiles_x = 0, _tiles_y = 0;
+
+    std::vector<Entry> _blocks, _tiles;
+};
\ No newline at end of file
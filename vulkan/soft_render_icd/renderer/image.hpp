@@ -6,9 +6,14 @@
 #include <array>
 #include <memory>
 #include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
 
 #include "allocations.hpp"
 #include "buffer.hpp"
+#include "multisample.hpp"
+#include "memory_kernels.hpp"
 
 struct Image {
     Image(const VkImageCreateInfo& info): _info{info} {
@@ -17,17 +22,31 @@ struct Image {
         assert(info.flags == 0); // TODO
         assert(info.imageType == VK_IMAGE_TYPE_2D); // TODO
         assert(info.sharingMode == VK_SHARING_MODE_EXCLUSIVE);
-        assert(info.samples == VK_SAMPLE_COUNT_1_BIT);
+        assert(info.samples == VK_SAMPLE_COUNT_1_BIT || info.samples == VK_SAMPLE_COUNT_4_BIT || info.samples == VK_SAMPLE_COUNT_8_BIT); // TODO: 2x and 16x
         
         assert(format_is_supported(info.format));
+        assert(info.tiling == VK_IMAGE_TILING_OPTIMAL || info.samples == VK_SAMPLE_COUNT_1_BIT);
 
-        
+        // Optimal images are padded to whole tiles, so every tile is a contiguous block of memory
+        _tiled = (info.tiling == VK_IMAGE_TILING_OPTIMAL);
+        _stride = _tiled ? (info.extent.width + tile_size - 1) / tile_size * tile_size : info.extent.width;
+        _rows = _tiled ? (info.extent.height + tile_size - 1) / tile_size * tile_size : info.extent.height;
+
+        // Multisampled colour starts out compressed, sample 0 then stands for all samples of a pixel
+        if(info.samples != VK_SAMPLE_COUNT_1_BIT && !format_is_depth(info.format)){
+            _compressed_stride = (info.extent.width + 63) / 64;
+            _compressed.assign(_compressed_stride * info.extent.height, ~uint64_t{0});
+            _resolve = select_resolve(info.samples);
+        }
+
+        _clear_tiles_x = (info.extent.width + tile_size - 1) / tile_size;
+        _clear_tiles.resize(_clear_tiles_x * ((info.extent.height + tile_size - 1) / tile_size));
     }
 
     VkMemoryRequirements get_requirements(){
         VkMemoryRequirements ret{};
-        ret.size = _info.extent.width * _info.extent.height * _info.extent.depth;
-        ret.alignment = 4; // TODO? What should I fill in here
+        ret.size = plane_size() * _info.samples * _info.arrayLayers * format_size(_info.format);
+        ret.alignment = _tiled ? 64 : format_size(_info.format); // Micro tiles are read and written as whole cache lines
         ret.memoryTypeBits = 0;
 
         return ret;
@@ -37,16 +56,425 @@ struct Image {
         _slice = mem->global_slice().subslice(off, get_requirements().size);
     }
 
+    // vkCmdCopyBufferToImage
     void copy_from_buffer(Buffer& buf, const std::vector<VkBufferImageCopy>& regions){
         for(const auto& region : regions){
-            size_t i = ((_info.extent.width * _info.extent.height) * region.imageOffset.z) + (_info.extent.width * region.imageOffset.y) + region.imageOffset.x;
-            size_t size = region.imageExtent.width * region.imageExtent.height * region.imageExtent.depth;
-            
-            memcpy(_slice.addr(i), buf.addr(region.bufferOffset), size);
+            auto rect = copy_rect(region);
+            auto pitch = buffer_pitch(region);
+            bool stream = (size_t)rect.extent.width * rect.extent.height * region.imageSubresource.layerCount * sizeof(uint32_t) > stream_threshold;
+
+            for(uint32_t i = 0; i < region.imageSubresource.layerCount; i++){
+                uint32_t layer = region.imageSubresource.baseArrayLayer + i;
+                if(layer == 0)
+                    prepare_write(rect);
+
+                const auto* src = (const uint8_t*)buf.addr(region.bufferOffset + i * pitch.layer);
+                for(uint32_t row = 0; row < rect.extent.height;){
+                    int32_t y = rect.offset.y + row;
+
+                    // Whole micro tiles are gathered from 4 rows at once and written as cache lines
+                    if(_tiled && (y % micro_tile_size) == 0 && (row + micro_tile_size) <= rect.extent.height){
+                        copy_micro_tile_rows_in(src + row * pitch.row, pitch.row, rect.offset.x, y, rect.extent.width, layer, stream);
+                        row += micro_tile_size;
+                        continue;
+                    }
+
+                    if(!_tiled && stream)
+                        stream_copy((uint32_t*)addr(rect.offset.x, y, layer), src + row * pitch.row, rect.extent.width);
+                    else
+                        write_row(rect.offset.x, y, 0, (const uint32_t*)(src + row * pitch.row), rect.extent.width, layer);
+                    row++;
+                }
+            }
+
+            if(stream)
+                stream_fence();
+        }
+    }
+
+    // vkCmdCopyImageToBuffer
+    void copy_to_buffer(Buffer& buf, const std::vector<VkBufferImageCopy>& regions){
+        for(const auto& region : regions){
+            auto rect = copy_rect(region);
+            auto pitch = buffer_pitch(region);
+            bool stream = (size_t)rect.extent.width * rect.extent.height * region.imageSubresource.layerCount * sizeof(uint32_t) > stream_threshold;
+
+            for(uint32_t i = 0; i < region.imageSubresource.layerCount; i++){
+                uint32_t layer = region.imageSubresource.baseArrayLayer + i;
+                if(layer == 0)
+                    prepare_read(rect);
+
+                auto* dst = (uint8_t*)buf.addr(region.bufferOffset + i * pitch.layer);
+                for(uint32_t row = 0; row < rect.extent.height;){
+                    int32_t y = rect.offset.y + row;
+
+                    if(_tiled && (y % micro_tile_size) == 0 && (row + micro_tile_size) <= rect.extent.height){
+                        copy_micro_tile_rows_out(dst + row * pitch.row, pitch.row, rect.offset.x, y, rect.extent.width, layer);
+                        row += micro_tile_size;
+                        continue;
+                    }
+
+                    // Buffer rows are only aligned to the texel size, which non-temporal stores can still deal with
+                    if(!_tiled && stream)
+                        stream_copy((uint32_t*)(dst + row * pitch.row), addr(rect.offset.x, y, layer), rect.extent.width);
+                    else
+                        read_row(rect.offset.x, y, 0, (uint32_t*)(dst + row * pitch.row), rect.extent.width, layer);
+                    row++;
+                }
+            }
+
+            if(stream)
+                stream_fence();
+        }
+    }
+
+    // Samples are stored as planes, sample s of every texel is s planes after sample 0, array layers come after all samples of the layer before.
+    // VK_IMAGE_TILING_LINEAR planes are row-linear. VK_IMAGE_TILING_OPTIMAL planes are made of tile_size x tile_size tiles in row order,
+    // within a tile 4x4 micro tiles of one cache line each are in Morton order. A tile is then a single block, and a quad or a bilinear footprint
+    // is almost always within a single cache line
+    void* addr(int32_t x, int32_t y, uint32_t layer = 0, uint32_t sample = 0){
+        assert(layer < _info.arrayLayers);
+        return _slice.addr((plane_size() * (layer * _info.samples + sample) + texel_index(x, y)) * format_size(_info.format));
+    }
+
+    // Texels per sample plane, including the padding of optimal images
+    size_t plane_size() const {
+        return (size_t)_stride * _rows;
+    }
+
+    bool tiled() const {
+        return _tiled;
+    }
+
+    // Copies `count` texels of row `y` starting at `x` out of the image, or into it. Takes care of the layout
+    void read_row(int32_t x, int32_t y, uint32_t sample, uint32_t* texels, uint32_t count, uint32_t layer = 0){
+        for_each_span(x, y, layer, sample, count, [&](uint32_t* memory, uint32_t i, uint32_t n){
+            memcpy(texels + i, memory, n * sizeof(uint32_t));
+        });
+    }
+
+    void write_row(int32_t x, int32_t y, uint32_t sample, const uint32_t* texels, uint32_t count, uint32_t layer = 0){
+        for_each_span(x, y, layer, sample, count, [&](uint32_t* memory, uint32_t i, uint32_t n){
+            memcpy(memory, texels + i, n * sizeof(uint32_t));
+        });
+    }
+
+    uint32_t samples() const {
+        return _info.samples;
+    }
+
+    // A compressed pixel of a multisampled colour image has all samples equal, only sample 0 is stored.
+    // Bits are kept per row in 64 pixel words, a word is within a single 64x64 tile so tile threads never share one
+    bool compressed(int32_t x, int32_t y) const {
+        return (_compressed[y * _compressed_stride + x / 64] >> (x % 64)) & 1;
+    }
+
+    void set_compressed(int32_t x, int32_t y){
+        _compressed[y * _compressed_stride + x / 64] |= uint64_t{1} << (x % 64);
+    }
+
+    // The word of 64 compression bits starting at `x`, a multiple of 64. Always 0 for images that are never compressed
+    uint64_t compressed_bits(int32_t x, int32_t y) const {
+        return _compressed.empty() ? 0 : _compressed[y * _compressed_stride + x / 64];
+    }
+
+    // Replaces the bits of `mask` within the word starting at `x`
+    void set_compressed_bits(int32_t x, int32_t y, uint64_t bits, uint64_t mask){
+        auto& word = _compressed[y * _compressed_stride + x / 64];
+        word = (word & ~mask) | (bits & mask);
+    }
+
+    // Copies sample 0 to the others, so the samples of the pixel can be written individually
+    void decompress(int32_t x, int32_t y){
+        if(!compressed(x, y))
+            return;
+
+        auto texel = *(const uint32_t*)addr(x, y);
+        for(uint32_t s = 1; s < _info.samples; s++)
+            *(uint32_t*)addr(x, y, 0, s) = texel;
+
+        _compressed[y * _compressed_stride + x / 64] &= ~(uint64_t{1} << (x % 64));
+    }
+
+    // vkCmdResolveImage, compressed pixels are copied and only the others are averaged
+    void resolve(Image& dst, const VkImageResolve& region){
+        assert(_info.samples != VK_SAMPLE_COUNT_1_BIT && dst._info.samples == VK_SAMPLE_COUNT_1_BIT);
+        assert(_info.format == VK_FORMAT_R8G8B8A8_UNORM && dst._info.format == _info.format);
+        assert(region.srcSubresource.layerCount == 1 && region.srcSubresource.baseArrayLayer == 0); // TODO: Layered images
+        assert(region.dstSubresource.layerCount == 1 && region.dstSubresource.baseArrayLayer == 0);
+
+        prepare_read(VkRect2D{{region.srcOffset.x, region.srcOffset.y}, {region.extent.width, region.extent.height}});
+        dst.prepare_write(VkRect2D{{region.dstOffset.x, region.dstOffset.y}, {region.extent.width, region.extent.height}});
+
+        // Rows go through linear scratch, both images may be tiled
+        uint32_t width = region.extent.width;
+        std::vector<uint32_t> src(width * _info.samples), out(width);
+
+        for(uint32_t row = 0; row < region.extent.height; row++){
+            int32_t sx = region.srcOffset.x, sy = region.srcOffset.y + row;
+            int32_t dx = region.dstOffset.x, dy = region.dstOffset.y + row;
+
+            for(uint32_t s = 0; s < _info.samples; s++)
+                read_row(sx, sy, s, &src[s * width], width);
+
+            for(uint32_t x = 0; x < width;){
+                bool run_compressed = compressed(sx + x, sy);
+                uint32_t end = x + 1;
+                while(end < width && compressed(sx + end, sy) == run_compressed)
+                    end++;
+
+                if(run_compressed)
+                    memcpy(&out[x], &src[x], (end - x) * sizeof(uint32_t));
+                else
+                    _resolve(&src[x], width, &out[x], end - x);
+
+                x = end;
+            }
+
+            dst.write_row(dx, dy, 0, out.data(), width);
         }
     }
 
+    // vkCmdClearColorImage and vkCmdClearDepthStencilImage. Nothing is written, the tiles are only marked as cleared to the value
+    // and filled once something actually needs their memory, see prepare_read() and prepare_write()
+    void clear(const VkClearColorValue& colour, const VkImageSubresourceRange& range){
+        assert(!format_is_depth(_info.format) && range.aspectMask == VK_IMAGE_ASPECT_COLOR_BIT);
+
+        VkClearValue value{};
+        value.color = colour;
+        clear(value, range);
+    }
+
+    void clear(const VkClearDepthStencilValue& depth_stencil, const VkImageSubresourceRange& range){
+        assert(format_is_depth(_info.format) && range.aspectMask == VK_IMAGE_ASPECT_DEPTH_BIT); // TODO: Stencil
+
+        VkClearValue value{};
+        value.depthStencil = depth_stencil;
+        clear(value, range);
+    }
+
+    // Whether the clear tile containing (x, y) is cleared, and to which texel
+    bool cleared(int32_t x, int32_t y, uint32_t& texel) const {
+        const auto& tile = _clear_tiles[(y / tile_size) * _clear_tiles_x + (x / tile_size)];
+        texel = tile.texel;
+        return tile.cleared;
+    }
+
+    // Marks the clear tile containing (x, y) as cleared to `texel`, whatever is in its memory is dropped.
+    // For callers that know the whole tile holds a single value, like a render pass storing a tile that was cleared and never drawn to
+    void set_cleared(int32_t x, int32_t y, uint32_t texel){
+        _clear_tiles[(y / tile_size) * _clear_tiles_x + (x / tile_size)] = ClearTile{texel, true};
+    }
+
+    // Bounds of the clear tile containing (x, y), within the image
+    VkRect2D clear_tile_rect(int32_t x, int32_t y) const {
+        int32_t x0 = (x / tile_size) * tile_size, y0 = (y / tile_size) * tile_size;
+        int32_t x1 = std::min<int32_t>(x0 + tile_size, _info.extent.width), y1 = std::min<int32_t>(y0 + tile_size, _info.extent.height);
+
+        return VkRect2D{{x0, y0}, {(uint32_t)(x1 - x0), (uint32_t)(y1 - y0)}};
+    }
+
+    // Has to be called before reading the texels of `region` from memory, fills the cleared tiles it overlaps
+    void prepare_read(const VkRect2D& region){
+        for_each_clear_tile(region, [&](ClearTile& tile, const VkRect2D& rect){
+            fill(tile.texel, rect);
+            tile.cleared = false;
+        });
+    }
+
+    // Has to be called before writing the texels of `region` to memory. Cleared tiles that are entirely overwritten are never filled
+    void prepare_write(const VkRect2D& region){
+        for_each_clear_tile(region, [&](ClearTile& tile, const VkRect2D& rect){
+            bool covered = region.offset.x <= rect.offset.x && region.offset.y <= rect.offset.y &&
+                           (region.offset.x + region.extent.width) >= (rect.offset.x + rect.extent.width) &&
+                           (region.offset.y + region.extent.height) >= (rect.offset.y + rect.extent.height);
+            if(!covered)
+                fill(tile.texel, rect);
+            tile.cleared = false;
+        });
+    }
+
+    // A VkClearValue as a texel of `format`
+    static uint32_t clear_texel(VkFormat format, const VkClearValue& value){
+        if(format_is_depth(format)){
+            uint32_t texel;
+            memcpy(&texel, &value.depthStencil.depth, sizeof(texel));
+            return texel;
+        }
+
+        uint32_t texel = 0;
+        for(int c = 0; c < 4; c++)
+            texel |= (uint32_t)std::lround(std::clamp(value.color.float32[c], 0.0f, 1.0f) * 255.0f) << (8 * c);
+        return texel;
+    }
+
+    const VkExtent3D& extent() const {
+        return _info.extent;
+    }
+
+    VkFormat format() const {
+        return _info.format;
+    }
+
+    static size_t format_size(VkFormat format){
+        switch (format) {
+            case VK_FORMAT_R8G8B8A8_UNORM: return 4;
+            case VK_FORMAT_D32_SFLOAT: return 4;
+            default: assert(!"Unknown format size"); return 0;
+        }
+    }
+
+    static bool format_is_depth(VkFormat format){
+        return format == VK_FORMAT_D32_SFLOAT;
+    }
+
+    static constexpr int32_t tile_size = 64; // Tiles of optimal images, and the granularity of clears
+    static constexpr int32_t micro_tile_size = 4;
+
     private:
+    // Index of texel (x, y) within a sample plane
+    size_t texel_index(int32_t x, int32_t y) const {
+        if(!_tiled)
+            return (size_t)_stride * y + x;
+
+        size_t tile = (size_t)(y / tile_size) * (_stride / tile_size) + (x / tile_size);
+        return tile * (tile_size * tile_size) + tile_offset(x % tile_size, y % tile_size);
+    }
+
+    // Position of (x, y) within a tile of an optimal image: 4x4 micro tiles in Morton order, row-linear within a micro tile
+    static uint32_t tile_offset(uint32_t x, uint32_t y){
+        static_assert(tile_size == 64 && micro_tile_size == 4, "Morton order is spread for 16x16 micro tiles");
+
+        auto spread = [](uint32_t v) -> uint32_t {
+            v = (v | (v << 2)) & 0x33;
+            v = (v | (v << 1)) & 0x55;
+            return v;
+        };
+
+        uint32_t micro = spread(x / micro_tile_size) | (spread(y / micro_tile_size) << 1);
+        return micro * (micro_tile_size * micro_tile_size) + (y % micro_tile_size) * micro_tile_size + (x % micro_tile_size);
+    }
+
+    // Calls f(memory, i, n) for the runs of texels of row `y` from `x` on that are contiguous in memory, `i` is the position of the run within the row
+    template<typename F>
+    void for_each_span(int32_t x, int32_t y, uint32_t layer, uint32_t sample, uint32_t count, F f){
+        if(!_tiled){
+            f((uint32_t*)addr(x, y, layer, sample), 0, count);
+            return;
+        }
+
+        for(uint32_t i = 0; i < count;){
+            uint32_t n = std::min<uint32_t>(count - i, micro_tile_size - (x + i) % micro_tile_size);
+            f((uint32_t*)addr(x + i, y, layer, sample), i, n);
+            i += n;
+        }
+    }
+
+    // Copies `width` texels of the micro tile rows [y, y + micro_tile_size) from or to buffer rows `pitch` bytes apart.
+    // The whole micro tiles in between go as blocks, the partial ones at the ends row by row
+    void copy_micro_tile_rows_in(const uint8_t* src, size_t pitch, int32_t x, int32_t y, uint32_t width, uint32_t layer, bool stream){
+        int32_t end = x + width;
+        int32_t first = std::min(end, (x + micro_tile_size - 1) / micro_tile_size * micro_tile_size);
+        int32_t last = std::max(first, end / micro_tile_size * micro_tile_size);
+
+        for(int32_t row = 0; row < micro_tile_size; row++){
+            write_row(x, y + row, 0, (const uint32_t*)(src + row * pitch), first - x, layer);
+            write_row(last, y + row, 0, (const uint32_t*)(src + row * pitch + (last - x) * sizeof(uint32_t)), end - last, layer);
+        }
+
+        for(int32_t block = first; block < last; block += micro_tile_size)
+            copy_rows_to_block((uint32_t*)addr(block, y, layer), src + (block - x) * sizeof(uint32_t), pitch, stream);
+    }
+
+    void copy_micro_tile_rows_out(uint8_t* dst, size_t pitch, int32_t x, int32_t y, uint32_t width, uint32_t layer){
+        int32_t end = x + width;
+        int32_t first = std::min(end, (x + micro_tile_size - 1) / micro_tile_size * micro_tile_size);
+        int32_t last = std::max(first, end / micro_tile_size * micro_tile_size);
+
+        for(int32_t row = 0; row < micro_tile_size; row++){
+            read_row(x, y + row, 0, (uint32_t*)(dst + row * pitch), first - x, layer);
+            read_row(last, y + row, 0, (uint32_t*)(dst + row * pitch + (last - x) * sizeof(uint32_t)), end - last, layer);
+        }
+
+        for(int32_t block = first; block < last; block += micro_tile_size)
+            copy_block_to_rows(dst + (block - x) * sizeof(uint32_t), pitch, (const uint32_t*)addr(block, y, layer));
+    }
+
+    // The texels of a buffer image copy, only 2D images so far
+    VkRect2D copy_rect(const VkBufferImageCopy& region) const {
+        assert(region.imageOffset.z == 0 && region.imageExtent.depth == 1); // TODO: 3D images
+        assert(region.imageSubresource.mipLevel == 0); // TODO: Mipmaps
+        assert(region.imageSubresource.baseArrayLayer + region.imageSubresource.layerCount <= _info.arrayLayers);
+        assert(_info.samples == VK_SAMPLE_COUNT_1_BIT);
+
+        return VkRect2D{{region.imageOffset.x, region.imageOffset.y}, {region.imageExtent.width, region.imageExtent.height}};
+    }
+
+    struct BufferPitch {
+        size_t row, layer; // In bytes
+    };
+
+    // bufferRowLength and bufferImageHeight are in texels, 0 means tightly packed
+    BufferPitch buffer_pitch(const VkBufferImageCopy& region) const {
+        size_t row_length = region.bufferRowLength ? region.bufferRowLength : region.imageExtent.width;
+        size_t image_height = region.bufferImageHeight ? region.bufferImageHeight : region.imageExtent.height;
+
+        size_t row = row_length * format_size(_info.format);
+        return BufferPitch{row, row * image_height};
+    }
+
+    struct ClearTile {
+        uint32_t texel;
+        bool cleared = false;
+    };
+
+    void clear(const VkClearValue& value, const VkImageSubresourceRange& range){
+        assert(range.baseMipLevel == 0 && (range.levelCount == 1 || range.levelCount == VK_REMAINING_MIP_LEVELS)); // TODO: Mipmaps
+        assert(range.baseArrayLayer == 0 && (range.layerCount == 1 || (range.layerCount == VK_REMAINING_ARRAY_LAYERS && _info.arrayLayers == 1))); // TODO: Layered images
+
+        auto texel = clear_texel(_info.format, value);
+        for(auto& tile : _clear_tiles)
+            tile = ClearTile{texel, true};
+    }
+
+    // Calls f(tile, rect) for every cleared tile overlapping `region`
+    template<typename F>
+    void for_each_clear_tile(const VkRect2D& region, F f){
+        if(region.extent.width == 0 || region.extent.height == 0)
+            return;
+
+        int32_t x1 = region.offset.x + region.extent.width - 1, y1 = region.offset.y + region.extent.height - 1;
+        for(int32_t ty = region.offset.y / tile_size; ty <= y1 / tile_size; ty++){
+            for(int32_t tx = region.offset.x / tile_size; tx <= x1 / tile_size; tx++){
+                auto& tile = _clear_tiles[ty * _clear_tiles_x + tx];
+                if(tile.cleared)
+                    f(tile, clear_tile_rect(tx * tile_size, ty * tile_size));
+            }
+        }
+    }
+
+    // Streams `texel` into the clear tile `rect`. Multisampled colour only needs sample 0, the pixels become compressed
+    void fill(uint32_t texel, const VkRect2D& rect){
+        bool compressible = !_compressed.empty();
+        uint32_t planes = compressible ? 1 : _info.samples;
+
+        // A tile of an optimal image is one block, padding included
+        if(_tiled)
+            for(uint32_t s = 0; s < planes; s++)
+                stream_fill((uint32_t*)addr(rect.offset.x, rect.offset.y, 0, s), texel, tile_size * tile_size);
+
+        for(uint32_t row = 0; row < rect.extent.height; row++){
+            int32_t y = rect.offset.y + row;
+            if(!_tiled)
+                for(uint32_t s = 0; s < planes; s++)
+                    stream_fill((uint32_t*)addr(rect.offset.x, y, 0, s), texel, rect.extent.width);
+
+            // A clear tile is within a single word of compression bits
+            if(compressible)
+                set_compressed_bits(rect.offset.x, y, ~uint64_t{0}, ((rect.extent.width == 64) ? ~uint64_t{0} : (uint64_t{1} << rect.extent.width) - 1) << (rect.offset.x % 64));
+        }
+    }
+
     static bool format_is_supported(VkFormat format){
         for(const auto check : _supported_formats)
             if(format == check)
@@ -58,8 +486,19 @@ struct Image {
     VkImageCreateInfo _info;
     MemorySlice _slice;
 
-    static constexpr std::array<VkFormat, 1> _supported_formats = {
-        VK_FORMAT_R8G8B8A8_UNORM
+    bool _tiled;
+    uint32_t _stride, _rows; // Of a sample plane in texels
+
+    std::vector<uint64_t> _compressed; // Bit per pixel, multisampled colour only
+    size_t _compressed_stride = 0;
+    ResolveFunction _resolve = nullptr;
+
+    std::vector<ClearTile> _clear_tiles; // Per tile_size x tile_size tile
+    size_t _clear_tiles_x = 0;
+
+    static constexpr std::array<VkFormat, 2> _supported_formats = {
+        VK_FORMAT_R8G8B8A8_UNORM,
+        VK_FORMAT_D32_SFLOAT
     };
 };
 
@@ -69,7 +508,16 @@ struct ImageView {
 
         assert(info.viewType == VK_IMAGE_VIEW_TYPE_2D); // TODO
 
-        _image = nullptr; // TODO: Retrieve in some kind of way `info.image`
+        // Attachments are loaded, stored and cleared as layer 0 and the clear tiles are per image, like in Image::clear()
+        const auto& range = info.subresourceRange;
+        assert(range.baseMipLevel == 0 && (range.levelCount == 1 || range.levelCount == VK_REMAINING_MIP_LEVELS)); // TODO: Mipmaps
+        assert(range.baseArrayLayer == 0 && range.layerCount == 1); // TODO: Views of other layers
+
+        _image = (Image*)info.image; // Image handles are pointers to the Image
+    }
+
+    Image& image(){
+        return *_image;
     }
 
     private:
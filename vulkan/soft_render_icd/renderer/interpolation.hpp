@@ -0,0 +1,99 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+#include "core.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+constexpr size_t max_varyings = 16; // vec4 outputs of the vertex shader, inputs of the fragment shader
+
+// SPIR-V decorations of a fragment input, Smooth is the default
+enum class Interpolation { Smooth, NoPerspective, Flat };
+
+// A value that is affine in screen space: f(x, y) = f0 + dx * (x - x0) + dy * (y - y0).
+// Relative to the triangle's first vertex (x0, y0), so large screen coordinates don't eat its precision
+struct Plane {
+    float f0, dx, dy;
+
+    float at(float rx, float ry) const {
+        return f0 + dx * rx + dy * ry;
+    }
+};
+
+// Turns per vertex varyings into fragment inputs. Gradients are set up once per triangle, a pixel then only costs a few multiply-adds per component,
+// plus a single reciprocal shared by all perspective correct inputs. Flat inputs are copied once per triangle
+class Interpolator {
+    public:
+    Interpolator() = default;
+    Interpolator(const std::vector<Interpolation>& modes): _n_varyings{modes.size()} {
+        assert(modes.size() <= max_varyings);
+
+        for(uint32_t i = 0; i < modes.size(); i++){
+            switch (modes[i]) {
+                case Interpolation::Smooth: _smooth.push_back(i); break;
+                case Interpolation::NoPerspective: _linear.push_back(i); break;
+                case Interpolation::Flat: _flat.push_back(i); break;
+            }
+        }
+    }
+
+    size_t n_varyings() const {
+        return _n_varyings;
+    }
+
+    // 1/w, then 4 planes per smooth (a/w) and noperspective (a) varying
+    size_t planes_per_triangle() const {
+        return 1 + 4 * (_smooth.size() + _linear.size());
+    }
+
+    // `p` are the screen space positions and `w` the clip space w of the vertices, `v[i]` points to the varyings of vertex i
+    void setup(const glm::vec3 (&p)[3], const float (&w)[3], const glm::vec4* (&v)[3], Plane* planes) const {
+        double x1 = p[1].x - p[0].x, y1 = p[1].y - p[0].y;
+        double x2 = p[2].x - p[0].x, y2 = p[2].y - p[0].y;
+        double det = x1 * y2 - x2 * y1;
+        double inv_det = (det != 0) ? 1 / det : 0;
+
+        auto plane = [&](double f0, double f1, double f2) -> Plane {
+            double d1 = f1 - f0, d2 = f2 - f0;
+            return Plane{(float)f0, (float)((d1 * y2 - d2 * y1) * inv_det), (float)((d2 * x1 - d1 * x2) * inv_det)};
+        };
+
+        double inv_w[3] = {1.0 / w[0], 1.0 / w[1], 1.0 / w[2]};
+
+        *planes++ = plane(inv_w[0], inv_w[1], inv_w[2]);
+        for(auto i : _smooth)
+            for(int c = 0; c < 4; c++)
+                *planes++ = plane(v[0][i][c] * inv_w[0], v[1][i][c] * inv_w[1], v[2][i][c] * inv_w[2]);
+
+        for(auto i : _linear)
+            for(int c = 0; c < 4; c++)
+                *planes++ = plane(v[0][i][c], v[1][i][c], v[2][i][c]);
+    }
+
+    // `provoking` points to the varyings of the vertex that flat inputs come from
+    void begin(const glm::vec4* provoking, glm::vec4* inputs) const {
+        for(auto i : _flat)
+            inputs[i] = provoking[i];
+    }
+
+    // (rx, ry) is the sample position relative to the triangle's first vertex
+    void interpolate(const Plane* planes, float rx, float ry, glm::vec4* inputs) const {
+        float w = 1 / (planes++)->at(rx, ry);
+
+        for(auto i : _smooth){
+            for(int c = 0; c < 4; c++)
+                inputs[i][c] = (planes++)->at(rx, ry) * w;
+        }
+
+        for(auto i : _linear){
+            for(int c = 0; c < 4; c++)
+                inputs[i][c] = (planes++)->at(rx, ry);
+        }
+    }
+
+    private:
+    size_t _n_varyings = 0;
+    std::vector<uint32_t> _smooth, _linear, _flat;
+};
\ No newline at end of file
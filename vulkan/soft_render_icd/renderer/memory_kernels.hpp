@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Copies larger than this go around the cache, they would evict all of L2 and are not read back soon anyway
+constexpr size_t stream_threshold = 256 * 1024;
+
+// Makes streamed stores visible before anything else reads them
+inline void stream_fence(){
+    #if defined(__x86_64__)
+    _mm_sfence();
+    #endif
+}
+
+// Fills `count` texels with `texel`, bypassing the cache. For memory that is written once and not read again soon,
+// like an image that is materialized from a clear: Filling a 4K target through the cache would evict everything else for nothing
+inline void stream_fill(uint32_t* dst, uint32_t texel, size_t count){
+    #if defined(__x86_64__)
+    // Non-temporal stores need 16 byte alignment, the ends are filled normally
+    size_t head = std::min(count, ((16 - ((uintptr_t)dst & 15)) & 15) / sizeof(uint32_t));
+    std::fill(dst, dst + head, texel);
+    dst += head;
+    count -= head;
+
+    auto value = _mm_set1_epi32(texel);
+    size_t i = 0;
+    for(; (i + 4) <= count; i += 4)
+        _mm_stream_si128((__m128i*)(dst + i), value);
+
+    std::fill(dst + i, dst + count, texel);
+
+    stream_fence();
+    #else
+    std::fill(dst, dst + count, texel);
+    #endif
+}
+
+// Copies `count` texels from `src` to `dst` with non-temporal stores, `src` needs no alignment. Followed by stream_fence() at the end of the copy
+inline void stream_copy(uint32_t* dst, const void* src, size_t count){
+    #if defined(__x86_64__)
+    const auto* in = (const uint8_t*)src;
+
+    size_t head = std::min(count, ((16 - ((uintptr_t)dst & 15)) & 15) / sizeof(uint32_t));
+    memcpy(dst, in, head * sizeof(uint32_t));
+
+    size_t i = head;
+    for(; (i + 16) <= count; i += 16){
+        auto a = _mm_loadu_si128((const __m128i*)(in + i * 4));
+        auto b = _mm_loadu_si128((const __m128i*)(in + i * 4 + 16));
+        auto c = _mm_loadu_si128((const __m128i*)(in + i * 4 + 32));
+        auto d = _mm_loadu_si128((const __m128i*)(in + i * 4 + 48));
+        _mm_stream_si128((__m128i*)(dst + i), a);
+        _mm_stream_si128((__m128i*)(dst + i + 4), b);
+        _mm_stream_si128((__m128i*)(dst + i + 8), c);
+        _mm_stream_si128((__m128i*)(dst + i + 12), d);
+    }
+    for(; (i + 4) <= count; i += 4)
+        _mm_stream_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(in + i * 4)));
+
+    memcpy(dst + i, in + i * 4, (count - i) * sizeof(uint32_t));
+    #else
+    memcpy(dst, src, count * sizeof(uint32_t));
+    #endif
+}
+
+// Gathers a 4x4 block of texels from rows `pitch` bytes apart into 16 consecutive texels, a micro tile of an optimal image.
+// A micro tile is a whole cache line, so with `stream` it is written without ever being read
+inline void copy_rows_to_block(uint32_t* dst, const void* src, size_t pitch, bool stream){
+    const auto* in = (const uint8_t*)src;
+
+    #if defined(__x86_64__)
+    if(stream && ((uintptr_t)dst & 15) == 0){
+        for(int row = 0; row < 4; row++)
+            _mm_stream_si128((__m128i*)(dst + row * 4), _mm_loadu_si128((const __m128i*)(in + row * pitch)));
+        return;
+    }
+    #endif
+
+    for(int row = 0; row < 4; row++)
+        memcpy(dst + row * 4, in + row * pitch, 4 * sizeof(uint32_t));
+}
+
+// The other way around, scatters a micro tile to 4 rows `pitch` bytes apart
+inline void copy_block_to_rows(void* dst, size_t pitch, const uint32_t* src){
+    auto* out = (uint8_t*)dst;
+
+    for(int row = 0; row < 4; row++)
+        memcpy(out + row * pitch, src + row * 4, 4 * sizeof(uint32_t));
+}
\ No newline at end of file
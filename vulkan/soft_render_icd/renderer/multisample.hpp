@@ -0,0 +1,124 @@
+#pragma once
+
+#include "simd.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+constexpr uint32_t max_samples = 8;
+
+// Offset of a sample from its pixel center, in 1/16 pixel
+struct SampleOffset {
+    int32_t x, y;
+};
+
+// Vulkan's standard sample locations, they all lie on a 1/16 pixel grid so the rasterizer can step to them exactly
+inline const SampleOffset* standard_sample_offsets(uint32_t samples){
+    static constexpr SampleOffset center[1] = {{0, 0}};
+    static constexpr SampleOffset x4[4] = {{-2, -6}, {6, -2}, {-6, 2}, {2, 6}};
+    static constexpr SampleOffset x8[8] = {{1, -3}, {-1, 3}, {5, 1}, {-3, -5}, {-5, 5}, {-7, -1}, {3, 7}, {7, -7}};
+
+    switch (samples) {
+        case 1: return center;
+        case 4: return x4;
+        case 8: return x8;
+        default: assert(!"Unsupported sample count"); return nullptr;
+    }
+}
+
+// Averages the samples of `count` R8G8B8A8_UNORM pixels into `dst`. Sample s of a pixel is `plane_stride` texels after sample 0
+using ResolveFunction = void (*)(const uint32_t* src, size_t plane_stride, uint32_t* dst, uint32_t count);
+
+namespace resolve_kernels
+{
+    // Sums are exact in 16 bits (8 * 255), so every path rounds the same way
+    template<uint32_t Samples>
+    inline void scalar(const uint32_t* src, size_t plane_stride, uint32_t* dst, uint32_t count){
+        constexpr uint32_t shift = __builtin_ctz(Samples);
+
+        for(uint32_t i = 0; i < count; i++){
+            uint32_t out = 0;
+            for(int c = 0; c < 4; c++){
+                uint32_t sum = Samples / 2;
+                for(uint32_t s = 0; s < Samples; s++)
+                    sum += (src[s * plane_stride + i] >> (8 * c)) & 0xFF;
+
+                out |= (sum >> shift) << (8 * c);
+            }
+
+            dst[i] = out;
+        }
+    }
+
+    #if defined(__x86_64__) || defined(__i386__)
+    template<uint32_t Samples>
+    __attribute__((target("sse4.1")))
+    inline void sse41(const uint32_t* src, size_t plane_stride, uint32_t* dst, uint32_t count){
+        constexpr int shift = __builtin_ctz(Samples);
+        const auto zero = _mm_setzero_si128();
+        const auto round = _mm_set1_epi16(Samples / 2);
+
+        uint32_t i = 0;
+        for(; i + 4 <= count; i += 4){
+            auto lo = round, hi = round;
+            for(uint32_t s = 0; s < Samples; s++){
+                auto v = _mm_loadu_si128((const __m128i*)(src + s * plane_stride + i));
+                lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+                hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+            }
+
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(_mm_srli_epi16(lo, shift), _mm_srli_epi16(hi, shift)));
+        }
+
+        scalar<Samples>(src + i, plane_stride, dst + i, count - i);
+    }
+
+    template<uint32_t Samples>
+    __attribute__((target("avx2")))
+    inline void avx2(const uint32_t* src, size_t plane_stride, uint32_t* dst, uint32_t count){
+        constexpr int shift = __builtin_ctz(Samples);
+        const auto zero = _mm256_setzero_si256();
+        const auto round = _mm256_set1_epi16(Samples / 2);
+
+        uint32_t i = 0;
+        for(; i + 8 <= count; i += 8){
+            auto lo = round, hi = round;
+            for(uint32_t s = 0; s < Samples; s++){
+                auto v = _mm256_loadu_si256((const __m256i*)(src + s * plane_stride + i));
+                lo = _mm256_add_epi16(lo, _mm256_unpacklo_epi8(v, zero));
+                hi = _mm256_add_epi16(hi, _mm256_unpackhi_epi8(v, zero));
+            }
+
+            // Unpacking and packing both stay within 128-bit lanes, so the texel order survives
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(_mm256_srli_epi16(lo, shift), _mm256_srli_epi16(hi, shift)));
+        }
+
+        sse41<Samples>(src + i, plane_stride, dst + i, count - i);
+    }
+    #endif
+
+    template<uint32_t Samples>
+    inline ResolveFunction select(SimdLevel level){
+        switch (level) {
+            #if defined(__x86_64__) || defined(__i386__)
+            case SimdLevel::AVX512: [[fallthrough]];
+            case SimdLevel::AVX2: return avx2<Samples>;
+            case SimdLevel::SSE41: return sse41<Samples>;
+            #endif
+            default: return scalar<Samples>;
+        }
+    }
+} // namespace resolve_kernels
+
+inline ResolveFunction select_resolve(uint32_t samples, SimdLevel level = simd_level()){
+    switch (samples) {
+        case 4: return resolve_kernels::select<4>(level);
+        case 8: return resolve_kernels::select<8>(level);
+        default: assert(!"Unsupported sample count"); return nullptr;
+    }
+}
\ No newline at end of file
@@ -2,30 +2,63 @@
 
 #include "../../../vulkan-headers/include/vulkan/vulkan.h"
 
+#include <algorithm>
+#include <cassert>
+
+// Ops are template parameters, so the per pixel code never switches on them. select_*() picks an instantiation once, at pipeline creation
+
+template<VkCompareOp Op, typename T>
+bool compare_op(const T& lhs, const T& rhs){
+	if constexpr (Op == VK_COMPARE_OP_NEVER) return false;
+	else if constexpr (Op == VK_COMPARE_OP_ALWAYS) return true;
+	else if constexpr (Op == VK_COMPARE_OP_LESS) return lhs < rhs;
+	else if constexpr (Op == VK_COMPARE_OP_LESS_OR_EQUAL) return lhs <= rhs;
+	else if constexpr (Op == VK_COMPARE_OP_GREATER) return lhs > rhs;
+	else if constexpr (Op == VK_COMPARE_OP_GREATER_OR_EQUAL) return lhs >= rhs;
+	else if constexpr (Op == VK_COMPARE_OP_EQUAL) return lhs == rhs;
+	else if constexpr (Op == VK_COMPARE_OP_NOT_EQUAL) return lhs != rhs;
+}
+
+template<typename T>
+using CompareOpFunction = bool (*)(const T&, const T&);
+
 template<typename T>
-bool apply_compare_op(const VkCompareOp op, const T& lhs, const T& rhs){
+CompareOpFunction<T> select_compare_op(const VkCompareOp op){
 	switch(op) {
-		case VK_COMPARE_OP_NEVER: return false;
-		case VK_COMPARE_OP_ALWAYS: return true;
-		case VK_COMPARE_OP_LESS: return lhs < rhs;
-		case VK_COMPARE_OP_LESS_OR_EQUAL: return lhs <= rhs;
-		case VK_COMPARE_OP_GREATER: return lhs > rhs;
-		case VK_COMPARE_OP_GREATER_OR_EQUAL: return lhs >= rhs;
-		case VK_COMPARE_OP_EQUAL: return lhs == rhs;
-		case VK_COMPARE_OP_NOT_EQUAL: return lhs != rhs;
-		default: assert(!"Illegal VkCompareOp");
+		case VK_COMPARE_OP_NEVER: return compare_op<VK_COMPARE_OP_NEVER, T>;
+		case VK_COMPARE_OP_ALWAYS: return compare_op<VK_COMPARE_OP_ALWAYS, T>;
+		case VK_COMPARE_OP_LESS: return compare_op<VK_COMPARE_OP_LESS, T>;
+		case VK_COMPARE_OP_LESS_OR_EQUAL: return compare_op<VK_COMPARE_OP_LESS_OR_EQUAL, T>;
+		case VK_COMPARE_OP_GREATER: return compare_op<VK_COMPARE_OP_GREATER, T>;
+		case VK_COMPARE_OP_GREATER_OR_EQUAL: return compare_op<VK_COMPARE_OP_GREATER_OR_EQUAL, T>;
+		case VK_COMPARE_OP_EQUAL: return compare_op<VK_COMPARE_OP_EQUAL, T>;
+		case VK_COMPARE_OP_NOT_EQUAL: return compare_op<VK_COMPARE_OP_NOT_EQUAL, T>;
+		default: assert(!"Illegal VkCompareOp"); return nullptr;
 	}
 }
 
+template<VkBlendOp Op, typename T>
+T blend_op(const T& lhs, const T& rhs){
+	using std::min, std::max; // glm types are found through ADL
+
+	if constexpr (Op == VK_BLEND_OP_ADD) return lhs + rhs;
+	else if constexpr (Op == VK_BLEND_OP_SUBTRACT) return lhs - rhs;
+	else if constexpr (Op == VK_BLEND_OP_REVERSE_SUBTRACT) return rhs - lhs;
+	else if constexpr (Op == VK_BLEND_OP_MIN) return min(lhs, rhs);
+	else if constexpr (Op == VK_BLEND_OP_MAX) return max(lhs, rhs);
+}
+
 template<typename T>
-T apply_blend_op(const VkBlendOp op, const T& lhs, const T& rhs){
+using BlendOpFunction = T (*)(const T&, const T&);
+
+template<typename T>
+BlendOpFunction<T> select_blend_op(const VkBlendOp op){
 	switch(op) {
-		case VK_BLEND_OP_ADD: return lhs + rhs;
-		case VK_BLEND_OP_SUBTRACT: return lhs - rhs;
-		case VK_BLEND_OP_REVERSE_SUBTRACT: return rhs - lhs;
-		case VK_BLEND_OP_MIN: return std::min(lhs, rhs);
-		case VK_BLEND_OP_MAX: return std::max(lhs, rhs);
-		default: assert(!"Illegal VkBlendOp");
+		case VK_BLEND_OP_ADD: return blend_op<VK_BLEND_OP_ADD, T>;
+		case VK_BLEND_OP_SUBTRACT: return blend_op<VK_BLEND_OP_SUBTRACT, T>;
+		case VK_BLEND_OP_REVERSE_SUBTRACT: return blend_op<VK_BLEND_OP_REVERSE_SUBTRACT, T>;
+		case VK_BLEND_OP_MIN: return blend_op<VK_BLEND_OP_MIN, T>;
+		case VK_BLEND_OP_MAX: return blend_op<VK_BLEND_OP_MAX, T>;
+		default: assert(!"Illegal VkBlendOp"); return nullptr;
 	}
 }
-
@@ -5,13 +5,57 @@
 #include "../../../vulkan-headers/include/vulkan/vulkan.h"
 
 #include "operations.hpp"
+#include "binner.hpp"
+#include "edge_kernels.hpp"
+#include "blend_kernels.hpp"
+#include "thread_pool.hpp"
+#include "render_pass_instance.hpp"
+#include "tile_buffer.hpp"
+#include "hiz.hpp"
+#include "buffer.hpp"
+#include "vertex_cache.hpp"
+#include "vertex_input.hpp"
+#include "clipper.hpp"
+#include "interpolation.hpp"
+#include "multisample.hpp"
+#include "spirv/properties.hpp"
 
 #include <glm/gtx/vec_swizzle.hpp>
 
+#include <numeric>
+
+// Where the depth test happens relative to the fragment shader
+enum class DepthStage {
+    Early, // Test and write before shading, only fragments that pass are shaded
+    EarlyTest, // Test before shading, fragments the shader keeps write depth afterwards. For shaders that only discard
+    Late // Shade every fragment, then test and write. For shaders that write depth or have side effects
+};
+
+// Early-Z only changes the result if the shader changes the depth, the coverage or memory. A discard only stands in the way of writing depth early
+inline DepthStage select_depth_stage(const EntryPointProperties& fragment_shader){
+    if(fragment_shader.early_fragment_tests)
+        return DepthStage::Early;
+    if(fragment_shader.writes_depth || fragment_shader.side_effects)
+        return DepthStage::Late;
+    if(fragment_shader.discards)
+        return DepthStage::EarlyTest;
+    return DepthStage::Early;
+}
+
+inline glm::vec4 unpack_unorm8(const uint8_t* texel){
+    return glm::vec4{texel[0] / 255.0f, texel[1] / 255.0f, texel[2] / 255.0f, texel[3] / 255.0f};
+}
+
+inline void pack_unorm8(uint8_t* texel, glm::vec4 colour){
+    for(int i = 0; i < 4; i++)
+        texel[i] = (uint8_t)std::lround(std::clamp(colour[i], 0.0f, 1.0f) * 255.0f);
+}
+
 class Blender {
     public:
     Blender() = default;
-    Blender(const VkPipelineColorBlendStateCreateInfo& state): _state{state} { 
+    // Blends into colour attachment `attachment` of the subpass
+    Blender(const VkPipelineColorBlendStateCreateInfo& state, uint32_t attachment): _state{state} {
         assert(state.sType == VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO);
         assert(state.logicOpEnable == false); // TODO: Support Logical ops
         assert(state.flags == 0); // Spec hasn't defined any yet
@@ -22,50 +66,198 @@ class Blender {
 
         _state.pAttachments = _attachments.data();
 
-        // TODO: Multiple attachments
-        assert(_attachments[0].colorWriteMask == VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT); // TODO: Support Write Masks
+        assert(attachment < _attachments.size());
+        assert(_attachments[attachment].colorWriteMask == (VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT)); // TODO: Support Write Masks
+
+        _constants = glm::vec4{state.blendConstants[0], state.blendConstants[1], state.blendConstants[2], state.blendConstants[3]};
+        _blend = select_blend(_attachments[attachment]);
     }
     
-    glm::vec4 operator()(glm::vec4 c_new, glm::vec4 c_old){
-        if(!_attachments[0].blendEnable)
-            return c_new;
-        
-        auto factor = [this, &c_old, &c_new](VkBlendFactor factor) -> glm::vec4 {
-            switch (factor)
-            {
-            case VK_BLEND_FACTOR_ZERO: return glm::vec4{0, 0, 0, 0};
-            case VK_BLEND_FACTOR_ONE: return glm::vec4{1, 1, 1, 1};
-            case VK_BLEND_FACTOR_SRC_COLOR: return c_new;
-            case VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR: return glm::vec4{1 - c_new.r, 1 - c_new.g, 1 - c_new.b, 1 - c_new.a};
-            
-            case VK_BLEND_FACTOR_SRC_ALPHA: return glm::vec4{c_new.a};
+    glm::vec4 operator()(glm::vec4 c_new, glm::vec4 c_old) const {
+        return _blend(*this, c_new, c_old);
+    }
+
+    // Blends a run of R8G8B8A8_UNORM fragment colours into consecutive texels of `dst`.
+    // Common states stay in packed integers, everything else round trips through operator()
+    void blend_unorm8(const uint32_t* src, uint32_t* dst, uint32_t count) const {
+        if(_blend_unorm8)
+            return _blend_unorm8(src, dst, count);
+
+        for(uint32_t i = 0; i < count; i++)
+            pack_unorm8((uint8_t*)&dst[i], (*this)(unpack_unorm8((const uint8_t*)&src[i]), unpack_unorm8((const uint8_t*)&dst[i])));
+    }
+
+    // The result doesn't depend on the destination
+    bool replaces() const {
+        return _blend == blend_disabled;
+    }
+
+    private:
+    using BlendFunction = glm::vec4 (*)(const Blender&, glm::vec4, glm::vec4);
+    using FactorFunction = glm::vec4 (*)(glm::vec4, glm::vec4, glm::vec4);
+
+    // RGB factor in .xyz, alpha factor in .w
+    template<VkBlendFactor Factor>
+    static glm::vec4 factor(glm::vec4 c_new, glm::vec4 c_old, glm::vec4 constants){
+        if constexpr (Factor == VK_BLEND_FACTOR_ZERO) return glm::vec4{0, 0, 0, 0};
+        else if constexpr (Factor == VK_BLEND_FACTOR_ONE) return glm::vec4{1, 1, 1, 1};
+        else if constexpr (Factor == VK_BLEND_FACTOR_SRC_COLOR) return c_new;
+        else if constexpr (Factor == VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR) return 1.0f - c_new;
+        else if constexpr (Factor == VK_BLEND_FACTOR_DST_COLOR) return c_old;
+        else if constexpr (Factor == VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR) return 1.0f - c_old;
+        else if constexpr (Factor == VK_BLEND_FACTOR_SRC_ALPHA) return glm::vec4{c_new.a};
+        else if constexpr (Factor == VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA) return glm::vec4{1 - c_new.a};
+        else if constexpr (Factor == VK_BLEND_FACTOR_DST_ALPHA) return glm::vec4{c_old.a};
+        else if constexpr (Factor == VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA) return glm::vec4{1 - c_old.a};
+        else if constexpr (Factor == VK_BLEND_FACTOR_CONSTANT_COLOR) return constants;
+        else if constexpr (Factor == VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_COLOR) return 1.0f - constants;
+        else if constexpr (Factor == VK_BLEND_FACTOR_CONSTANT_ALPHA) return glm::vec4{constants.a};
+        else if constexpr (Factor == VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_ALPHA) return glm::vec4{1 - constants.a};
+        else if constexpr (Factor == VK_BLEND_FACTOR_SRC_ALPHA_SATURATE) {
+            auto f = std::min(c_new.a, 1 - c_old.a);
+            return glm::vec4{f, f, f, 1};
+        }
+    }
+
+    static FactorFunction select_factor(VkBlendFactor factor){
+        switch (factor) {
+            case VK_BLEND_FACTOR_ZERO: return Blender::factor<VK_BLEND_FACTOR_ZERO>;
+            case VK_BLEND_FACTOR_ONE: return Blender::factor<VK_BLEND_FACTOR_ONE>;
+            case VK_BLEND_FACTOR_SRC_COLOR: return Blender::factor<VK_BLEND_FACTOR_SRC_COLOR>;
+            case VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR: return Blender::factor<VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR>;
+            case VK_BLEND_FACTOR_DST_COLOR: return Blender::factor<VK_BLEND_FACTOR_DST_COLOR>;
+            case VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR: return Blender::factor<VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR>;
+            case VK_BLEND_FACTOR_SRC_ALPHA: return Blender::factor<VK_BLEND_FACTOR_SRC_ALPHA>;
+            case VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA: return Blender::factor<VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA>;
+            case VK_BLEND_FACTOR_DST_ALPHA: return Blender::factor<VK_BLEND_FACTOR_DST_ALPHA>;
+            case VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA: return Blender::factor<VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA>;
+            case VK_BLEND_FACTOR_CONSTANT_COLOR: return Blender::factor<VK_BLEND_FACTOR_CONSTANT_COLOR>;
+            case VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_COLOR: return Blender::factor<VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_COLOR>;
+            case VK_BLEND_FACTOR_CONSTANT_ALPHA: return Blender::factor<VK_BLEND_FACTOR_CONSTANT_ALPHA>;
+            case VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_ALPHA: return Blender::factor<VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_ALPHA>;
+            case VK_BLEND_FACTOR_SRC_ALPHA_SATURATE: return Blender::factor<VK_BLEND_FACTOR_SRC_ALPHA_SATURATE>;
 
             default:
-                print("Granite/Blender: Unknown RGB VkBlendFactor: {:#x}\n", factor);
+                print("Granite/Blender: Unknown VkBlendFactor: {:#x}\n", (uint32_t)factor);
                 assert(!"Granite/Blender: Error");
-            }
-        };
+                return nullptr;
+        }
+    }
+
+    static glm::vec4 blend_disabled([[maybe_unused]] const Blender& self, glm::vec4 c_new, [[maybe_unused]] glm::vec4 c_old){
+        return c_new;
+    }
 
-        auto src_colour_factor = glm::xyz(factor(_attachments[0].srcColorBlendFactor));
-        auto dst_colour_factor = glm::xyz(factor(_attachments[0].dstColorBlendFactor));
+    // Fully specialized for the common states, lets the compiler fold the factors away
+    template<VkBlendFactor SrcColour, VkBlendFactor DstColour, VkBlendOp ColourOp, VkBlendFactor SrcAlpha, VkBlendFactor DstAlpha, VkBlendOp AlphaOp>
+    static glm::vec4 blend(const Blender& self, glm::vec4 c_new, glm::vec4 c_old){
+        auto src_colour_factor = glm::xyz(factor<SrcColour>(c_new, c_old, self._constants));
+        auto dst_colour_factor = glm::xyz(factor<DstColour>(c_new, c_old, self._constants));
 
-        auto src_alpha_factor = factor(_attachments[0].srcAlphaBlendFactor).a;
-        auto dst_alpha_factor = factor(_attachments[0].dstAlphaBlendFactor).a;
+        auto src_alpha_factor = factor<SrcAlpha>(c_new, c_old, self._constants).a;
+        auto dst_alpha_factor = factor<DstAlpha>(c_new, c_old, self._constants).a;
 
-        glm::vec3 out_rgb = apply_blend_op(_attachments[0].colorBlendOp, src_colour_factor * glm::xyz(c_new), dst_colour_factor * glm::xyz(c_old));
-        float out_a = apply_blend_op(_attachments[0].alphaBlendOp, src_alpha_factor * c_new.w, dst_alpha_factor * c_old.w);
+        glm::vec3 out_rgb = blend_op<ColourOp>(src_colour_factor * glm::xyz(c_new), dst_colour_factor * glm::xyz(c_old));
+        float out_a = blend_op<AlphaOp>(src_alpha_factor * c_new.a, dst_alpha_factor * c_old.a);
 
         return glm::vec4{out_rgb, out_a};
     }
 
-    private:
+    // Every other state, the factors and ops were still resolved to functions at pipeline creation
+    static glm::vec4 blend_generic(const Blender& self, glm::vec4 c_new, glm::vec4 c_old){
+        auto src_colour_factor = glm::xyz(self._src_colour_factor(c_new, c_old, self._constants));
+        auto dst_colour_factor = glm::xyz(self._dst_colour_factor(c_new, c_old, self._constants));
+
+        auto src_alpha_factor = self._src_alpha_factor(c_new, c_old, self._constants).a;
+        auto dst_alpha_factor = self._dst_alpha_factor(c_new, c_old, self._constants).a;
+
+        glm::vec3 out_rgb = self._colour_op(src_colour_factor * glm::xyz(c_new), dst_colour_factor * glm::xyz(c_old));
+        float out_a = self._alpha_op(src_alpha_factor * c_new.a, dst_alpha_factor * c_old.a);
+
+        return glm::vec4{out_rgb, out_a};
+    }
+
+    BlendFunction select_blend(VkPipelineColorBlendAttachmentState attachment){
+        if(!attachment.blendEnable){
+            _blend_unorm8 = select_unorm8_blend(Unorm8BlendMode::Replace);
+            return blend_disabled;
+        }
+
+        // VK_BLEND_OP_MIN and VK_BLEND_OP_MAX don't use the factors
+        if(attachment.colorBlendOp == VK_BLEND_OP_MIN || attachment.colorBlendOp == VK_BLEND_OP_MAX)
+            attachment.srcColorBlendFactor = attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        if(attachment.alphaBlendOp == VK_BLEND_OP_MIN || attachment.alphaBlendOp == VK_BLEND_OP_MAX)
+            attachment.srcAlphaBlendFactor = attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+
+        struct Preset {
+            VkBlendFactor src_colour, dst_colour;
+            VkBlendOp colour_op;
+            VkBlendFactor src_alpha, dst_alpha;
+            VkBlendOp alpha_op;
+
+            BlendFunction function;
+            Unorm8BlendMode unorm8_mode;
+        };
+
+        constexpr Preset presets[] = {
+            // Alpha blending
+            {VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD,
+                blend<VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD>, Unorm8BlendMode::Alpha},
+            {VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD,
+                blend<VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD>, Unorm8BlendMode::AlphaOver},
+            // Premultiplied alpha
+            {VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD,
+                blend<VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD>, Unorm8BlendMode::Premultiplied},
+            // Additive
+            {VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE, VK_BLEND_OP_ADD,
+                blend<VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE, VK_BLEND_OP_ADD>, Unorm8BlendMode::Additive},
+            // Pass-through written as a blend
+            {VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD, blend_disabled, Unorm8BlendMode::Replace}
+        };
+
+        for(const auto& preset : presets){
+            if(preset.src_colour == attachment.srcColorBlendFactor && preset.dst_colour == attachment.dstColorBlendFactor && preset.colour_op == attachment.colorBlendOp &&
+               preset.src_alpha == attachment.srcAlphaBlendFactor && preset.dst_alpha == attachment.dstAlphaBlendFactor && preset.alpha_op == attachment.alphaBlendOp){
+                _blend_unorm8 = select_unorm8_blend(preset.unorm8_mode);
+                return preset.function;
+            }
+        }
+
+        _src_colour_factor = select_factor(attachment.srcColorBlendFactor);
+        _dst_colour_factor = select_factor(attachment.dstColorBlendFactor);
+        _src_alpha_factor = select_factor(attachment.srcAlphaBlendFactor);
+        _dst_alpha_factor = select_factor(attachment.dstAlphaBlendFactor);
+
+        _colour_op = select_blend_op<glm::vec3>(attachment.colorBlendOp);
+        _alpha_op = select_blend_op<float>(attachment.alphaBlendOp);
+
+        return blend_generic;
+    }
+
     VkPipelineColorBlendStateCreateInfo _state;
     std::vector<VkPipelineColorBlendAttachmentState> _attachments;
+
+    glm::vec4 _constants;
+    BlendFunction _blend;
+    Unorm8BlendFunction _blend_unorm8 = nullptr;
+
+    FactorFunction _src_colour_factor, _dst_colour_factor, _src_alpha_factor, _dst_alpha_factor;
+    BlendOpFunction<glm::vec3> _colour_op;
+    BlendOpFunction<float> _alpha_op;
+};
+
+// 2x2 pixels at (x, y), both even. Lane i is the pixel (x + (i & 1), y + (i >> 1)).
+// Lanes that aren't in `mask` are helpers: Not covered, but shaded anyway so derivatives exist for the whole quad
+struct Quad {
+    int32_t x, y;
+    uint32_t mask;
+    uint32_t coverage[4]; // Covered samples of each lane, just bit 0 without multisampling
+    float z[4][max_samples]; // Depth at each sample of each lane
 };
 
 struct Rasterizer {
     Rasterizer() = default;
-    Rasterizer(const VkPipelineRasterizationStateCreateInfo& info): _info{info} {
+    Rasterizer(const VkPipelineRasterizationStateCreateInfo& info, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT): _info{info}, _samples{samples} {
         assert(_info.sType == VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO);
         assert(_info.flags == 0);
 
@@ -74,53 +266,383 @@ struct Rasterizer {
         assert(_info.depthBiasEnable == false); // TODO: Depth Bias support
 
         assert(_info.polygonMode == VK_POLYGON_MODE_FILL); // TODO: Support non-fill polygon modes
-        assert(_info.cullMode == VK_CULL_MODE_NONE); // TODO: Implement Back Face Culling
-        assert(_info.frontFace == VK_FRONT_FACE_COUNTER_CLOCKWISE); // TODO: Implement Clockwise Front Face
+        assert((_info.cullMode & ~VK_CULL_MODE_FRONT_AND_BACK) == 0);
+        assert(_info.frontFace == VK_FRONT_FACE_COUNTER_CLOCKWISE || _info.frontFace == VK_FRONT_FACE_CLOCKWISE);
+
+        _sample_offsets = standard_sample_offsets(_samples);
+        for(uint32_t s = 0; s < _samples; s++){
+            // 1/16 pixel to subpixels
+            Point offset{_sample_offsets[s].x * (subpixel_one / 16), _sample_offsets[s].y * (subpixel_one / 16)};
+            _sample_min = Point{std::min(_sample_min.x, offset.x), std::min(_sample_min.y, offset.y)};
+            _sample_max = Point{std::max(_sample_max.x, offset.x), std::max(_sample_max.y, offset.y)};
+        }
+    }
+
+    uint32_t samples() const {
+        return _samples;
     }
 
-    template<typename P>
-    void operator()(const VkViewport& view, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, P pixel){
-        // Calculate bouding box
-        auto min_y = std::min(v0.y, std::min(v1.y, v2.y));
-        auto max_y = std::max(v0.y, std::max(v1.y, v2.y));
+    // Decided once per triangle before it is binned, so triangles that can't produce fragments never reach a tile:
+    // Zero area, facing away according to the cull mode, or too small to cover a single sample
+    bool culled(const Triangle& tri) const {
+        Point p0 = snap(tri.v0), p1 = snap(tri.v1), p2 = snap(tri.v2);
 
-        auto min_x = std::min(v0.x, std::min(v1.x, v2.x));
-        auto max_x = std::max(v0.x, std::max(v1.x, v2.x));
+        auto area = edge(p0, p1, p2);
+        if(area == 0)
+            return true;
+
+        // A positive area is counter clockwise in Vulkan's framebuffer coordinates
+        bool front_facing = (area > 0) == (_info.frontFace == VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        if(_info.cullMode & (front_facing ? VK_CULL_MODE_FRONT_BIT : VK_CULL_MODE_BACK_BIT))
+            return true;
+
+        auto min_x = std::min(p0.x, std::min(p1.x, p2.x)), max_x = std::max(p0.x, std::max(p1.x, p2.x));
+        auto min_y = std::min(p0.y, std::min(p1.y, p2.y)), max_y = std::max(p0.y, std::max(p1.y, p2.y));
+
+        return first_center(min_x - _sample_max.x) > last_center(max_x - _sample_min.x) || first_center(min_y - _sample_max.y) > last_center(max_y - _sample_min.y);
+    }
+
+    // Rasterizes the part of the triangle that lies within `region`, which is usually a single tile, and calls quad(Quad) for every 2x2 quad with covered pixels.
+    // `block_visible(x, y, min_z, max_z)` gets the depth range of the triangle within an 8x8 block before its pixels are visited
+    template<typename Q, typename B>
+    void operator()(const VkRect2D& region, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, Q quad, B block_visible){
+        // Snap to fixed point, everything that decides coverage is exact integer math from here on
+        Point p0 = snap(v0), p1 = snap(v1), p2 = snap(v2);
+
+        auto area = edge(p0, p1, p2);
+        if(area == 0)
+            return;
+
+        // Back facing triangles that weren't culled are walked in counter clockwise order, so inside is always positive
+        if(area < 0){
+            std::swap(p1, p2);
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        // Calculate bouding box, covering every pixel with a sample that can be inside the triangle
+        auto min_x = std::min(p0.x, std::min(p1.x, p2.x)) - _sample_max.x;
+        auto max_x = std::max(p0.x, std::max(p1.x, p2.x)) - _sample_min.x;
+
+        auto min_y = std::min(p0.y, std::min(p1.y, p2.y)) - _sample_max.y;
+        auto max_y = std::max(p0.y, std::max(p1.y, p2.y)) - _sample_min.y;
 
         // Calculate screen space region
-        size_t x0 = std::max(size_t{0}, (size_t)std::floor(min_x));
-        size_t x1 = std::min(view.w - 1, (size_t)std::floor(max_x));
-        size_t y0 = std::max(size_t{0}, (size_t)std::floor(min_y));
-        size_t y1 = std::min(view.h - 1, (size_t)std::floor(max_y));
+        int32_t x0 = std::max<int64_t>(region.offset.x, first_center(min_x));
+        int32_t x1 = std::min<int64_t>(region.offset.x + (int32_t)region.extent.width - 1, last_center(max_x));
+        int32_t y0 = std::max<int64_t>(region.offset.y, first_center(min_y));
+        int32_t y1 = std::min<int64_t>(region.offset.y + (int32_t)region.extent.height - 1, last_center(max_y));
+
+        if(x0 > x1 || y0 > y1)
+            return;
+
+        // Vulkan top-left rule: Pixel centers exactly on an edge are only covered if it is a top or left edge.
+        // The inside is to the right of a left edge (edge grows along +x), and below a top edge (horizontal, grows along +y)
+        auto is_top_left = [](Point a, Point b) -> bool {
+            return (b.y > a.y) || (b.y == a.y && b.x < a.x);
+        };
+
+        const Point edges[3][2] = {{p1, p2}, {p2, p0}, {p0, p1}};
+
+        EdgeBlockSetup setup{};
+        setup.inv_area = 1 / (float)area;
+
+        int64_t e_row[3], step_x[3], step_y[3], block_step_x[3], block_step_y[3];
+        Point origin{(int64_t)x0 * subpixel_one + subpixel_half, (int64_t)y0 * subpixel_one + subpixel_half};
+        for(int k = 0; k < 3; k++){
+            auto [a, b] = edges[k];
+
+            e_row[k] = edge(a, b, origin);
+            // Multiplied rather than shifted, the differences can be negative
+            step_x[k] = (b.y - a.y) * subpixel_one;
+            step_y[k] = -((b.x - a.x) * subpixel_one);
+
+            setup.bias[k] = is_top_left(a, b) ? 0 : -1;
+            for(int lane = 0; lane < 16; lane++)
+                setup.lane_offset[k][lane] = lane * step_x[k];
+        }
+
+        // Samples sit at fixed offsets from their pixel center, so the edge value at a sample is the center's plus a constant per edge and sample.
+        // The block tests below are widened by the extremes of those constants
+        int64_t sample_e[3][max_samples] = {}, slack_min[3] = {}, slack_max[3] = {};
+        for(int k = 0; k < 3; k++){
+            for(uint32_t s = 0; s < _samples; s++){
+                // Both steps are multiples of subpixel_one, so this is exact
+                sample_e[k][s] = (_sample_offsets[s].x * step_x[k] + _sample_offsets[s].y * step_y[k]) / 16;
+                slack_min[k] = std::min(slack_min[k], sample_e[k][s]);
+                slack_max[k] = std::max(slack_max[k], sample_e[k][s]);
+            }
+        }
+
+        SampleSetup sample_setup{};
+        if(_samples > 1)
+            setup_samples(setup, step_x, sample_e, sample_setup);
+
+        // Walk the bounding box in aligned 8x8 blocks. Edges are linear, so testing the corners of a block tells if
+        // it is entirely outside of an edge (skip it), entirely inside all of them (no per pixel tests), or partially covered
+        int32_t bx0 = x0 & ~(block_size - 1), by0 = y0 & ~(block_size - 1);
+        for(int k = 0; k < 3; k++){
+            e_row[k] += (bx0 - x0) * step_x[k] + (by0 - y0) * step_y[k];
+
+            block_step_x[k] = step_x[k] * block_size;
+            block_step_y[k] = step_y[k] * block_size;
+        }
+
+        // Depth is affine in screen space, so its extremes within a block are at the corners
+        double inv_area = 1.0 / area;
+        double vertex_z[3] = {v0.z, v1.z, v2.z};
+        double dz_dx = 0, dz_dy = 0;
+        for(int k = 0; k < 3; k++){
+            dz_dx += step_x[k] * inv_area * vertex_z[k];
+            dz_dy += step_y[k] * inv_area * vertex_z[k];
+        }
+
+        auto min_z = std::min(v0.z, std::min(v1.z, v2.z));
+        auto max_z = std::max(v0.z, std::max(v1.z, v2.z));
+
+        float sample_dz[max_samples] = {};
+        double z_slack = 0;
+        for(uint32_t s = 0; s < _samples; s++){
+            sample_dz[s] = (_sample_offsets[s].x * dz_dx + _sample_offsets[s].y * dz_dy) / 16;
+            z_slack = std::max(z_slack, std::abs((double)sample_dz[s]));
+        }
+
+        EdgeBlockResult block{};
+        for(int32_t by = by0; by <= y1; by += block_size){
+            int64_t e_block[3] = {e_row[0], e_row[1], e_row[2]};
+
+            for(int32_t bx = bx0; bx <= x1; bx += block_size){
+                // Part of the block that lies within the bounding box
+                int32_t cx0 = std::max(bx, x0), cx1 = std::min(bx + block_size - 1, x1);
+                int32_t cy0 = std::max(by, y0), cy1 = std::min(by + block_size - 1, y1);
 
-	    auto edge = [](glm::vec2 a, glm::vec2 b, glm::vec2 c) -> float {
-    		return (c.x - a.x) * (b.y - a.y) - (c.y - a.y) * (b.x - a.x);
-    	};
+                const int64_t e_origin[3] = {e_block[0], e_block[1], e_block[2]};
 
-	    auto area = edge(v0, v1, v2);
+                int64_t e_start[3];
+                bool outside = false, inside = true;
+                for(int k = 0; k < 3; k++){
+                    e_start[k] = e_block[k] + (cx0 - bx) * step_x[k] + (cy0 - by) * step_y[k];
 
-	    for(size_t y = y0; y <= y1; y++){
-		    for(size_t x = x0; x <= x1; x++){
-    			auto pixel_coord = glm::vec2{x + 0.5, y + 0.5};
+                    auto dx = (cx1 - cx0) * step_x[k], dy = (cy1 - cy0) * step_y[k];
+                    auto max_e = e_start[k] + std::max(int64_t{0}, dx) + std::max(int64_t{0}, dy) + setup.bias[k] + slack_max[k];
+                    auto min_e = e_start[k] + std::min(int64_t{0}, dx) + std::min(int64_t{0}, dy) + setup.bias[k] + slack_min[k];
 
-	    		auto w0 = edge(v1, v2, pixel_coord);
-		    	auto w1 = edge(v2, v0, pixel_coord);
-    			auto w2 = edge(v0, v1, pixel_coord);
+                    outside |= (max_e < 0);
+                    inside &= (min_e >= 0);
+                }
 
-	    		if(w0 >= 0 && w1 >= 0 && w2 >= 0){
-		    		w0 /= area;
-			    	w1 /= area;
-				    w2 /= area;
-				
-				    auto z = 1 / ((v0.z * w0) + (v1.z * w1) + (v2.z * w2));
-				    pixel(x, y, z);
-			    }
-		    }
-	    }
+                for(int k = 0; k < 3; k++)
+                    e_block[k] += block_step_x[k];
+
+                if(outside)
+                    continue;
+
+                double z_start = 0;
+                for(int k = 0; k < 3; k++)
+                    z_start += e_start[k] * inv_area * vertex_z[k];
+
+                auto dx = dz_dx * (cx1 - cx0), dy = dz_dy * (cy1 - cy0);
+                auto block_min_z = std::max<float>(min_z, z_start + std::min(0.0, dx) + std::min(0.0, dy) - z_slack);
+                auto block_max_z = std::min<float>(max_z, z_start + std::max(0.0, dx) + std::max(0.0, dy) + z_slack);
+
+                if(!block_visible(bx, by, block_min_z, block_max_z))
+                    continue;
+
+                rasterize_block(setup, sample_setup, e_origin, step_x, step_y, inside, bx, by, cx0, cx1, cy0, cy1, [&](int32_t x, int32_t y, uint32_t mask, const float (&w)[3][4], const uint32_t (&coverage)[4]){
+                    Quad q;
+                    q.x = x;
+                    q.y = y;
+                    q.mask = mask;
+                    for(int i = 0; i < 4; i++){
+                        float z = (v0.z * w[0][i]) + (v1.z * w[1][i]) + (v2.z * w[2][i]);
+
+                        q.coverage[i] = coverage[i];
+                        for(uint32_t s = 0; s < _samples; s++)
+                            q.z[i][s] = z + sample_dz[s];
+                    }
+
+                    quad(q);
+                }, block);
+            }
+
+            for(int k = 0; k < 3; k++)
+                e_row[k] += block_step_y[k];
+        }
     }
 
     private:
+    static constexpr int32_t block_size = 8;
+
+    struct Point {
+        int64_t x, y;
+    };
+
+    static Point snap(glm::vec3 v){
+        return Point{std::llround(v.x * subpixel_one), std::llround(v.y * subpixel_one)};
+    }
+
+    static int64_t edge(Point a, Point b, Point c){
+        return (c.x - a.x) * (b.y - a.y) - (c.y - a.y) * (b.x - a.x);
+    }
+
+    // First and last pixel whose center is at or after / at or before a fixed point coordinate
+    static int64_t first_center(int64_t coord){
+        return (coord - subpixel_half + subpixel_one - 1) >> subpixel_bits;
+    }
+
+    static int64_t last_center(int64_t coord){
+        return (coord - subpixel_half) >> subpixel_bits;
+    }
+
+    // With multisampling the edge kernel runs over samples instead of pixel centers: Lanes are consecutive samples of consecutive pixels.
+    // Kernels narrower than a pixel's samples alternate between patterns that cover one part of them each
+    struct SampleSetup {
+        EdgeBlockSetup patterns[max_samples / 4];
+        uint32_t n_patterns;
+        int32_t pixels_per_call;
+    };
+
+    void setup_samples(const EdgeBlockSetup& setup, const int64_t* step_x, const int64_t (&sample_e)[3][max_samples], SampleSetup& out) const {
+        int32_t width = _edge_kernel.width;
+
+        out.n_patterns = std::max<uint32_t>(1, _samples / width);
+        out.pixels_per_call = std::max<int32_t>(1, width / _samples);
+        for(uint32_t p = 0; p < out.n_patterns; p++){
+            out.patterns[p] = setup;
+            for(int k = 0; k < 3; k++){
+                for(int32_t lane = 0; lane < width; lane++){
+                    uint32_t sample = p * width + lane;
+                    out.patterns[p].lane_offset[k][lane] = (sample / _samples) * step_x[k] + sample_e[k][sample % _samples];
+                }
+            }
+        }
+    }
+
+    // Covered samples of the block_size pixels starting at the pixel center with edge values `e_row`, _samples bits per pixel
+    uint64_t sample_coverage(const SampleSetup& setup, const int64_t* e_row, const int64_t* step_x, EdgeBlockResult& block) const {
+        int32_t width = _edge_kernel.width;
+        uint64_t lanes = (uint64_t{1} << width) - 1;
+
+        uint64_t coverage = 0;
+        for(uint32_t call = 0; call * width < block_size * _samples; call++){
+            int64_t pixel = (call / setup.n_patterns) * setup.pixels_per_call;
+            int64_t e[3] = {e_row[0] + pixel * step_x[0], e_row[1] + pixel * step_x[1], e_row[2] + pixel * step_x[2]};
+
+            coverage |= (_edge_kernel.function(setup.patterns[call % setup.n_patterns], e, block) & lanes) << (call * width);
+        }
+
+        return coverage;
+    }
+
+    // Steps the edge values incrementally over the aligned block at (bx, by), two rows at a time, no multiplies are left in the loops.
+    // Calls covered(x, y, mask, w, coverage) for every 2x2 quad with pixels covered in [x0, x1] x [y0, y1], w are the barycentrics of all 4 lanes at their pixel center
+    // and coverage their covered samples. Fully covered blocks skip the coverage mask, the kernel is still used for the barycentrics
+    template<typename F>
+    void rasterize_block(const EdgeBlockSetup& setup, const SampleSetup& sample_setup, const int64_t* e_block, const int64_t* step_x, const int64_t* step_y, bool inside,
+                         int32_t bx, int32_t by, int32_t x0, int32_t x1, int32_t y0, int32_t y1, F covered, EdgeBlockResult& block){
+        static_assert(block_size % 2 == 0, "Quads can't straddle blocks");
+
+        int32_t width = std::min(_edge_kernel.width, block_size);
+        int64_t kernel_step_x[3] = {step_x[0] * width, step_x[1] * width, step_x[2] * width};
+
+        // Pixels of a row that are within [x0, x1]
+        uint32_t columns = ((1u << (x1 - bx + 1)) - 1) & ~((1u << (x0 - bx)) - 1);
+
+        int32_t qy0 = y0 & ~1;
+        int64_t e_row[3];
+        for(int k = 0; k < 3; k++)
+            e_row[k] = e_block[k] + (qy0 - by) * step_y[k];
+
+        uint32_t pixel_samples = (1u << _samples) - 1;
+
+        for(int32_t qy = qy0; qy <= y1; qy += 2){
+            uint32_t coverage[2];
+            uint64_t samples[2] = {};
+            float w[2][3][block_size];
+
+            for(int r = 0; r < 2; r++){
+                int64_t e[3] = {e_row[0], e_row[1], e_row[2]};
+
+                uint32_t mask = 0;
+                for(int32_t i = 0; i < block_size; i += width){
+                    mask |= (_edge_kernel.function(setup, e, block) & ((1u << width) - 1)) << i;
+
+                    std::copy(block.w0, block.w0 + width, &w[r][0][i]);
+                    std::copy(block.w1, block.w1 + width, &w[r][1][i]);
+                    std::copy(block.w2, block.w2 + width, &w[r][2][i]);
+
+                    for(int k = 0; k < 3; k++)
+                        e[k] += kernel_step_x[k];
+                }
+
+                if(_samples > 1){
+                    samples[r] = inside ? ~uint64_t{0} : sample_coverage(sample_setup, e_row, step_x, block);
+
+                    mask = 0;
+                    for(int32_t i = 0; i < block_size; i++)
+                        mask |= (((samples[r] >> (i * _samples)) & pixel_samples) != 0) << i;
+                }
+
+                int32_t y = qy + r;
+                coverage[r] = (y < y0 || y > y1) ? 0 : ((inside ? ~0u : mask) & columns);
+
+                for(int k = 0; k < 3; k++)
+                    e_row[k] += step_y[k];
+            }
+
+            if(!(coverage[0] | coverage[1]))
+                continue;
+
+            for(int32_t qx = 0; qx < block_size; qx += 2){
+                uint32_t mask = ((coverage[0] >> qx) & 3) | (((coverage[1] >> qx) & 3) << 2);
+                if(!mask)
+                    continue;
+
+                const float quad_w[3][4] = {
+                    {w[0][0][qx], w[0][0][qx + 1], w[1][0][qx], w[1][0][qx + 1]},
+                    {w[0][1][qx], w[0][1][qx + 1], w[1][1][qx], w[1][1][qx + 1]},
+                    {w[0][2][qx], w[0][2][qx + 1], w[1][2][qx], w[1][2][qx + 1]}
+                };
+
+                uint32_t quad_samples[4];
+                for(int i = 0; i < 4; i++){
+                    if(_samples == 1)
+                        quad_samples[i] = (mask >> i) & 1;
+                    else
+                        quad_samples[i] = ((mask >> i) & 1) ? (samples[i >> 1] >> ((qx + (i & 1)) * _samples)) & pixel_samples : 0;
+                }
+
+                covered(bx + qx, qy, mask, quad_w, quad_samples);
+            }
+        }
+    }
+
     VkPipelineRasterizationStateCreateInfo _info;
+
+    uint32_t _samples = 1;
+    const SampleOffset* _sample_offsets = standard_sample_offsets(1);
+    Point _sample_min{0, 0}, _sample_max{0, 0}; // Bounds of the sample offsets in subpixels
+
+    EdgeKernel _edge_kernel = select_edge_kernel();
+};
+
+// Viewports and scissors set by vkCmdSetViewport and vkCmdSetScissor. They are command buffer state, so they survive binding
+// another pipeline and every draw gets them along with the vertex buffers
+struct DynamicState {
+    std::vector<VkViewport> viewports;
+    std::vector<VkRect2D> scissors;
+
+    void set_viewports(uint32_t first, uint32_t count, const VkViewport* new_viewports){
+        if(viewports.size() < first + count)
+            viewports.resize(first + count);
+        std::copy(new_viewports, new_viewports + count, viewports.begin() + first);
+    }
+
+    void set_scissors(uint32_t first, uint32_t count, const VkRect2D* new_scissors){
+        if(scissors.size() < first + count)
+            scissors.resize(first + count);
+        std::copy(new_scissors, new_scissors + count, scissors.begin() + first);
+    }
 };
 
 struct Pipeline {
@@ -133,27 +655,50 @@ struct Pipeline {
         assert(info.pMultisampleState);
         assert(info.pDepthStencilState);
         assert(info.pViewportState);
-        assert(info.pDynamicState);
 
-        blender = Blender{*info.pColorBlendState};
-        rasterizer = Rasterizer{*info.pRasterizationState};
+        assert(info.pInputAssemblyState);
+        const auto& input_assembly = *info.pInputAssemblyState;
+        assert(input_assembly.sType == VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO);
+        assert(input_assembly.flags == 0);
+        assert(input_assembly.topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST); // TODO: Support other topologies
+        assert(input_assembly.primitiveRestartEnable == false); // TODO: Support Primitive Restart
 
-        const auto& dynamic = *info.pDynamicState;
-        assert(dynamic.sType == VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO);
-        assert(dynamic.flags == 0);
+        assert(info.pVertexInputState);
+        vertex_input = VertexInput{*info.pVertexInputState};
 
-        assert(dynamic.dynamicStateCount == 0); // TODO: Implement Dynamic States
+        interpolator = Interpolator{std::vector<Interpolation>{}}; // TODO: Varyings and their decorations come from the shader stages
+
+        blenders.clear();
+        for(uint32_t i = 0; i < info.pColorBlendState->attachmentCount; i++)
+            blenders.emplace_back(*info.pColorBlendState, i);
+        rasterizer = Rasterizer{*info.pRasterizationState, info.pMultisampleState->rasterizationSamples};
+
+        dynamic_viewport = false;
+        dynamic_scissor = false;
+        if(info.pDynamicState){
+            const auto& dynamic = *info.pDynamicState;
+            assert(dynamic.sType == VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO);
+            assert(dynamic.flags == 0);
+
+            for(size_t i = 0; i < dynamic.dynamicStateCount; i++){
+                switch (dynamic.pDynamicStates[i]) {
+                    case VK_DYNAMIC_STATE_VIEWPORT: dynamic_viewport = true; break;
+                    case VK_DYNAMIC_STATE_SCISSOR: dynamic_scissor = true; break;
+                    default: assert(!"Unsupported VkDynamicState"); // TODO: Implement the other Dynamic States
+                }
+            }
+        }
 
         const auto& viewport = *info.pViewportState;
         assert(viewport.sType == VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO);
         assert(viewport.flags == 0);
+        assert(viewport.viewportCount == 1 && viewport.scissorCount == 1); // TODO: Support Multiple Viewports
 
-        // TODO: Ignore these if dynamic state is enabled
-        for(size_t i = 0; i < viewport.viewportCount; i++)
-            viewports.push_back(viewport.pViewports[i]);
-
-        for(size_t i = 0; i < viewport.scissorCount; i++)
-            scissors.push_back(viewport.pScissors[i]);
+        // Dynamic ones come from the DynamicState of the command buffer that draws
+        if(!dynamic_viewport)
+            viewports.assign(viewport.pViewports, viewport.pViewports + viewport.viewportCount);
+        if(!dynamic_scissor)
+            scissors.assign(viewport.pScissors, viewport.pScissors + viewport.scissorCount);
 
         const auto& multisample = *info.pMultisampleState;
         assert(multisample.sType == VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO);
@@ -162,7 +707,7 @@ struct Pipeline {
         assert(multisample.alphaToOneEnable == false);
         assert(multisample.alphaToCoverageEnable == false);
         assert(multisample.sampleShadingEnable == false);
-        assert(multisample.rasterizationSamples == VK_SAMPLE_COUNT_1_BIT);
+        assert(multisample.pSampleMask == nullptr); // TODO: Support Sample Masks
 
         const auto& depth_stencil = *info.pDepthStencilState;
         assert(depth_stencil.sType == VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO);
@@ -170,45 +715,463 @@ struct Pipeline {
 
         assert(depth_stencil.depthTestEnable == true); // TODO: Support disabling depth test
         depth_test_op = depth_stencil.depthCompareOp;
+        EntryPointProperties fragment_shader{}; // TODO: Reported by the SpirvJit of the fragment stage
+        draw_tile = select_draw_tile(depth_test_op, select_depth_stage(fragment_shader));
         assert(depth_stencil.depthWriteEnable == true); // TODO: Support disabling depth write
         assert(depth_stencil.depthBoundsTestEnable == false); // TODO: Support Depth Bound test
         assert(depth_stencil.stencilTestEnable == false); // TODO: Support Stencil test
     }
 
-    void draw(/* TODO */){
-        auto viewport_transform = [](glm::vec3 ndc) -> glm::vec3 { return glm::vec3{0}; /* TODO */ };
+    // Draws are recorded into the current subpass of `pass` and rendered when it ends
+    void draw(RenderPassInstance& pass, const std::vector<VertexBufferBinding>& vertex_buffers, const DynamicState& dynamic, uint32_t vertex_count, uint32_t first_vertex){
+        std::vector<uint32_t> indices(vertex_count);
+        std::iota(indices.begin(), indices.end(), first_vertex);
 
-        auto v0_clip = glm::vec4{0}; // TODO: Invoke Vertex Shader
-        auto v0_ndc = glm::xyz(v0_clip) / v0_clip.w; // Clip Space -> NDC space by perspective division
-        auto v0_screen = viewport_transform(v0_ndc); // NDC -> Screen space by Viewport Transform
+        std::vector<glm::vec4> vertices_clip{}, varyings{};
+        shade_vertices(vertex_buffers, indices.data(), indices.size(), vertices_clip, varyings);
 
-        // Same as above
-        auto v1_clip = glm::vec4{0};
-        auto v1_ndc = glm::xyz(v1_clip) / v1_clip.w;
-        auto v1_screen = viewport_transform(v1_ndc);
+        std::iota(indices.begin(), indices.end(), 0);
+        draw_primitives(pass, dynamic, vertices_clip, varyings, indices);
+    }
 
-        auto v2_clip = glm::vec4{0};
-        auto v2_ndc = glm::xyz(v2_clip) / v2_clip.w;
-        auto v2_screen = viewport_transform(v2_ndc);
+    void draw_indexed(RenderPassInstance& pass, const std::vector<VertexBufferBinding>& vertex_buffers, const DynamicState& dynamic, Buffer& index_buffer, VkDeviceSize offset, VkIndexType index_type, uint32_t index_count, uint32_t first_index, int32_t vertex_offset){
+        switch (index_type) {
+            case VK_INDEX_TYPE_UINT16: draw_indexed_with((const uint16_t*)index_buffer.addr(offset) + first_index, pass, vertex_buffers, dynamic, index_count, vertex_offset); break;
+            case VK_INDEX_TYPE_UINT32: draw_indexed_with((const uint32_t*)index_buffer.addr(offset) + first_index, pass, vertex_buffers, dynamic, index_count, vertex_offset); break;
+            default: assert(!"Unsupported VkIndexType");
+        }
+    }
+    
+    private:
+    template<typename I>
+    void draw_indexed_with(const I* indices, RenderPassInstance& pass, const std::vector<VertexBufferBinding>& vertex_buffers, const DynamicState& dynamic, uint32_t index_count, int32_t vertex_offset){
+        // Only whole triangles are drawn
+        index_count -= index_count % 3;
+
+        // Per thread rather than per pipeline, so command buffers recording draws with the same pipeline don't share batches
+        thread_local VertexCache vertex_cache{};
+
+        std::vector<glm::vec4> vertices_clip{}, varyings{};
+        std::vector<uint32_t> corners{};
+        corners.reserve(index_count);
+
+        for(uint32_t start = 0; start < index_count; start += VertexCache::batch_size){
+            auto count = std::min<size_t>(VertexCache::batch_size, index_count - start);
+            const auto& batch = vertex_cache.assemble(indices + start, count, vertex_offset);
 
-        rasterizer(viewports[0], v0_screen, v1_screen, v2_screen, [this](size_t screen_x, size_t screen_y, float z){
-            if(apply_compare_op(depth_test_op, z, 0.0f /* Read from FB */)){
-                /* Write Z to FB */
+            uint32_t base = vertices_clip.size();
+            shade_vertices(vertex_buffers, batch.vertices.data(), batch.vertices.size(), vertices_clip, varyings);
+
+            for(auto corner : batch.corners)
+                corners.push_back(base + corner);
+        }
+
+        draw_primitives(pass, dynamic, vertices_clip, varyings, corners);
+    }
 
-                auto fragment = glm::vec4{}; // Invoke Fragment Shader
-                auto blended = blender(fragment, {} /* Read from FB */);
-                // Write `blended` to FB
+    // Fetches and shades the vertices `indices[0, count)` VertexBatch::lanes at a time.
+    // Their clip space positions are appended to `out`, and their outputs to `varyings`, interpolator.n_varyings() per vertex
+    void shade_vertices(const std::vector<VertexBufferBinding>& vertex_buffers, const uint32_t* indices, size_t count, std::vector<glm::vec4>& out, std::vector<glm::vec4>& varyings){
+        auto n_varyings = interpolator.n_varyings();
+        thread_local VertexBatch vertex_batch{}; // Not in the pipeline, which command buffers share
+
+        out.reserve(out.size() + count);
+        varyings.reserve(varyings.size() + count * n_varyings);
+
+        for(size_t start = 0; start < count; start += VertexBatch::lanes){
+            vertex_batch.count = std::min(VertexBatch::lanes, count - start);
+            std::copy(indices + start, indices + start + vertex_batch.count, vertex_batch.vertex_index);
+
+            vertex_input.fetch(vertex_buffers, vertex_batch);
+
+            // TODO: Invoke Vertex Shader, one instance runs across all lanes of the batch
+            for(auto& component : vertex_batch.position)
+                std::fill(component, component + VertexBatch::lanes, 0.0f);
+            for(size_t i = 0; i < n_varyings; i++)
+                for(auto& component : vertex_batch.outputs[i])
+                    std::fill(component, component + VertexBatch::lanes, 0.0f);
+
+            for(uint32_t lane = 0; lane < vertex_batch.count; lane++){
+                out.push_back(glm::vec4{vertex_batch.position[0][lane], vertex_batch.position[1][lane], vertex_batch.position[2][lane], vertex_batch.position[3][lane]});
+
+                for(size_t i = 0; i < n_varyings; i++){
+                    const auto& output = vertex_batch.outputs[i];
+                    varyings.push_back(glm::vec4{output[0][lane], output[1][lane], output[2][lane], output[3][lane]});
+                }
             }
-	    });
+        }
     }
 
-    
-    private:
+    // Every 3 consecutive `corners` index a triangle in `vertices_clip`.
+    // Vertices created by clipping are appended to `vertices_clip` and `varyings`
+    void draw_primitives(RenderPassInstance& pass, const DynamicState& dynamic, std::vector<glm::vec4>& vertices_clip, std::vector<glm::vec4>& varyings, const std::vector<uint32_t>& corners){
+        assert((!dynamic_viewport || !dynamic.viewports.empty()) && (!dynamic_scissor || !dynamic.scissors.empty()));
+        const auto& viewport = dynamic_viewport ? dynamic.viewports[0] : viewports[0];
+        const auto& scissor = dynamic_scissor ? dynamic.scissors[0] : scissors[0];
+
+        auto viewport_transform = [&viewport](glm::vec3 ndc) -> glm::vec3 {
+            return glm::vec3{viewport.x + (ndc.x + 1) * (viewport.width / 2),
+                             viewport.y + (ndc.y + 1) * (viewport.height / 2),
+                             viewport.minDepth + ndc.z * (viewport.maxDepth - viewport.minDepth)};
+        };
+
+        auto to_screen = [&](const glm::vec4& v_clip) -> glm::vec3 {
+            auto v_ndc = glm::xyz(v_clip) / v_clip.w; // Clip Space -> NDC space by perspective division
+            return viewport_transform(v_ndc); // NDC -> Screen space by Viewport Transform
+        };
+
+        // Shared vertices are only classified and transformed once, the screen position is only used if the vertex needs no clipping
+        Clipper clipper{viewport};
+        std::vector<uint32_t> outcodes(vertices_clip.size());
+        std::vector<glm::vec3> vertices_screen(vertices_clip.size());
+        for(size_t i = 0; i < vertices_clip.size(); i++){
+            outcodes[i] = clipper.outcode(vertices_clip[i]);
+            vertices_screen[i] = to_screen(vertices_clip[i]);
+        }
+
+        auto n_varyings = interpolator.n_varyings();
+
+        std::vector<Triangle> triangles{};
+        triangles.reserve(corners.size() / 3);
+        for(size_t i = 0; (i + 2) < corners.size(); i += 3){
+            uint32_t a = corners[i], b = corners[i + 1], c = corners[i + 2];
+
+            auto emit = [&](const Triangle& tri){
+                if(!rasterizer.culled(tri))
+                    triangles.push_back(tri);
+            };
+
+            // Clip space is where varyings are linear, so new vertices get them from the weights of the original ones
+            auto add_vertex = [&](const ClipVertex& v) -> uint32_t {
+                for(size_t j = 0; j < n_varyings; j++)
+                    varyings.push_back(v.weights.x * varyings[a * n_varyings + j] + v.weights.y * varyings[b * n_varyings + j] + v.weights.z * varyings[c * n_varyings + j]);
+
+                vertices_clip.push_back(v.position);
+                return vertices_clip.size() - 1;
+            };
+
+            switch (Clipper::classify(outcodes[a], outcodes[b], outcodes[c])) {
+                case Clipper::Result::Reject: break;
+                case Clipper::Result::Accept:
+                    emit(Triangle{vertices_screen[a], vertices_screen[b], vertices_screen[c], {a, b, c}, a});
+                    break;
+                case Clipper::Result::Clip:
+                    clipper.clip(vertices_clip[a], vertices_clip[b], vertices_clip[c], outcodes[a] | outcodes[b] | outcodes[c], [&](const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2){
+                        emit(Triangle{to_screen(v0.position), to_screen(v1.position), to_screen(v2.position), {add_vertex(v0), add_vertex(v1), add_vertex(v2)}, a});
+                    });
+                    break;
+            }
+        }
+
+        auto& pool = render_thread_pool();
+
+        // Binning and rasterization never leave the draw area, so pixels outside of it are never visited
+        auto area = clamp_render_area(viewport, scissor, pass.render_area());
+        if(area.extent.width == 0 || area.extent.height == 0)
+            return;
+
+        // Kept alive by the recorded draw until the render pass ends
+        auto work = std::make_shared<DrawWork>();
+        work->area = area;
+        work->binner.bin(pool, pass.grid(), area, triangles);
+
+        // Interpolation setup happens once per triangle, not once per tile it touches
+        auto n_planes = interpolator.planes_per_triangle();
+        auto& planes = work->planes;
+        planes.resize(triangles.size() * n_planes);
+        pool.parallel_for((triangles.size() + TileBinner::chunk_size - 1) / TileBinner::chunk_size, [&](size_t chunk){
+            size_t end = std::min(triangles.size(), (chunk + 1) * TileBinner::chunk_size);
+            for(size_t i = chunk * TileBinner::chunk_size; i < end; i++){
+                const auto& tri = triangles[i];
+
+                const glm::vec3 p[3] = {tri.v0, tri.v1, tri.v2};
+                const float w[3] = {vertices_clip[tri.vertices[0]].w, vertices_clip[tri.vertices[1]].w, vertices_clip[tri.vertices[2]].w};
+                const glm::vec4* v[3] = {varyings.data() + tri.vertices[0] * n_varyings, varyings.data() + tri.vertices[1] * n_varyings, varyings.data() + tri.vertices[2] * n_varyings};
+                interpolator.setup(p, w, v, &planes[i * n_planes]);
+            }
+        });
+
+        work->triangles = std::move(triangles);
+        work->varyings = std::move(varyings);
+
+        // Every tile is owned by exactly one thread, so depth testing and blending within it needs no synchronization
+        pass.record([this, work](size_t tile, TileTargets& targets){
+            (this->*draw_tile)(tile, *work, targets);
+        });
+    }
+
+    // Pixels that are within the viewport, the scissor and the render area
+    static VkRect2D clamp_render_area(const VkViewport& viewport, const VkRect2D& scissor, const VkRect2D& render_area){
+        int64_t x0 = std::floor(std::min(viewport.x, viewport.x + viewport.width));
+        int64_t y0 = std::floor(std::min(viewport.y, viewport.y + viewport.height));
+        int64_t x1 = std::ceil(std::max(viewport.x, viewport.x + viewport.width));
+        int64_t y1 = std::ceil(std::max(viewport.y, viewport.y + viewport.height));
+
+        x0 = std::max<int64_t>({x0, scissor.offset.x, render_area.offset.x});
+        y0 = std::max<int64_t>({y0, scissor.offset.y, render_area.offset.y});
+        x1 = std::min<int64_t>({x1, (int64_t)scissor.offset.x + scissor.extent.width, (int64_t)render_area.offset.x + render_area.extent.width});
+        y1 = std::min<int64_t>({y1, (int64_t)scissor.offset.y + scissor.extent.height, (int64_t)render_area.offset.y + render_area.extent.height});
+
+        if(x1 <= x0 || y1 <= y0)
+            return VkRect2D{};
+
+        return VkRect2D{{(int32_t)x0, (int32_t)y0}, {(uint32_t)(x1 - x0), (uint32_t)(y1 - y0)}};
+    }
+
+    static VkRect2D intersect(const VkRect2D& a, const VkRect2D& b){
+        int32_t x0 = std::max(a.offset.x, b.offset.x), y0 = std::max(a.offset.y, b.offset.y);
+        int32_t x1 = std::min<int64_t>((int64_t)a.offset.x + a.extent.width, (int64_t)b.offset.x + b.extent.width);
+        int32_t y1 = std::min<int64_t>((int64_t)a.offset.y + a.extent.height, (int64_t)b.offset.y + b.extent.height);
+
+        if(x1 <= x0 || y1 <= y0)
+            return VkRect2D{};
+
+        return VkRect2D{{x0, y0}, {(uint32_t)(x1 - x0), (uint32_t)(y1 - y0)}};
+    }
+
+    // Everything the tiles of a draw read, binned against the grid of the render pass
+    struct DrawWork {
+        std::vector<Triangle> triangles;
+        std::vector<Plane> planes; // interpolator.planes_per_triangle() per triangle
+        std::vector<glm::vec4> varyings;
+
+        TileBinner binner;
+        VkRect2D area; // Viewport and scissor within the render area
+    };
+
+    using DrawTileFunction = void (Pipeline::*)(size_t, const DrawWork&, TileTargets&);
+
+    // Instantiated per depth compare op, so the per pixel depth test is a single comparison, and per depth stage
+    template<VkCompareOp DepthOp, DepthStage Stage>
+    void draw_tile_with(size_t tile, const DrawWork& work, TileTargets& targets){
+        auto region = intersect(work.binner.tile_rect(tile), work.area);
+        if(region.extent.width == 0 || region.extent.height == 0)
+            return;
+
+        assert(targets.depth); // TODO: Subpasses without depth
+        assert(targets.n_colour == blenders.size());
+        auto& depth = *targets.depth;
+        assert(depth.samples() == rasterizer.samples());
+        for(uint32_t c = 0; c < targets.n_colour; c++)
+            assert(!targets.colour[c] || targets.colour[c]->samples() == rasterizer.samples());
+
+        // A tile no triangle touches keeps its attachments as they are, a cleared one can then stay a clear
+        if(work.binner.empty(tile))
+            return;
+
+        for(uint32_t c = 0; c < targets.n_colour; c++)
+            if(targets.colour[c])
+                targets.colour[c]->mark_written();
+        depth.mark_written();
+
+        thread_local TileFragments fragments{};
+        fragments.resize(targets.n_colour);
+
+        glm::vec4 inputs[4][max_varyings];
+        auto n_planes = interpolator.planes_per_triangle();
+
+        // Keeps the samples in `coverage` that pass and writes their depth if `write`, returns the lanes that have samples left
+        auto depth_test = [&](const Quad& quad, uint32_t (&coverage)[4], const float (&z)[4][max_samples], bool write) -> uint32_t {
+            uint32_t live = 0;
+            for(int i = 0; i < 4; i++){
+                if(!coverage[i])
+                    continue;
+
+                int32_t x = quad.x + (i & 1), y = quad.y + (i >> 1);
+
+                uint32_t passed = 0;
+                for(uint32_t samples = coverage[i]; samples; samples &= samples - 1){
+                    uint32_t s = __builtin_ctz(samples);
+
+                    auto& stored_z = *(float*)depth.addr(x, y, s);
+                    if(compare_op<DepthOp>(z[i][s], stored_z)){
+                        if(write)
+                            stored_z = z[i][s];
+                        passed |= 1 << s;
+                    }
+                }
+
+                if(write && passed)
+                    depth.mark_dirty(x, y);
+
+                coverage[i] = passed;
+                live |= (passed != 0) << i;
+            }
+            return live;
+        };
+
+        work.binner.for_each(tile, [&](uint32_t i){
+            const auto& tri = work.triangles[i];
+
+            // Reject triangles that are entirely occluded within this tile before evaluating any edge.
+            // A late depth stage has to shade occluded fragments too, for their side effects or because the shader decides their depth
+            if constexpr (Stage != DepthStage::Late) {
+                auto min_z = std::min(tri.v0.z, std::min(tri.v1.z, tri.v2.z));
+                auto max_z = std::max(tri.v0.z, std::max(tri.v1.z, tri.v2.z));
+                if(!HiZBuffer::may_pass<DepthOp>(min_z, max_z, depth.tile_range()))
+                    return;
+            }
+
+            auto block_visible = [&](int32_t x, int32_t y, float min_z, float max_z) -> bool {
+                if constexpr (Stage == DepthStage::Late)
+                    return true;
+                return HiZBuffer::may_pass<DepthOp>(min_z, max_z, depth.block_range(x, y));
+            };
+
+            const auto* planes = &work.planes[i * n_planes];
+            for(auto& lane : inputs)
+                interpolator.begin(work.varyings.data() + tri.provoking * interpolator.n_varyings(), lane);
+
+            rasterizer(region, tri.v0, tri.v1, tri.v2, [&](const Quad& quad){
+                uint32_t live = quad.mask;
+                uint32_t coverage[4] = {quad.coverage[0], quad.coverage[1], quad.coverage[2], quad.coverage[3]};
+                if constexpr (Stage != DepthStage::Late) {
+                    live = depth_test(quad, coverage, quad.z, Stage == DepthStage::Early);
+                    if(!live)
+                        return;
+                }
+
+                // Helper lanes get inputs too, derivatives are differences between the lanes of a quad
+                glm::vec4 fragments_out[4][max_colour_attachments];
+                for(int i = 0; i < 4; i++){
+                    interpolator.interpolate(planes, quad.x + (i & 1) + 0.5f - tri.v0.x, quad.y + (i >> 1) + 0.5f - tri.v0.y, inputs[i]);
+                    for(uint32_t c = 0; c < targets.n_colour; c++)
+                        fragments_out[i][c] = glm::vec4{}; // TODO: Invoke Fragment Shader with `inputs` on all 4 lanes of the quad, one output per location
+                }
+
+                uint32_t discarded = 0; // TODO: Lanes the fragment shader discarded
+                live &= ~discarded;
+                for(int i = 0; i < 4; i++)
+                    if(!((live >> i) & 1))
+                        coverage[i] = 0;
+
+                if constexpr (Stage == DepthStage::EarlyTest) {
+                    // Nothing else touches these pixels in between, so the samples still pass
+                    depth_test(quad, coverage, quad.z, true);
+                } else if constexpr (Stage == DepthStage::Late) {
+                    const auto& z = quad.z; // TODO: FragDepth written by the fragment shader
+                    live = depth_test(quad, coverage, z, true);
+                }
+
+                // Shaded once per pixel, the colour goes to every sample that passed
+                for(; live; live &= live - 1){
+                    int i = __builtin_ctz(live);
+                    int32_t tx = quad.x + (i & 1) - region.offset.x, ty = quad.y + (i >> 1) - region.offset.y;
+
+                    for(uint32_t c = 0; c < targets.n_colour; c++)
+                        pack_unorm8((uint8_t*)&fragments.colour(c)[ty * tile_size + tx], fragments_out[i][c]);
+                    fragments.samples[ty * tile_size + tx] = coverage[i];
+                    fragments.rows[ty] |= uint64_t{1} << tx;
+                }
+            }, block_visible);
+
+            // A triangle covers every pixel at most once, so blending can wait until all of its fragments are known.
+            // Each row is then blended in runs of consecutive texels, into every colour attachment
+            for(uint32_t ty = 0; ty < region.extent.height; ty++){
+                auto rows = fragments.rows[ty];
+                fragments.rows[ty] = 0;
+
+                for(uint32_t c = 0; c < targets.n_colour; c++){
+                    if(!targets.colour[c])
+                        continue;
+
+                    auto& color = *targets.colour[c];
+                    const auto& blender = blenders[c];
+
+                    auto mask = rows;
+                    if(color.samples() != VK_SAMPLE_COUNT_1_BIT)
+                        mask = blend_samples(fragments, c, color, region, ty, mask);
+
+                    while(mask){
+                        int32_t start = __builtin_ctzll(mask);
+                        auto run = mask >> start;
+                        int32_t length = (~run == 0) ? 64 : __builtin_ctzll(~run);
+
+                        blender.blend_unorm8(&fragments.colour(c)[ty * tile_size + start], color.addr(region.offset.x + start, region.offset.y + ty), length);
+
+                        mask &= (length == 64) ? 0 : ~(((uint64_t{1} << length) - 1) << start);
+                    }
+                }
+            }
+        });
+    }
+
+    // Fragment colours of the triangle that is being drawn into a tile, as packed R8G8B8A8_UNORM per colour attachment of the subpass
+    struct TileFragments {
+        std::vector<uint32_t> colours; // One tile_size * tile_size plane per colour attachment
+        uint8_t samples[tile_size * tile_size]; // Samples of the pixel that passed
+        uint64_t rows[tile_size]; // Bit per pixel that passed the depth test
+
+        void resize(uint32_t count){ colours.resize(count * tile_size * tile_size); }
+        uint32_t* colour(uint32_t attachment){ return &colours[attachment * tile_size * tile_size]; }
+        const uint32_t* colour(uint32_t attachment) const { return &colours[attachment * tile_size * tile_size]; }
+    };
+    static_assert(tile_size <= 64, "Tile rows need to fit a 64-bit mask");
+    static_assert(max_samples <= 8, "Sample masks need to fit a byte");
+
+    // Multisampled colour. Pixels that had all samples written and are compressed, or become compressed because the blend doesn't read
+    // the destination, only need sample 0 and are returned to be blended in runs. The others are decompressed and blended sample by sample
+    uint64_t blend_samples(const TileFragments& fragments, uint32_t attachment, TileAttachment& color, const VkRect2D& region, uint32_t ty, uint64_t mask){
+        const auto& blender = blenders[attachment];
+        uint32_t all_samples = (1u << color.samples()) - 1;
+
+        uint64_t runs = 0;
+        for(; mask; mask &= mask - 1){
+            int32_t tx = __builtin_ctzll(mask);
+            int32_t x = region.offset.x + tx, y = region.offset.y + ty;
+            const auto* colour = &fragments.colour(attachment)[ty * tile_size + tx];
+
+            uint32_t samples = fragments.samples[ty * tile_size + tx];
+            if(samples == all_samples && (color.compressed(x, y) || blender.replaces())){
+                color.set_compressed(x, y);
+                runs |= uint64_t{1} << tx;
+                continue;
+            }
+
+            color.decompress(x, y);
+            for(; samples; samples &= samples - 1)
+                blender.blend_unorm8(colour, color.addr(x, y, __builtin_ctz(samples)), 1);
+        }
+
+        return runs;
+    }
+
+    template<DepthStage Stage>
+    static DrawTileFunction select_draw_tile(VkCompareOp depth_op){
+        switch (depth_op) {
+            case VK_COMPARE_OP_NEVER: return &Pipeline::draw_tile_with<VK_COMPARE_OP_NEVER, Stage>;
+            case VK_COMPARE_OP_ALWAYS: return &Pipeline::draw_tile_with<VK_COMPARE_OP_ALWAYS, Stage>;
+            case VK_COMPARE_OP_LESS: return &Pipeline::draw_tile_with<VK_COMPARE_OP_LESS, Stage>;
+            case VK_COMPARE_OP_LESS_OR_EQUAL: return &Pipeline::draw_tile_with<VK_COMPARE_OP_LESS_OR_EQUAL, Stage>;
+            case VK_COMPARE_OP_GREATER: return &Pipeline::draw_tile_with<VK_COMPARE_OP_GREATER, Stage>;
+            case VK_COMPARE_OP_GREATER_OR_EQUAL: return &Pipeline::draw_tile_with<VK_COMPARE_OP_GREATER_OR_EQUAL, Stage>;
+            case VK_COMPARE_OP_EQUAL: return &Pipeline::draw_tile_with<VK_COMPARE_OP_EQUAL, Stage>;
+            case VK_COMPARE_OP_NOT_EQUAL: return &Pipeline::draw_tile_with<VK_COMPARE_OP_NOT_EQUAL, Stage>;
+            default: assert(!"Illegal VkCompareOp"); return nullptr;
+        }
+    }
+
+    static DrawTileFunction select_draw_tile(VkCompareOp depth_op, DepthStage stage){
+        switch (stage) {
+            case DepthStage::Early: return select_draw_tile<DepthStage::Early>(depth_op);
+            case DepthStage::EarlyTest: return select_draw_tile<DepthStage::EarlyTest>(depth_op);
+            case DepthStage::Late: return select_draw_tile<DepthStage::Late>(depth_op);
+        }
+        return nullptr;
+    }
+
+    // Static ones, dynamic ones are only known when drawing
+    bool dynamic_viewport, dynamic_scissor;
     std::vector<VkViewport> viewports;
     std::vector<VkRect2D> scissors;
 
     VkCompareOp depth_test_op;
+    DrawTileFunction draw_tile;
 
     Rasterizer rasterizer;
-    Blender blender;
+    std::vector<Blender> blenders; // Per colour attachment of the subpass
+
+    VertexInput vertex_input;
+
+    Interpolator interpolator;
 };
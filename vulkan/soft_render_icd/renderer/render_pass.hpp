@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+#include "../../../vulkan-headers/include/vulkan/vulkan.h"
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+struct RenderPass {
+    // Attachment indices into the render pass, VK_ATTACHMENT_UNUSED where a reference is unused
+    struct Subpass {
+        std::vector<uint32_t> colour;
+        std::vector<uint32_t> resolve; // Empty, or one per colour attachment
+        std::vector<uint32_t> input;
+        uint32_t depth = VK_ATTACHMENT_UNUSED;
+    };
+
+    RenderPass(const VkRenderPassCreateInfo& info) {
+        assert(info.sType == VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO);
+        assert(info.flags == 0);
+
+        _attachments.assign(info.pAttachments, info.pAttachments + info.attachmentCount);
+        for(const auto& attachment : _attachments){
+            assert(attachment.flags == 0); // TODO: Support aliasing attachments
+            assert(attachment.format == VK_FORMAT_R8G8B8A8_UNORM || attachment.format == VK_FORMAT_D32_SFLOAT);
+        }
+
+        auto indices = [](const VkAttachmentReference* references, uint32_t count) -> std::vector<uint32_t> {
+            std::vector<uint32_t> ret(count);
+            for(uint32_t i = 0; i < count; i++)
+                ret[i] = references[i].attachment;
+            return ret;
+        };
+
+        for(uint32_t i = 0; i < info.subpassCount; i++){
+            const auto& description = info.pSubpasses[i];
+            assert(description.flags == 0);
+            assert(description.pipelineBindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+            Subpass subpass{};
+            subpass.colour = indices(description.pColorAttachments, description.colorAttachmentCount);
+            if(description.pResolveAttachments)
+                subpass.resolve = indices(description.pResolveAttachments, description.colorAttachmentCount);
+            subpass.input = indices(description.pInputAttachments, description.inputAttachmentCount);
+            if(description.pDepthStencilAttachment)
+                subpass.depth = description.pDepthStencilAttachment->attachment;
+
+            _subpasses.push_back(std::move(subpass));
+        }
+
+        // Dependencies need no handling: Subpasses run one after another on a tile, and a tile only ever belongs to one thread
+    }
+
+    const VkAttachmentDescription& attachment(size_t i) const {
+        assert(i < _attachments.size());
+
+        return _attachments[i];
+    }
+
+    size_t n_attachments() const {
+        return _attachments.size();
+    }
+
+    const Subpass& subpass(size_t i) const {
+        assert(i < _subpasses.size());
+
+        return _subpasses[i];
+    }
+
+    size_t n_subpasses() const {
+        return _subpasses.size();
+    }
+
+    private:
+    std::vector<VkAttachmentDescription> _attachments;
+    std::vector<Subpass> _subpasses;
+};
\ No newline at end of file
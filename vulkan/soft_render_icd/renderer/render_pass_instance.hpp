@@ -0,0 +1,161 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+#include "../../../vulkan-headers/include/vulkan/vulkan.h"
+
+#include "binner.hpp"
+#include "framebuffer.hpp"
+#include "render_pass.hpp"
+#include "thread_pool.hpp"
+#include "tile_buffer.hpp"
+
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+// Everything between vkCmdBeginRenderPass and vkCmdEndRenderPass.
+// Draws are only binned when recorded, the render pass then runs tile by tile: every tile loads its attachments once, runs all subpasses
+// on them in a TileBuffer and stores them once. Attachments that are cleared or don't care are never read from memory,
+// and attachments that aren't stored, e.g. a transient depth buffer, are never written to it
+class RenderPassInstance {
+    public:
+    // Renders a draw into a single tile of the current subpass
+    using TileDraw = std::function<void(size_t tile, TileTargets& targets)>;
+
+    RenderPassInstance(const VkRenderPassBeginInfo& info) {
+        assert(info.sType == VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO);
+
+        _render_pass = (RenderPass*)info.renderPass; // RenderPass handles are pointers to the RenderPass
+        _framebuffer = (Framebuffer*)info.framebuffer;
+        assert(_framebuffer->n_attachments() == _render_pass->n_attachments());
+
+        // Nothing outside of the render area is touched, not even by the loads and stores
+        auto extent = _framebuffer->extent();
+        int32_t x0 = std::max(info.renderArea.offset.x, 0), y0 = std::max(info.renderArea.offset.y, 0);
+        int32_t x1 = std::min<int64_t>((int64_t)info.renderArea.offset.x + info.renderArea.extent.width, extent.width);
+        int32_t y1 = std::min<int64_t>((int64_t)info.renderArea.offset.y + info.renderArea.extent.height, extent.height);
+        _render_area = (x1 > x0 && y1 > y0) ? VkRect2D{{x0, y0}, {(uint32_t)(x1 - x0), (uint32_t)(y1 - y0)}} : VkRect2D{};
+        _grid = TileGrid{_render_area};
+
+        _clear_values.resize(_render_pass->n_attachments());
+        for(uint32_t i = 0; i < info.clearValueCount && i < _clear_values.size(); i++)
+            _clear_values[i] = info.pClearValues[i];
+
+        _draws.resize(_render_pass->n_subpasses());
+        _id = _next_id.fetch_add(1) + 1;
+    }
+
+    // vkCmdNextSubpass
+    void next_subpass(){
+        assert((_subpass + 1) < _render_pass->n_subpasses());
+
+        _subpass++;
+    }
+
+    // Adds a draw to the current subpass, `draw` is called for every tile of the render area once the render pass ends
+    void record(TileDraw draw){
+        _draws[_subpass].push_back(std::move(draw));
+    }
+
+    // vkCmdEndRenderPass, every tile runs on a single thread from the first load to the last store
+    void end(){
+        assert((_subpass + 1) == _render_pass->n_subpasses());
+
+        render_thread_pool().parallel_for(_grid.n_tiles(), [&](size_t tile){
+            thread_local TileBuffer tile_buffer{};
+            run_tile(tile, tile_buffer);
+        });
+
+        for(auto& draws : _draws)
+            draws.clear();
+    }
+
+    Framebuffer& framebuffer(){
+        return *_framebuffer;
+    }
+
+    const RenderPass& render_pass() const {
+        return *_render_pass;
+    }
+
+    const VkRect2D& render_area() const {
+        return _render_area;
+    }
+
+    const TileGrid& grid() const {
+        return _grid;
+    }
+
+    uint32_t subpass() const {
+        return _subpass;
+    }
+
+    private:
+    void run_tile(size_t tile, TileBuffer& tile_buffer){
+        auto region = _grid.tile_rect(tile);
+        if(region.extent.width == 0 || region.extent.height == 0)
+            return;
+
+        tile_buffer.configure(*_render_pass, _id);
+
+        int32_t tile_x = region.offset.x - region.offset.x % tile_size, tile_y = region.offset.y - region.offset.y % tile_size;
+        for(size_t i = 0; i < _render_pass->n_attachments(); i++){
+            auto& attachment = tile_buffer[i];
+            attachment.begin(tile_x, tile_y);
+
+            switch (_render_pass->attachment(i).loadOp) {
+                case VK_ATTACHMENT_LOAD_OP_LOAD: attachment.load((*_framebuffer)[i].image(), region); break;
+                case VK_ATTACHMENT_LOAD_OP_CLEAR: attachment.clear(Image::clear_texel(_render_pass->attachment(i).format, _clear_values[i]), region); break;
+                case VK_ATTACHMENT_LOAD_OP_DONT_CARE: attachment.discard(); break;
+                default: assert(!"Unsupported VkAttachmentLoadOp");
+            }
+        }
+
+        for(uint32_t s = 0; s < _render_pass->n_subpasses(); s++){
+            const auto& subpass = _render_pass->subpass(s);
+
+            auto attachment = [&](uint32_t i) -> TileAttachment* {
+                return (i == VK_ATTACHMENT_UNUSED) ? nullptr : &tile_buffer[i];
+            };
+
+            assert(subpass.colour.size() <= max_colour_attachments && subpass.input.size() <= max_input_attachments);
+
+            TileTargets targets{};
+            for(auto colour : subpass.colour)
+                targets.colour[targets.n_colour++] = attachment(colour);
+            targets.depth = attachment(subpass.depth);
+            for(auto input : subpass.input)
+                targets.inputs[targets.n_inputs++] = attachment(input);
+
+            for(auto& draw : _draws[s])
+                draw(tile, targets);
+
+            for(size_t i = 0; i < subpass.resolve.size(); i++)
+                if(subpass.resolve[i] != VK_ATTACHMENT_UNUSED && subpass.colour[i] != VK_ATTACHMENT_UNUSED)
+                    tile_buffer[subpass.colour[i]].resolve(tile_buffer[subpass.resolve[i]], region);
+        }
+
+        for(size_t i = 0; i < _render_pass->n_attachments(); i++){
+            switch (_render_pass->attachment(i).storeOp) {
+                case VK_ATTACHMENT_STORE_OP_STORE: tile_buffer[i].store((*_framebuffer)[i].image(), region); break;
+                case VK_ATTACHMENT_STORE_OP_DONT_CARE: break;
+                default: assert(!"Unsupported VkAttachmentStoreOp");
+            }
+        }
+    }
+
+    RenderPass* _render_pass;
+    Framebuffer* _framebuffer;
+
+    VkRect2D _render_area;
+    TileGrid _grid;
+
+    std::vector<VkClearValue> _clear_values;
+
+    uint32_t _subpass = 0;
+    std::vector<std::vector<TileDraw>> _draws; // Per subpass, in recording order
+
+    uint64_t _id; // Tells TileBuffers apart that were laid out for another render pass instance
+    static inline std::atomic<uint64_t> _next_id{0};
+};
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+
+// Runtime CPU feature detection, the driver is built for baseline x86-64 and picks wider paths per function
+enum class SimdLevel { Scalar, SSE41, AVX2, AVX512 };
+
+inline SimdLevel detect_simd_level(){
+    #if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+    else if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX2;
+    else if(__builtin_cpu_supports("sse4.1"))
+        return SimdLevel::SSE41;
+    #endif
+
+    return SimdLevel::Scalar;
+}
+
+inline SimdLevel simd_level(){
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+template<>
+struct format::formatter<SimdLevel> {
+	template<typename OutputIt>
+	static void format(format::format_output_it<OutputIt>& it, [[maybe_unused]] format::format_args args, SimdLevel item){
+        switch (item) {
+            case SimdLevel::Scalar: it.write("Scalar"); break;
+            case SimdLevel::SSE41: it.write("SSE4.1"); break;
+            case SimdLevel::AVX2: it.write("AVX2"); break;
+            case SimdLevel::AVX512: it.write("AVX-512"); break;
+        }
+    }
+};
\ No newline at end of file
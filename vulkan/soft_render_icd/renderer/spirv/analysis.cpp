@@ -0,0 +1,160 @@
+#include "jit.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+// Collects what every function does in a single pass over the module, entry points then get the union over all functions they can call.
+// Only needs a handful of instructions, so it doesn't depend on the rest of the module being supported. Function calls can refer to functions defined later,
+// which is why entry points are only resolved at the end
+void SpirvJit::analyze_entry_points(const uint32_t* instructions, const uint32_t* limit){
+    struct Function {
+        EntryPointProperties properties;
+        std::vector<spv::Id> callees;
+    };
+
+    std::unordered_map<spv::Id, Function> functions;
+    std::unordered_map<spv::Id, EntryPointProperties> modes; // Execution modes of each entry point
+
+    std::unordered_map<spv::Id, spv::StorageClass> pointer_types;
+    std::unordered_map<spv::Id, spv::StorageClass> pointers; // Storage class of every pointer a result has
+    std::unordered_set<spv::Id> frag_depth; // FragDepth variables, and access chains into them
+
+    auto store = [&](Function* function, spv::Id pointer){
+        assert(function);
+
+        if(frag_depth.count(pointer))
+            function->properties.writes_depth = true;
+
+        auto it = pointers.find(pointer);
+        if(it == pointers.end())
+            return;
+
+        switch (it->second) {
+            case spv::StorageClass::Uniform: // Only BufferBlock decorated ones can be stored to
+            case spv::StorageClass::StorageBuffer:
+            case spv::StorageClass::PhysicalStorageBuffer:
+            case spv::StorageClass::CrossWorkgroup:
+            case spv::StorageClass::Image:
+                function->properties.side_effects = true;
+                break;
+            default:
+                break;
+        }
+    };
+
+    Function* function = nullptr;
+    for(uint32_t len; instructions < limit; instructions += len){
+        auto op = (spv::Op)(instructions[0] & spv::OpCodeMask);
+        len = instructions[0] >> spv::WordCountShift;
+        const uint32_t* data = instructions + 1;
+
+        if(len == 0)
+            throw std::runtime_error("JIT: Invalid instruction length");
+
+        switch (op) {
+            case spv::Op::OpEntryPoint:
+                modes[data[1]];
+                break;
+            case spv::Op::OpExecutionMode:
+                if((spv::ExecutionMode)data[1] == spv::ExecutionMode::EarlyFragmentTests)
+                    modes[data[0]].early_fragment_tests = true;
+                if((spv::ExecutionMode)data[1] == spv::ExecutionMode::DepthReplacing)
+                    modes[data[0]].writes_depth = true;
+                break;
+            case spv::Op::OpDecorate:
+                if((spv::Decoration)data[1] == spv::Decoration::BuiltIn && (spv::BuiltIn)data[2] == spv::BuiltIn::FragDepth)
+                    frag_depth.insert(data[0]);
+                break;
+            case spv::Op::OpTypePointer:
+                pointer_types[data[0]] = (spv::StorageClass)data[1];
+                break;
+
+            // Everything that can produce a pointer, its storage class comes from the result type
+            case spv::Op::OpAccessChain:
+            case spv::Op::OpInBoundsAccessChain:
+            case spv::Op::OpPtrAccessChain:
+            case spv::Op::OpInBoundsPtrAccessChain:
+            case spv::Op::OpCopyObject:
+                if(frag_depth.count(data[2]))
+                    frag_depth.insert(data[1]);
+                [[fallthrough]];
+            case spv::Op::OpVariable:
+            case spv::Op::OpFunctionParameter:
+            case spv::Op::OpImageTexelPointer:
+            case spv::Op::OpPhi:
+            case spv::Op::OpSelect:
+                if(auto it = pointer_types.find(data[0]); it != pointer_types.end())
+                    pointers[data[1]] = it->second;
+                break;
+
+            case spv::Op::OpFunction:
+                function = &functions[data[1]];
+                break;
+            case spv::Op::OpFunctionEnd:
+                function = nullptr;
+                break;
+            case spv::Op::OpFunctionCall:
+                function->callees.push_back(data[2]);
+                break;
+
+            case spv::Op::OpKill:
+            case spv::Op::OpDemoteToHelperInvocationEXT:
+                function->properties.discards = true;
+                break;
+
+            case spv::Op::OpStore:
+            case spv::Op::OpCopyMemory:
+            case spv::Op::OpCopyMemorySized:
+                store(function, data[0]);
+                break;
+
+            case spv::Op::OpImageWrite:
+            case spv::Op::OpAtomicStore:
+            case spv::Op::OpAtomicExchange:
+            case spv::Op::OpAtomicCompareExchange:
+            case spv::Op::OpAtomicCompareExchangeWeak:
+            case spv::Op::OpAtomicIIncrement:
+            case spv::Op::OpAtomicIDecrement:
+            case spv::Op::OpAtomicIAdd:
+            case spv::Op::OpAtomicISub:
+            case spv::Op::OpAtomicSMin:
+            case spv::Op::OpAtomicUMin:
+            case spv::Op::OpAtomicSMax:
+            case spv::Op::OpAtomicUMax:
+            case spv::Op::OpAtomicAnd:
+            case spv::Op::OpAtomicOr:
+            case spv::Op::OpAtomicXor:
+            case spv::Op::OpAtomicFlagTestAndSet:
+            case spv::Op::OpAtomicFlagClear:
+                function->properties.side_effects = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    for(const auto& [id, mode] : modes){
+        auto& properties = variables[id].entry_point.properties;
+        properties = mode;
+
+        std::unordered_set<spv::Id> visited{id};
+        std::vector<spv::Id> stack{id};
+        while(!stack.empty()){
+            auto it = functions.find(stack.back());
+            stack.pop_back();
+
+            if(it == functions.end())
+                continue;
+
+            const auto& callee = it->second.properties;
+            properties.discards |= callee.discards;
+            properties.writes_depth |= callee.writes_depth;
+            properties.side_effects |= callee.side_effects;
+
+            for(auto next : it->second.callees)
+                if(visited.insert(next).second)
+                    stack.push_back(next);
+        }
+    }
+}
\ No newline at end of file
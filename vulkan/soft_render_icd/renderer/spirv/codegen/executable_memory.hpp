@@ -0,0 +1,59 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+// Pages holding generated machine code. They are written while mapped read-write and then flipped to read-execute,
+// so no page is ever writable and executable at the same time
+class ExecutableMemory {
+    public:
+    ExecutableMemory() = default;
+    ExecutableMemory(const std::vector<uint8_t>& code) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        _size = (code.size() + page - 1) / page * page;
+        if(_size == 0)
+            return;
+
+        void* memory = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(memory == MAP_FAILED)
+            throw std::runtime_error("JIT: Failed to map code memory");
+
+        memcpy(memory, code.data(), code.size());
+        if(mprotect(memory, _size, PROT_READ | PROT_EXEC) != 0){
+            munmap(memory, _size);
+            throw std::runtime_error("JIT: Failed to make code memory executable");
+        }
+
+        _memory = (uint8_t*)memory;
+    }
+
+    ExecutableMemory(const ExecutableMemory&) = delete;
+    ExecutableMemory& operator=(const ExecutableMemory&) = delete;
+
+    ExecutableMemory(ExecutableMemory&& other) noexcept: _memory{std::exchange(other._memory, nullptr)}, _size{std::exchange(other._size, 0)} {}
+    ExecutableMemory& operator=(ExecutableMemory&& other) noexcept {
+        std::swap(_memory, other._memory);
+        std::swap(_size, other._size);
+        return *this;
+    }
+
+    ~ExecutableMemory() {
+        if(_memory)
+            munmap(_memory, _size);
+    }
+
+    template<typename F>
+    F entry(size_t offset) const {
+        return (F)(_memory + offset);
+    }
+
+    private:
+    uint8_t* _memory = nullptr;
+    size_t _size = 0;
+};
\ No newline at end of file
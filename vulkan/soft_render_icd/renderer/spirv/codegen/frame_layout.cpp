@@ -0,0 +1,146 @@
+#include "frame_layout.hpp"
+
+#include <unordered_set>
+
+FrameLayout::FrameLayout(const SpirvJit& code, spv::Id entry_point): _code{code}, _entry_function{entry_point} {
+    const auto& entry = code.variables[entry_point];
+    if(entry.type != SpirvJit::Var::Type::EntryPoint)
+        throw std::runtime_error("JIT: Not an entry point");
+
+    auto n = code.variables.size();
+    _slots.resize(n);
+    _types.resize(n, 0);
+    _phi_shadows.resize(n, none);
+    _return_slots.resize(code.functions.size(), none);
+
+    for(spv::Id id = 0; id < n; id++){
+        const auto& var = code.variables[id];
+        if(var.type == SpirvJit::Var::Type::Constant){
+            flatten_constant(id);
+        } else if(var.type == SpirvJit::Var::Type::Variable){
+            _types[id] = var.variable.type;
+
+            switch (var.variable.storage) {
+                case spv::StorageClass::Input:
+                case spv::StorageClass::Output:
+                case spv::StorageClass::Private:
+                case spv::StorageClass::Function:
+                    _slots[id] = Slot{Storage::Frame, allocate(words(pointee(var.variable.type)))};
+                    break;
+                default:
+                    break; // TODO: Descriptors and push constants, backends reject accesses to them
+            }
+        }
+    }
+
+    for(auto id : entry.interface)
+        add_interface(id);
+
+    // Functions reachable from the entry point
+    std::unordered_set<size_t> visited{entry.function.index};
+    _functions.push_back(entry.function.index);
+    for(size_t i = 0; i < _functions.size(); i++){
+        for(const auto& block : code.functions[_functions[i]].blocks){
+            for(const auto& instruction : block.instructions){
+                if(instruction.op != spv::Op::OpFunctionCall)
+                    continue;
+
+                auto callee = code.variables[instruction.operands[0]].function.index;
+                if(visited.insert(callee).second)
+                    _functions.push_back(callee);
+            }
+        }
+    }
+
+    for(auto index : _functions){
+        const auto& function = code.functions[index];
+
+        if(auto return_words = words(function.return_type); return_words > 0)
+            _return_slots[index] = allocate(return_words);
+
+        for(size_t i = 0; i < function.parameters.size(); i++){
+            auto type = function.parameter_types[i];
+            _types[function.parameters[i]] = type;
+            _slots[function.parameters[i]] = Slot{Storage::Frame, allocate(is_pointer(type) ? 1 : words(type))};
+        }
+
+        for(const auto& block : function.blocks){
+            for(const auto& instruction : block.instructions){
+                if(!instruction.result || !instruction.type)
+                    continue;
+
+                auto id = instruction.result;
+                _types[id] = instruction.type;
+
+                uint32_t result_words;
+                if(instruction.op == spv::Op::OpVariable)
+                    result_words = words(pointee(instruction.type));
+                else if(is_pointer(instruction.type))
+                    result_words = 1;
+                else
+                    result_words = words(instruction.type);
+
+                if(result_words > 0)
+                    _slots[id] = Slot{Storage::Frame, allocate(result_words)};
+
+                // Incoming values go here on each edge, and are copied to the result when the block starts. All phis of a block then read the values before any of them changed
+                if(instruction.op == spv::Op::OpPhi)
+                    _phi_shadows[id] = allocate(result_words);
+            }
+        }
+    }
+}
+
+void FrameLayout::flatten_constant(spv::Id id){
+    if(_slots[id].storage != Storage::None)
+        return;
+
+    const auto& constant = _code.variables[id].constant;
+    _types[id] = constant.type;
+
+    std::vector<uint32_t> value;
+    if(!constant.constituents.empty()){
+        for(auto constituent : constant.constituents){
+            flatten_constant(constituent);
+
+            auto begin = _constants.begin() + _slots[constituent].offset;
+            value.insert(value.end(), begin, begin + words(_types[constituent]));
+        }
+    } else if(words(constant.type) == 1){
+        value.push_back(constant.unsigned_int);
+    } else {
+        value.resize(words(constant.type), 0); // OpConstantNull and OpUndef
+    }
+
+    _slots[id] = Slot{Storage::Constant, (uint32_t)_constants.size()};
+    _constants.insert(_constants.end(), value.begin(), value.end());
+}
+
+void FrameLayout::add_interface(spv::Id id){
+    const auto& var = _code.variables[id];
+    if(var.type != SpirvJit::Var::Type::Variable)
+        return;
+
+    auto storage = var.variable.storage;
+    if(storage != spv::StorageClass::Input && storage != spv::StorageClass::Output)
+        return;
+
+    auto type = pointee(var.variable.type);
+    auto offset = _slots[id].offset;
+
+    if(auto it = var.decorations.find(spv::Decoration::BuiltIn); it != var.decorations.end()){
+        _interface.push_back(InterfaceVariable{storage, none, (spv::BuiltIn)it->second.word, offset, words(type)});
+    } else if(auto it = var.decorations.find(spv::Decoration::Location); it != var.decorations.end()){
+        _interface.push_back(InterfaceVariable{storage, it->second.word, spv::BuiltIn::Max, offset, words(type)});
+    } else if(_code.variables[type].type_var.type == SpirvJit::Var::TypeVar::Type::Struct){
+        const auto& members = _code.variables[type].structure.members;
+        for(uint32_t i = 0; i < _code.variables[type].interface.size(); i++){
+            auto member = members.find(i);
+            if(member == members.end())
+                continue;
+
+            if(auto it = member->second.decorations.find(spv::Decoration::BuiltIn); it != member->second.decorations.end())
+                _interface.push_back(InterfaceVariable{storage, none, (spv::BuiltIn)it->second.word, offset + member_offset(type, i), words(member_type(type, i))});
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "../jit.hpp"
+#include "../type_info.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// Pointers can't be stored or selected between in logical addressing, so where they point is mostly known before running.
+// Dynamic indices and pointer parameters add a runtime word offset on top
+struct FramePointer {
+    uint32_t offset;
+    uint32_t dynamic; // Frame word holding the runtime part, FrameLayout::none if there is none
+    spv::Id type; // Pointee
+};
+
+// Where every value of an entry point lives while an invocation runs, in 32 bit words.
+// Each result, variable, parameter and return value has its own words in a per invocation frame, constants are flattened into a pool shared by all invocations.
+// SPIR-V forbids recursion, so every function can keep its values at fixed offsets no matter who calls it
+class FrameLayout {
+    public:
+    static constexpr uint32_t killed_word = 0; // Non-zero once the invocation executed OpKill
+    static constexpr uint32_t none = ~0u;
+
+    enum class Storage { None, Frame, Constant };
+
+    struct Slot {
+        Storage storage = Storage::None;
+        uint32_t offset = 0;
+    };
+
+    // Input and Output variables of the entry point, builtins inside of blocks like gl_PerVertex get one each
+    struct InterfaceVariable {
+        spv::StorageClass storage;
+        uint32_t location; // `none` for builtins
+        spv::BuiltIn builtin;
+        uint32_t offset;
+        uint32_t words;
+    };
+
+    FrameLayout(const SpirvJit& code, spv::Id entry_point);
+
+    spv::Id entry_function() const {
+        return _entry_function;
+    }
+
+    // Functions the entry point can reach, indices into SpirvJit::functions. The entry function comes first
+    const std::vector<size_t>& functions() const {
+        return _functions;
+    }
+
+    uint32_t size() const {
+        return _size;
+    }
+
+    const std::vector<uint32_t>& constants() const {
+        return _constants;
+    }
+
+    const std::vector<InterfaceVariable>& interface() const {
+        return _interface;
+    }
+
+    // Results of pointer type only get a word for their dynamic part, see the backends.
+    // Variables get their pointee, their slot is what the pointer points to
+    const Slot& slot(spv::Id id) const {
+        return _slots[id];
+    }
+
+    uint32_t phi_shadow(spv::Id phi) const {
+        return _phi_shadows[phi];
+    }
+
+    uint32_t return_slot(size_t function) const {
+        return _return_slots[function];
+    }
+
+    spv::Id type_of(spv::Id id) const {
+        return _types[id];
+    }
+
+    // Type helpers, see type_info.hpp
+    uint32_t words(spv::Id type) const {
+        return type_words(_code, type);
+    }
+
+    bool is_pointer(spv::Id type) const {
+        return is_pointer_type(_code, type);
+    }
+
+    spv::Id pointee(spv::Id pointer_type) const {
+        return pointee_type(_code, pointer_type);
+    }
+
+    ScalarKind scalar(spv::Id type) const {
+        return scalar_kind(_code, type);
+    }
+
+    uint32_t components(spv::Id type) const {
+        return type_components(_code, type);
+    }
+
+    spv::Id member_type(spv::Id type, uint32_t index) const {
+        return ::member_type(_code, type, index);
+    }
+
+    uint32_t member_offset(spv::Id type, uint32_t index) const {
+        return ::member_offset(_code, type, index);
+    }
+
+    private:
+    uint32_t allocate(uint32_t words){
+        auto offset = _size;
+        _size += words;
+        return offset;
+    }
+
+    void flatten_constant(spv::Id id);
+    void add_interface(spv::Id variable);
+
+    const SpirvJit& _code;
+    spv::Id _entry_function;
+    std::vector<size_t> _functions;
+
+    uint32_t _size = 1; // killed_word
+    std::vector<uint32_t> _constants;
+    std::vector<InterfaceVariable> _interface;
+
+    std::vector<Slot> _slots;
+    std::vector<spv::Id> _types;
+    std::vector<uint32_t> _phi_shadows;
+    std::vector<uint32_t> _return_slots;
+};
\ No newline at end of file
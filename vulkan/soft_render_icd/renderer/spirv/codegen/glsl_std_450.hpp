@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// Instructions of the GLSL.std.450 extended instruction set, the subset the backends implement
+enum class Glsl : uint32_t {
+    Round = 1, RoundEven = 2, Trunc = 3, FAbs = 4, SAbs = 5, FSign = 6, Floor = 8, Ceil = 9, Fract = 10, Radians = 11, Degrees = 12,
+    Sin = 13, Cos = 14, Tan = 15, Asin = 16, Acos = 17, Atan = 18, Sinh = 19, Cosh = 20, Tanh = 21, Asinh = 22, Acosh = 23, Atanh = 24, Atan2 = 25,
+    Pow = 26, Exp = 27, Log = 28, Exp2 = 29, Log2 = 30, Sqrt = 31, InverseSqrt = 32,
+    FMin = 37, UMin = 38, SMin = 39, FMax = 40, UMax = 41, SMax = 42, FClamp = 43, UClamp = 44, SClamp = 45, FMix = 46, Step = 48, SmoothStep = 49, Fma = 50,
+    Length = 66, Distance = 67, Cross = 68, Normalize = 69, FaceForward = 70, Reflect = 71,
+    NMin = 79, NMax = 80, NClamp = 81
+};
\ No newline at end of file
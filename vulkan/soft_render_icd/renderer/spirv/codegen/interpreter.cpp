@@ -0,0 +1,838 @@
+#include "interpreter.hpp"
+#include "interpreter_handlers.hpp"
+#include "glsl_std_450.hpp"
+#include "../opcode_table.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+    using namespace interpreter_handlers;
+    using Handler = InterpretedShader::Handler;
+    using Instruction = InterpretedShader::Instruction;
+
+    MapFunction map_function(Glsl op){
+        switch (op) {
+            case Glsl::Round: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::round(fl(a))); };
+            case Glsl::RoundEven: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::nearbyint(fl(a))); };
+            case Glsl::Trunc: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::trunc(fl(a))); };
+            case Glsl::Floor: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::floor(fl(a))); };
+            case Glsl::Ceil: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::ceil(fl(a))); };
+            case Glsl::Fract: return [](uint32_t a, uint32_t, uint32_t){ return bits(fl(a) - std::floor(fl(a))); };
+            case Glsl::Sin: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::sin(fl(a))); };
+            case Glsl::Cos: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::cos(fl(a))); };
+            case Glsl::Tan: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::tan(fl(a))); };
+            case Glsl::Asin: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::asin(fl(a))); };
+            case Glsl::Acos: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::acos(fl(a))); };
+            case Glsl::Atan: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::atan(fl(a))); };
+            case Glsl::Sinh: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::sinh(fl(a))); };
+            case Glsl::Cosh: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::cosh(fl(a))); };
+            case Glsl::Tanh: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::tanh(fl(a))); };
+            case Glsl::Asinh: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::asinh(fl(a))); };
+            case Glsl::Acosh: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::acosh(fl(a))); };
+            case Glsl::Atanh: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::atanh(fl(a))); };
+            case Glsl::Exp: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::exp(fl(a))); };
+            case Glsl::Log: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::log(fl(a))); };
+            case Glsl::Exp2: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::exp2(fl(a))); };
+            case Glsl::Log2: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::log2(fl(a))); };
+            case Glsl::Sqrt: return [](uint32_t a, uint32_t, uint32_t){ return bits(std::sqrt(fl(a))); };
+            case Glsl::InverseSqrt: return [](uint32_t a, uint32_t, uint32_t){ return bits(1.0f / std::sqrt(fl(a))); };
+            case Glsl::Radians: return [](uint32_t a, uint32_t, uint32_t){ return bits(fl(a) * (float)(M_PI / 180)); };
+            case Glsl::Degrees: return [](uint32_t a, uint32_t, uint32_t){ return bits(fl(a) * (float)(180 / M_PI)); };
+            case Glsl::FAbs: return [](uint32_t a, uint32_t, uint32_t){ return a & 0x7FFFFFFFu; };
+            case Glsl::SAbs: return [](uint32_t a, uint32_t, uint32_t){ return ((int32_t)a < 0) ? 0u - a : a; };
+            case Glsl::FSign: return [](uint32_t a, uint32_t, uint32_t){ return bits((float)(fl(a) > 0) - (float)(fl(a) < 0)); };
+            case Glsl::Atan2: return [](uint32_t a, uint32_t b, uint32_t){ return bits(std::atan2(fl(a), fl(b))); };
+            case Glsl::Pow: return [](uint32_t a, uint32_t b, uint32_t){ return bits(std::pow(fl(a), fl(b))); };
+            case Glsl::FMin: return [](uint32_t a, uint32_t b, uint32_t){ return bits(min_ss(fl(a), fl(b))); };
+            case Glsl::NMin: return [](uint32_t a, uint32_t b, uint32_t){ return bits(non_nan_min(fl(a), fl(b))); };
+            case Glsl::FMax: return [](uint32_t a, uint32_t b, uint32_t){ return bits(max_ss(fl(a), fl(b))); };
+            case Glsl::NMax: return [](uint32_t a, uint32_t b, uint32_t){ return bits(non_nan_max(fl(a), fl(b))); };
+            case Glsl::UMin: return [](uint32_t a, uint32_t b, uint32_t){ return std::min(a, b); };
+            case Glsl::SMin: return [](uint32_t a, uint32_t b, uint32_t){ return (uint32_t)std::min((int32_t)a, (int32_t)b); };
+            case Glsl::UMax: return [](uint32_t a, uint32_t b, uint32_t){ return std::max(a, b); };
+            case Glsl::SMax: return [](uint32_t a, uint32_t b, uint32_t){ return (uint32_t)std::max((int32_t)a, (int32_t)b); };
+            case Glsl::FClamp: return [](uint32_t x, uint32_t lo, uint32_t hi){ return bits(min_ss(max_ss(fl(x), fl(lo)), fl(hi))); };
+            case Glsl::NClamp: return [](uint32_t x, uint32_t lo, uint32_t hi){ return bits(non_nan_min(non_nan_max(fl(x), fl(lo)), fl(hi))); };
+            case Glsl::UClamp: return [](uint32_t x, uint32_t lo, uint32_t hi){ return std::min(std::max(x, lo), hi); };
+            case Glsl::SClamp: return [](uint32_t x, uint32_t lo, uint32_t hi){ return (uint32_t)std::min(std::max((int32_t)x, (int32_t)lo), (int32_t)hi); };
+            case Glsl::FMix: return [](uint32_t x, uint32_t y, uint32_t a){ return bits((fl(y) - fl(x)) * fl(a) + fl(x)); };
+            case Glsl::Step: return [](uint32_t edge, uint32_t x, uint32_t){ return bits((fl(x) < fl(edge)) ? 0.0f : 1.0f); };
+            case Glsl::SmoothStep: return [](uint32_t e0, uint32_t e1, uint32_t x){
+                float t = min_ss(max_ss((fl(x) - fl(e0)) / (fl(e1) - fl(e0)), 0.0f), 1.0f);
+                return bits(t * t * (3.0f - t - t));
+            };
+            case Glsl::Fma: return [](uint32_t a, uint32_t b, uint32_t c){ return bits(fl(a) * fl(b) + fl(c)); };
+            default: return nullptr;
+        }
+    }
+
+    // Turns the function bodies of SpirvJit into Instructions. Pointers are resolved like in the native backend, see FramePointer
+    class Decoder {
+        public:
+        using DecodeFunction = void (Decoder::*)(const SpirvJit::Instruction&);
+
+        Decoder(const SpirvJit& code, const FrameLayout& layout, std::vector<Instruction>& out, std::vector<std::vector<uint32_t>>& tables):
+            _code{code}, _layout{layout}, _out{out}, _tables{tables} {}
+
+        void decode_entry_point(){
+            if(_layout.functions().size() > InterpretedShader::max_call_depth)
+                throw std::runtime_error("JIT: Too many functions for the interpreter");
+
+            for(spv::Id id = 0; id < _code.variables.size(); id++){
+                const auto& var = _code.variables[id];
+                if(var.type != SpirvJit::Var::Type::Variable || _layout.slot(id).storage != FrameLayout::Storage::Frame)
+                    continue;
+
+                auto p = FramePointer{_layout.slot(id).offset, FrameLayout::none, _layout.pointee(var.variable.type)};
+                _pointers[id] = p;
+                if(var.variable.initializer)
+                    copy(p.offset, operand(var.variable.initializer), _layout.words(p.type));
+            }
+
+            auto call = emit(Handler::Call);
+            resolve(_layout.entry_function(), [this, call](uint32_t target){ _out[call].s = target; });
+            emit(Handler::Return);
+
+            for(auto index : _layout.functions()){
+                for(const auto& block : _code.functions[index].blocks)
+                    _blocks[block.label] = &block;
+            }
+
+            for(auto index : _layout.functions())
+                decode_function(index);
+
+            for(const auto& [label, set] : _fixups)
+                set(_labels.at(label));
+        }
+
+        // Decode functions, indexed by opcode in `decode_entries`
+        template<Handler H>
+        void componentwise(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            auto a = operand(ops[0]);
+            auto b = (ops.size() > 1) ? operand(ops[1]) : a;
+            emit(H, words(in), result(in), a, b);
+        }
+
+        template<Handler H>
+        void reduce(const SpirvJit::Instruction& in){
+            emit(H, value_words(in.operands[0]), result(in), operand(in.operands[0]));
+        }
+
+        void negate(const SpirvJit::Instruction& in){
+            emit(Handler::XorImmediate, words(in), result(in), operand(in.operands[0]), 0, 0x80000000u);
+        }
+
+        void multiply_scalar(const SpirvJit::Instruction& in){
+            emit(Handler::FMulScalar, words(in), result(in), operand(in.operands[0]), operand(in.operands[1]));
+        }
+
+        void select(const SpirvJit::Instruction& in){
+            if(_layout.is_pointer(in.type))
+                throw std::runtime_error("JIT: Selecting pointers is unsupported");
+
+            const auto& ops = in.operands;
+            uint32_t stride = (value_words(ops[0]) == 1) ? 0 : 1; // A scalar condition selects whole composites
+            emit(Handler::Select, words(in), result(in), operand(ops[0]), operand(ops[1]), operand(ops[2]), stride);
+        }
+
+        void copy_value(const SpirvJit::Instruction& in){
+            if(_layout.is_pointer(in.type)){
+                _pointers[in.result] = pointer(in.operands[0]);
+                return;
+            }
+            copy(result(in), operand(in.operands[0]), words(in));
+        }
+
+        void nothing(const SpirvJit::Instruction&){}
+
+        void variable(const SpirvJit::Instruction& in){
+            auto p = FramePointer{_layout.slot(in.result).offset, FrameLayout::none, _layout.pointee(in.type)};
+            _pointers[in.result] = p;
+            if(in.operands.size() > 1)
+                copy(p.offset, operand(in.operands[1]), _layout.words(p.type));
+        }
+
+        void load(const SpirvJit::Instruction& in){
+            const auto& p = pointer(in.operands[0]);
+            if(p.dynamic == FrameLayout::none)
+                copy(result(in), p.offset, words(in));
+            else
+                emit(Handler::Load, words(in), result(in), p.offset, 0, 0, p.dynamic);
+        }
+
+        void store(const SpirvJit::Instruction& in){
+            const auto& p = pointer(in.operands[0]);
+            if(p.dynamic == FrameLayout::none)
+                copy(p.offset, operand(in.operands[1]), _layout.words(p.type));
+            else
+                emit(Handler::Store, _layout.words(p.type), 0, p.offset, operand(in.operands[1]), 0, p.dynamic);
+        }
+
+        void copy_memory(const SpirvJit::Instruction& in){
+            const auto& dst = pointer(in.operands[0]);
+            const auto& src = pointer(in.operands[1]);
+            emit(Handler::CopyMemory, _layout.words(dst.type), dst.offset, src.offset, 0, src.dynamic, dst.dynamic);
+        }
+
+        void access_chain(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            auto base = pointer(ops[0]);
+            auto p = FramePointer{base.offset, base.dynamic, base.type};
+
+            for(size_t i = 1; i < ops.size(); i++){
+                const auto& index = _code.variables[ops[i]];
+                if(index.type == SpirvJit::Var::Type::Constant){
+                    p.offset += _layout.member_offset(p.type, index.constant.unsigned_int);
+                    p.type = _layout.member_type(p.type, index.constant.unsigned_int);
+                    continue;
+                }
+
+                // The runtime part accumulates in the result's word, struct indices are always constants
+                auto element = _layout.member_type(p.type, 0);
+                auto dynamic = _layout.slot(in.result).offset;
+                emit(Handler::IndexScale, 1, dynamic, p.dynamic, operand(ops[i]), 0, _layout.words(element));
+                p.dynamic = dynamic;
+                p.type = element;
+            }
+
+            // Without dynamic indices of its own the result shares the base's runtime word
+            _pointers[in.result] = p;
+        }
+
+        void phi(const SpirvJit::Instruction& in){
+            if(_layout.is_pointer(in.type))
+                throw std::runtime_error("JIT: Phis of pointers are unsupported");
+            copy(result(in), _layout.phi_shadow(in.result), words(in));
+        }
+
+        void branch(const SpirvJit::Instruction& in){
+            edge(in.operands[0], nullptr);
+        }
+
+        void branch_conditional(const SpirvJit::Instruction& in){
+            auto at = emit(Handler::Branch, 1, 0, operand(in.operands[0]));
+            edge(in.operands[1], [this, at](uint32_t target){ _out[at].b = target; });
+            edge(in.operands[2], [this, at](uint32_t target){ _out[at].c = target; });
+        }
+
+        void switch_(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            auto table = _tables.size();
+            _tables.emplace_back();
+
+            uint32_t cases = 0;
+            for(size_t i = 2; i + 1 < ops.size(); i += 2, cases++)
+                _tables[table].insert(_tables[table].end(), {ops[i], 0});
+
+            auto at = emit(Handler::Switch, cases, 0, operand(ops[0]));
+            _out[at].data = (const void*)(uintptr_t)table; // Becomes the table's address once all tables exist
+            edge(ops[1], [this, at](uint32_t target){ _out[at].s = target; });
+            for(uint32_t c = 0; c < cases; c++)
+                edge(ops[3 + 2 * c], [this, table, c](uint32_t target){ _tables[table][2 * c + 1] = target; });
+        }
+
+        void return_(const SpirvJit::Instruction&){
+            emit(Handler::Return);
+        }
+
+        void return_value(const SpirvJit::Instruction& in){
+            copy(_layout.return_slot(_function), operand(in.operands[0]), value_words(in.operands[0]));
+            emit(Handler::Return);
+        }
+
+        void kill(const SpirvJit::Instruction&){
+            emit(Handler::Kill);
+        }
+
+        void function_call(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            auto callee_index = _code.variables[ops[0]].function.index;
+            const auto& callee = _code.functions[callee_index];
+
+            for(size_t i = 0; i < callee.parameters.size(); i++){
+                auto param = _layout.slot(callee.parameters[i]).offset;
+                if(_layout.is_pointer(callee.parameter_types[i])){
+                    const auto& p = pointer(ops[1 + i]);
+                    emit(Handler::PointerArgument, 1, param, p.offset, 0, 0, p.dynamic);
+                } else {
+                    copy(param, operand(ops[1 + i]), _layout.words(callee.parameter_types[i]));
+                }
+            }
+
+            auto call = emit(Handler::Call);
+            resolve(callee.id, [this, call](uint32_t target){ _out[call].s = target; });
+
+            if(_layout.return_slot(callee_index) != FrameLayout::none)
+                copy(result(in), _layout.return_slot(callee_index), words(in));
+        }
+
+        void composite_construct(const SpirvJit::Instruction& in){
+            uint32_t offset = 0;
+            for(auto constituent : in.operands){
+                auto n = value_words(constituent);
+                copy(result(in, offset), operand(constituent), n);
+                offset += n;
+            }
+        }
+
+        void composite_extract(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            auto offset = composite_offset(_layout.type_of(ops[0]), ops.begin() + 1, ops.end());
+            copy(result(in), operand(ops[0], offset), words(in));
+        }
+
+        void composite_insert(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            copy(result(in), operand(ops[1]), words(in));
+            auto offset = composite_offset(in.type, ops.begin() + 2, ops.end());
+            copy(result(in, offset), operand(ops[0]), value_words(ops[0]));
+        }
+
+        void vector_shuffle(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            auto n = value_words(ops[0]);
+            for(uint32_t c = 0; c < words(in); c++){
+                auto component = ops[2 + c];
+                if(component == ~0u)
+                    continue; // Undefined
+                copy(result(in, c), (component < n) ? operand(ops[0], component) : operand(ops[1], component - n), 1);
+            }
+        }
+
+        void extract_dynamic(const SpirvJit::Instruction& in){
+            emit(Handler::ExtractDynamic, 1, result(in), operand(in.operands[0]), operand(in.operands[1]));
+        }
+
+        void insert_dynamic(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            copy(result(in), operand(ops[0]), words(in));
+            emit(Handler::InsertDynamic, 1, result(in), operand(ops[1]), operand(ops[2]));
+        }
+
+        void matrix_times_vector(const SpirvJit::Instruction& in){
+            auto rows = words(in);
+            auto columns = value_words(in.operands[1]);
+            for(uint32_t r = 0; r < rows; r++)
+                emit(Handler::Dot, columns, result(in, r), operand(in.operands[0], r), operand(in.operands[1]), 1, rows);
+        }
+
+        void vector_times_matrix(const SpirvJit::Instruction& in){
+            auto rows = value_words(in.operands[0]);
+            for(uint32_t c = 0; c < words(in); c++)
+                emit(Handler::Dot, rows, result(in, c), operand(in.operands[0]), operand(in.operands[1], c * rows), 1, 1);
+        }
+
+        void matrix_times_matrix(const SpirvJit::Instruction& in){
+            auto rows = _layout.words(_layout.member_type(in.type, 0));
+            auto columns = words(in) / rows;
+            auto inner = value_words(in.operands[0]) / rows;
+            for(uint32_t c = 0; c < columns; c++){
+                for(uint32_t r = 0; r < rows; r++)
+                    emit(Handler::Dot, inner, result(in, c * rows + r), operand(in.operands[0], r), operand(in.operands[1], c * inner), 1, rows);
+            }
+        }
+
+        void dot(const SpirvJit::Instruction& in){
+            emit(Handler::Dot, value_words(in.operands[0]), result(in), operand(in.operands[0]), operand(in.operands[1]), 1, 1);
+        }
+
+        void extended(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            if(_code.variables[ops[0]].extension.name != "GLSL.std.450")
+                throw std::runtime_error("JIT: Unsupported extended instruction set");
+
+            auto op = (Glsl)ops[1];
+            auto arg = [&](size_t i){ return operand(ops[2 + std::min(i, ops.size() - 3)]); };
+            auto n = value_words(ops[2]);
+
+            if(auto function = map_function(op)){
+                auto at = emit(Handler::Map, words(in), result(in), arg(0), arg(1), arg(2));
+                _out[at].data = (const void*)function;
+                return;
+            }
+
+            switch (op) {
+                case Glsl::Length: emit(Handler::Length, n, result(in), arg(0)); break;
+                case Glsl::Distance: emit(Handler::Distance, n, result(in), arg(0), arg(1)); break;
+                case Glsl::Cross: emit(Handler::Cross, 3, result(in), arg(0), arg(1)); break;
+                case Glsl::Normalize: emit(Handler::Normalize, n, result(in), arg(0)); break;
+                case Glsl::Reflect: emit(Handler::Reflect, n, result(in), arg(0), arg(1)); break;
+                case Glsl::FaceForward: emit(Handler::FaceForward, n, result(in), arg(0), arg(1), arg(2)); break;
+                default:
+                    print("JIT: Unsupported GLSL.std.450 instruction: {:d}\n", ops[1]);
+                    throw std::runtime_error("JIT: Unsupported extended instruction");
+            }
+        }
+
+        private:
+        void decode_function(size_t index);
+        void decode(const SpirvJit::Instruction& in);
+
+        uint32_t operand(spv::Id id, uint32_t word = 0) const {
+            const auto& slot = _layout.slot(id);
+            switch (slot.storage) {
+                case FrameLayout::Storage::Frame: return slot.offset + word;
+                case FrameLayout::Storage::Constant: return (slot.offset + word) | InterpretedShader::constant_bit;
+                default:
+                    print("JIT: %{:d} has no value\n", id);
+                    throw std::runtime_error("JIT: Use of a value without storage");
+            }
+        }
+
+        uint32_t result(const SpirvJit::Instruction& in, uint32_t word = 0) const {
+            return _layout.slot(in.result).offset + word;
+        }
+
+        uint32_t words(const SpirvJit::Instruction& in) const {
+            return _layout.words(in.type);
+        }
+
+        uint32_t value_words(spv::Id id) const {
+            return _layout.words(_layout.type_of(id));
+        }
+
+        const FramePointer& pointer(spv::Id id) const {
+            auto it = _pointers.find(id);
+            if(it == _pointers.end()){
+                print("JIT: %{:d} points to an unsupported storage class\n", id);
+                throw std::runtime_error("JIT: Unsupported storage class");
+            }
+            return it->second;
+        }
+
+        template<typename It>
+        uint32_t composite_offset(spv::Id type, It begin, It end) const {
+            uint32_t offset = 0;
+            for(auto it = begin; it != end; ++it){
+                offset += _layout.member_offset(type, *it);
+                type = _layout.member_type(type, *it);
+            }
+            return offset;
+        }
+
+        size_t emit(Handler handler, uint32_t n = 0, uint32_t dst = 0, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0, uint32_t s = 0){
+            _out.push_back(Instruction{nullptr, handler, n, dst, a, b, c, s, nullptr});
+            return _out.size() - 1;
+        }
+
+        void copy(uint32_t dst, uint32_t src, uint32_t n){
+            if(n > 0)
+                emit(Handler::Copy, n, dst, src);
+        }
+
+        // `set` gets the instruction index of `label` once every function is decoded
+        void resolve(spv::Id label, std::function<void(uint32_t)> set){
+            _fixups.emplace_back(label, std::move(set));
+        }
+
+        // Goes from the current block to `target`. Phis of `target` need copies on the way, those go into a stub right here.
+        // Without `set` the edge is taken right away, with it `set` gets where to jump
+        void edge(spv::Id target, std::function<void(uint32_t)> set){
+            bool phis = false;
+            for(const auto& instruction : _blocks.at(target)->instructions){
+                if(instruction.op != spv::Op::OpPhi)
+                    break;
+
+                for(size_t i = 0; i + 1 < instruction.operands.size(); i += 2){
+                    if(instruction.operands[i + 1] != _block->label)
+                        continue;
+
+                    if(set && !phis)
+                        set((uint32_t)_out.size());
+                    phis = true;
+                    copy(_layout.phi_shadow(instruction.result), operand(instruction.operands[i]), words(instruction));
+                }
+            }
+
+            if(set && !phis){
+                resolve(target, std::move(set));
+                return;
+            }
+
+            auto jump = emit(Handler::Jump);
+            resolve(target, [this, jump](uint32_t index){ _out[jump].s = index; });
+        }
+
+        const SpirvJit& _code;
+        const FrameLayout& _layout;
+        std::vector<Instruction>& _out;
+        std::vector<std::vector<uint32_t>>& _tables;
+
+        std::unordered_map<spv::Id, uint32_t> _labels; // Where functions and blocks start
+        std::unordered_map<spv::Id, const SpirvJit::Block*> _blocks;
+        std::unordered_map<spv::Id, FramePointer> _pointers;
+        std::vector<std::pair<spv::Id, std::function<void(uint32_t)>>> _fixups;
+
+        size_t _function = 0;
+        const SpirvJit::Block* _block = nullptr;
+    };
+
+    constexpr OpcodeEntry<Decoder::DecodeFunction> decode_entries[] = {
+        {spv::Op::OpVariable, &Decoder::variable},
+        {spv::Op::OpUndef, &Decoder::nothing},
+        {spv::Op::OpLoad, &Decoder::load},
+        {spv::Op::OpStore, &Decoder::store},
+        {spv::Op::OpCopyMemory, &Decoder::copy_memory},
+        {spv::Op::OpCopyObject, &Decoder::copy_value},
+        {spv::Op::OpAccessChain, &Decoder::access_chain},
+        {spv::Op::OpInBoundsAccessChain, &Decoder::access_chain},
+
+        {spv::Op::OpPhi, &Decoder::phi},
+        {spv::Op::OpSelectionMerge, &Decoder::nothing},
+        {spv::Op::OpLoopMerge, &Decoder::nothing},
+        {spv::Op::OpBranch, &Decoder::branch},
+        {spv::Op::OpBranchConditional, &Decoder::branch_conditional},
+        {spv::Op::OpSwitch, &Decoder::switch_},
+        {spv::Op::OpReturn, &Decoder::return_},
+        {spv::Op::OpReturnValue, &Decoder::return_value},
+        {spv::Op::OpUnreachable, &Decoder::return_},
+        {spv::Op::OpKill, &Decoder::kill},
+        {spv::Op::OpFunctionCall, &Decoder::function_call},
+
+        {spv::Op::OpFAdd, &Decoder::componentwise<Handler::FAdd>},
+        {spv::Op::OpFSub, &Decoder::componentwise<Handler::FSub>},
+        {spv::Op::OpFMul, &Decoder::componentwise<Handler::FMul>},
+        {spv::Op::OpFDiv, &Decoder::componentwise<Handler::FDiv>},
+        {spv::Op::OpFMod, &Decoder::componentwise<Handler::FMod>},
+        {spv::Op::OpFRem, &Decoder::componentwise<Handler::FRem>},
+        {spv::Op::OpFNegate, &Decoder::negate},
+        {spv::Op::OpIAdd, &Decoder::componentwise<Handler::IAdd>},
+        {spv::Op::OpISub, &Decoder::componentwise<Handler::ISub>},
+        {spv::Op::OpIMul, &Decoder::componentwise<Handler::IMul>},
+        {spv::Op::OpSDiv, &Decoder::componentwise<Handler::SDiv>},
+        {spv::Op::OpSRem, &Decoder::componentwise<Handler::SRem>},
+        {spv::Op::OpSMod, &Decoder::componentwise<Handler::SMod>},
+        {spv::Op::OpUDiv, &Decoder::componentwise<Handler::UDiv>},
+        {spv::Op::OpUMod, &Decoder::componentwise<Handler::UMod>},
+        {spv::Op::OpSNegate, &Decoder::componentwise<Handler::SNegate>},
+
+        {spv::Op::OpNot, &Decoder::componentwise<Handler::Not>},
+        {spv::Op::OpBitwiseAnd, &Decoder::componentwise<Handler::And>},
+        {spv::Op::OpBitwiseOr, &Decoder::componentwise<Handler::Or>},
+        {spv::Op::OpBitwiseXor, &Decoder::componentwise<Handler::Xor>},
+        {spv::Op::OpShiftLeftLogical, &Decoder::componentwise<Handler::ShiftLeft>},
+        {spv::Op::OpShiftRightLogical, &Decoder::componentwise<Handler::ShiftRightLogical>},
+        {spv::Op::OpShiftRightArithmetic, &Decoder::componentwise<Handler::ShiftRightArithmetic>},
+
+        {spv::Op::OpIEqual, &Decoder::componentwise<Handler::IEqual>},
+        {spv::Op::OpINotEqual, &Decoder::componentwise<Handler::INotEqual>},
+        {spv::Op::OpSLessThan, &Decoder::componentwise<Handler::SLess>},
+        {spv::Op::OpSLessThanEqual, &Decoder::componentwise<Handler::SLessEqual>},
+        {spv::Op::OpSGreaterThan, &Decoder::componentwise<Handler::SGreater>},
+        {spv::Op::OpSGreaterThanEqual, &Decoder::componentwise<Handler::SGreaterEqual>},
+        {spv::Op::OpULessThan, &Decoder::componentwise<Handler::ULess>},
+        {spv::Op::OpULessThanEqual, &Decoder::componentwise<Handler::ULessEqual>},
+        {spv::Op::OpUGreaterThan, &Decoder::componentwise<Handler::UGreater>},
+        {spv::Op::OpUGreaterThanEqual, &Decoder::componentwise<Handler::UGreaterEqual>},
+        {spv::Op::OpFOrdEqual, &Decoder::componentwise<Handler::FOrdEqual>},
+        {spv::Op::OpFOrdNotEqual, &Decoder::componentwise<Handler::FOrdNotEqual>},
+        {spv::Op::OpFOrdLessThan, &Decoder::componentwise<Handler::FOrdLess>},
+        {spv::Op::OpFOrdGreaterThan, &Decoder::componentwise<Handler::FOrdGreater>},
+        {spv::Op::OpFOrdLessThanEqual, &Decoder::componentwise<Handler::FOrdLessEqual>},
+        {spv::Op::OpFOrdGreaterThanEqual, &Decoder::componentwise<Handler::FOrdGreaterEqual>},
+        {spv::Op::OpFUnordEqual, &Decoder::componentwise<Handler::FUnordEqual>},
+        {spv::Op::OpFUnordNotEqual, &Decoder::componentwise<Handler::FUnordNotEqual>},
+        {spv::Op::OpFUnordLessThan, &Decoder::componentwise<Handler::FUnordLess>},
+        {spv::Op::OpFUnordGreaterThan, &Decoder::componentwise<Handler::FUnordGreater>},
+        {spv::Op::OpFUnordLessThanEqual, &Decoder::componentwise<Handler::FUnordLessEqual>},
+        {spv::Op::OpFUnordGreaterThanEqual, &Decoder::componentwise<Handler::FUnordGreaterEqual>},
+
+        // Booleans are masks, so the logical operations are bitwise ones
+        {spv::Op::OpLogicalAnd, &Decoder::componentwise<Handler::And>},
+        {spv::Op::OpLogicalOr, &Decoder::componentwise<Handler::Or>},
+        {spv::Op::OpLogicalNot, &Decoder::componentwise<Handler::Not>},
+        {spv::Op::OpLogicalEqual, &Decoder::componentwise<Handler::Xnor>},
+        {spv::Op::OpLogicalNotEqual, &Decoder::componentwise<Handler::Xor>},
+        {spv::Op::OpSelect, &Decoder::select},
+        {spv::Op::OpAny, &Decoder::reduce<Handler::Any>},
+        {spv::Op::OpAll, &Decoder::reduce<Handler::All>},
+
+        {spv::Op::OpConvertFToS, &Decoder::componentwise<Handler::FToS>},
+        {spv::Op::OpConvertFToU, &Decoder::componentwise<Handler::FToU>},
+        {spv::Op::OpConvertSToF, &Decoder::componentwise<Handler::SToF>},
+        {spv::Op::OpConvertUToF, &Decoder::componentwise<Handler::UToF>},
+        {spv::Op::OpBitcast, &Decoder::copy_value},
+
+        {spv::Op::OpCompositeConstruct, &Decoder::composite_construct},
+        {spv::Op::OpCompositeExtract, &Decoder::composite_extract},
+        {spv::Op::OpCompositeInsert, &Decoder::composite_insert},
+        {spv::Op::OpVectorShuffle, &Decoder::vector_shuffle},
+        {spv::Op::OpVectorExtractDynamic, &Decoder::extract_dynamic},
+        {spv::Op::OpVectorInsertDynamic, &Decoder::insert_dynamic},
+        {spv::Op::OpVectorTimesScalar, &Decoder::multiply_scalar},
+        {spv::Op::OpMatrixTimesScalar, &Decoder::multiply_scalar},
+        {spv::Op::OpMatrixTimesVector, &Decoder::matrix_times_vector},
+        {spv::Op::OpVectorTimesMatrix, &Decoder::vector_times_matrix},
+        {spv::Op::OpMatrixTimesMatrix, &Decoder::matrix_times_matrix},
+        {spv::Op::OpDot, &Decoder::dot},
+
+        {spv::Op::OpExtInst, &Decoder::extended}
+    };
+
+    using DecodeOpcodes = OpcodeTable<decode_entries>;
+
+    void Decoder::decode_function(size_t index){
+        const auto& function = _code.functions[index];
+        _function = index;
+        _labels[function.id] = (uint32_t)_out.size();
+
+        for(size_t i = 0; i < function.parameters.size(); i++){
+            auto type = function.parameter_types[i];
+            if(_layout.is_pointer(type))
+                _pointers[function.parameters[i]] = FramePointer{0, _layout.slot(function.parameters[i]).offset, _layout.pointee(type)};
+        }
+
+        for(const auto& block : function.blocks){
+            _block = &block;
+            _labels[block.label] = (uint32_t)_out.size();
+
+            for(const auto& instruction : block.instructions)
+                decode(instruction);
+        }
+    }
+
+    void Decoder::decode(const SpirvJit::Instruction& in){
+        auto function = DecodeOpcodes::lookup(in.op);
+        if(!function){
+            print("JIT: Unsupported instruction in function body: {:d}\n", (uint32_t)in.op);
+            throw std::runtime_error("JIT: Unsupported instruction");
+        }
+
+        (this->*function)(in);
+    }
+}
+
+InterpretedShader::InterpretedShader(const SpirvJit& code, spv::Id entry_point): _layout{code, entry_point} {
+    Decoder decoder{code, _layout, _code, _switch_tables};
+    decoder.decode_entry_point();
+
+    auto handlers = execute(nullptr, nullptr, nullptr);
+    for(auto& instruction : _code){
+        instruction.target = handlers[(size_t)instruction.handler];
+        if(instruction.handler == Handler::Switch)
+            instruction.data = _switch_tables[(size_t)(uintptr_t)instruction.data].data();
+    }
+}
+
+const void* const* InterpretedShader::execute(const Instruction* code, uint32_t* frame, const uint32_t* constants){
+    #define X(name) &&name,
+    static const void* const handlers[] = { INTERPRETER_HANDLERS(X) };
+    #undef X
+
+    if(!code)
+        return handlers;
+
+    const uint32_t* const bases[2] = {frame, constants};
+    auto u = [bases](uint32_t operand, uint32_t i){ return bases[operand >> 31][(operand & ~constant_bit) + i]; };
+    auto f = [bases](uint32_t operand, uint32_t i){ return fl(bases[operand >> 31][(operand & ~constant_bit) + i]); };
+    auto dynamic = [frame](uint32_t word){ return (word != FrameLayout::none) ? frame[word] : 0; };
+
+    const Instruction* stack[max_call_depth];
+    size_t depth = 0;
+    const Instruction* ip = code;
+
+    #define DISPATCH() goto *ip->target
+    #define NEXT() do { ip++; DISPATCH(); } while(0)
+    #define COMPONENTWISE(expr) do { for(uint32_t i = 0; i < ip->n; i++) frame[ip->dst + i] = (expr); NEXT(); } while(0)
+    #define MASK(condition) ((condition) ? ~0u : 0u)
+
+    DISPATCH();
+
+    Copy: COMPONENTWISE(u(ip->a, i));
+    FAdd: COMPONENTWISE(bits(f(ip->a, i) + f(ip->b, i)));
+    FSub: COMPONENTWISE(bits(f(ip->a, i) - f(ip->b, i)));
+    FMul: COMPONENTWISE(bits(f(ip->a, i) * f(ip->b, i)));
+    FDiv: COMPONENTWISE(bits(f(ip->a, i) / f(ip->b, i)));
+    FMod: COMPONENTWISE(bits(float_mod(f(ip->a, i), f(ip->b, i))));
+    FRem: COMPONENTWISE(bits(float_rem(f(ip->a, i), f(ip->b, i))));
+    FMulScalar: COMPONENTWISE(bits(f(ip->a, i) * f(ip->b, 0)));
+
+    IAdd: COMPONENTWISE(u(ip->a, i) + u(ip->b, i));
+    ISub: COMPONENTWISE(u(ip->a, i) - u(ip->b, i));
+    IMul: COMPONENTWISE(u(ip->a, i) * u(ip->b, i));
+    // Division by zero gives 0, x / -1 is -x and x % -1 is 0, like in the native backend
+    SDiv: COMPONENTWISE((u(ip->b, i) == 0) ? 0u : (u(ip->b, i) == ~0u) ? 0u - u(ip->a, i) : (uint32_t)((int32_t)u(ip->a, i) / (int32_t)u(ip->b, i)));
+    SRem: COMPONENTWISE((u(ip->b, i) == 0 || u(ip->b, i) == ~0u) ? 0u : (uint32_t)((int32_t)u(ip->a, i) % (int32_t)u(ip->b, i)));
+    SMod: COMPONENTWISE(signed_mod(u(ip->a, i), u(ip->b, i)));
+    UDiv: COMPONENTWISE((u(ip->b, i) == 0) ? 0u : u(ip->a, i) / u(ip->b, i));
+    UMod: COMPONENTWISE((u(ip->b, i) == 0) ? 0u : u(ip->a, i) % u(ip->b, i));
+    SNegate: COMPONENTWISE(0u - u(ip->a, i));
+
+    Not: COMPONENTWISE(~u(ip->a, i));
+    And: COMPONENTWISE(u(ip->a, i) & u(ip->b, i));
+    Or: COMPONENTWISE(u(ip->a, i) | u(ip->b, i));
+    Xor: COMPONENTWISE(u(ip->a, i) ^ u(ip->b, i));
+    Xnor: COMPONENTWISE(~(u(ip->a, i) ^ u(ip->b, i)));
+    AndImmediate: COMPONENTWISE(u(ip->a, i) & ip->c);
+    XorImmediate: COMPONENTWISE(u(ip->a, i) ^ ip->c);
+    // x86 only looks at the lower 5 bits of shift counts
+    ShiftLeft: COMPONENTWISE(u(ip->a, i) << (u(ip->b, i) & 31));
+    ShiftRightLogical: COMPONENTWISE(u(ip->a, i) >> (u(ip->b, i) & 31));
+    ShiftRightArithmetic: COMPONENTWISE((uint32_t)((int32_t)u(ip->a, i) >> (u(ip->b, i) & 31)));
+
+    IEqual: COMPONENTWISE(MASK(u(ip->a, i) == u(ip->b, i)));
+    INotEqual: COMPONENTWISE(MASK(u(ip->a, i) != u(ip->b, i)));
+    SLess: COMPONENTWISE(MASK((int32_t)u(ip->a, i) < (int32_t)u(ip->b, i)));
+    SLessEqual: COMPONENTWISE(MASK((int32_t)u(ip->a, i) <= (int32_t)u(ip->b, i)));
+    SGreater: COMPONENTWISE(MASK((int32_t)u(ip->a, i) > (int32_t)u(ip->b, i)));
+    SGreaterEqual: COMPONENTWISE(MASK((int32_t)u(ip->a, i) >= (int32_t)u(ip->b, i)));
+    ULess: COMPONENTWISE(MASK(u(ip->a, i) < u(ip->b, i)));
+    ULessEqual: COMPONENTWISE(MASK(u(ip->a, i) <= u(ip->b, i)));
+    UGreater: COMPONENTWISE(MASK(u(ip->a, i) > u(ip->b, i)));
+    UGreaterEqual: COMPONENTWISE(MASK(u(ip->a, i) >= u(ip->b, i)));
+    FOrdEqual: COMPONENTWISE(MASK(f(ip->a, i) == f(ip->b, i)));
+    FOrdNotEqual: COMPONENTWISE(MASK(f(ip->a, i) < f(ip->b, i) || f(ip->a, i) > f(ip->b, i)));
+    FOrdLess: COMPONENTWISE(MASK(f(ip->a, i) < f(ip->b, i)));
+    FOrdGreater: COMPONENTWISE(MASK(f(ip->a, i) > f(ip->b, i)));
+    FOrdLessEqual: COMPONENTWISE(MASK(f(ip->a, i) <= f(ip->b, i)));
+    FOrdGreaterEqual: COMPONENTWISE(MASK(f(ip->a, i) >= f(ip->b, i)));
+    FUnordEqual: COMPONENTWISE(MASK(!(f(ip->a, i) < f(ip->b, i) || f(ip->a, i) > f(ip->b, i))));
+    FUnordNotEqual: COMPONENTWISE(MASK(!(f(ip->a, i) == f(ip->b, i))));
+    FUnordLess: COMPONENTWISE(MASK(!(f(ip->a, i) >= f(ip->b, i))));
+    FUnordGreater: COMPONENTWISE(MASK(!(f(ip->a, i) <= f(ip->b, i))));
+    FUnordLessEqual: COMPONENTWISE(MASK(!(f(ip->a, i) > f(ip->b, i))));
+    FUnordGreaterEqual: COMPONENTWISE(MASK(!(f(ip->a, i) < f(ip->b, i))));
+
+    Select: COMPONENTWISE((u(ip->a, i * ip->s) & u(ip->b, i)) | (~u(ip->a, i * ip->s) & u(ip->c, i)));
+    Any: {
+        uint32_t any = 0;
+        for(uint32_t i = 0; i < ip->n; i++)
+            any |= u(ip->a, i);
+        frame[ip->dst] = any;
+        NEXT();
+    }
+    All: {
+        uint32_t all = ~0u;
+        for(uint32_t i = 0; i < ip->n; i++)
+            all &= u(ip->a, i);
+        frame[ip->dst] = all;
+        NEXT();
+    }
+    FToS: COMPONENTWISE(float_to_signed(f(ip->a, i)));
+    FToU: COMPONENTWISE(float_to_unsigned(f(ip->a, i)));
+    SToF: COMPONENTWISE(bits((float)(int32_t)u(ip->a, i)));
+    UToF: COMPONENTWISE(bits((float)u(ip->a, i)));
+
+    // a[k * s] * b[k * c], strides walk matrix rows
+    Dot: {
+        float sum = f(ip->a, 0) * f(ip->b, 0);
+        for(uint32_t k = 1; k < ip->n; k++)
+            sum += f(ip->a, k * ip->s) * f(ip->b, k * ip->c);
+        frame[ip->dst] = bits(sum);
+        NEXT();
+    }
+    ExtractDynamic:
+        frame[ip->dst] = u(ip->a, u(ip->b, 0));
+        NEXT();
+    InsertDynamic:
+        frame[ip->dst + u(ip->b, 0)] = u(ip->a, 0);
+        NEXT();
+
+    Load: {
+        auto base = ip->a + dynamic(ip->s);
+        for(uint32_t i = 0; i < ip->n; i++)
+            frame[ip->dst + i] = frame[base + i];
+        NEXT();
+    }
+    Store: {
+        auto base = ip->a + dynamic(ip->s);
+        for(uint32_t i = 0; i < ip->n; i++)
+            frame[base + i] = u(ip->b, i);
+        NEXT();
+    }
+    CopyMemory: {
+        auto dst = ip->dst + dynamic(ip->s);
+        auto src = ip->a + dynamic(ip->c);
+        for(uint32_t i = 0; i < ip->n; i++)
+            frame[dst + i] = frame[src + i];
+        NEXT();
+    }
+    IndexScale:
+        frame[ip->dst] = dynamic(ip->a) + u(ip->b, 0) * ip->s;
+        NEXT();
+    PointerArgument:
+        frame[ip->dst] = ip->a + dynamic(ip->s);
+        NEXT();
+
+    Map: {
+        auto function = (MapFunction)ip->data;
+        COMPONENTWISE(function(u(ip->a, i), u(ip->b, i), u(ip->c, i)));
+    }
+    Length: {
+        float sum = 0;
+        for(uint32_t i = 0; i < ip->n; i++)
+            sum += f(ip->a, i) * f(ip->a, i);
+        frame[ip->dst] = bits(std::sqrt(sum));
+        NEXT();
+    }
+    Distance: {
+        float sum = 0;
+        for(uint32_t i = 0; i < ip->n; i++)
+            sum += (f(ip->a, i) - f(ip->b, i)) * (f(ip->a, i) - f(ip->b, i));
+        frame[ip->dst] = bits(std::sqrt(sum));
+        NEXT();
+    }
+    Cross: COMPONENTWISE(bits(f(ip->a, (i + 1) % 3) * f(ip->b, (i + 2) % 3) - f(ip->a, (i + 2) % 3) * f(ip->b, (i + 1) % 3)));
+    Normalize: {
+        float sum = 0;
+        for(uint32_t i = 0; i < ip->n; i++)
+            sum += f(ip->a, i) * f(ip->a, i);
+        float scale = 1.0f / std::sqrt(sum);
+        COMPONENTWISE(bits(f(ip->a, i) * scale));
+    }
+    Reflect: {
+        float d = 0;
+        for(uint32_t i = 0; i < ip->n; i++)
+            d += f(ip->b, i) * f(ip->a, i);
+        d += d;
+        COMPONENTWISE(bits(f(ip->a, i) - f(ip->b, i) * d));
+    }
+    FaceForward: {
+        float d = 0;
+        for(uint32_t i = 0; i < ip->n; i++)
+            d += f(ip->c, i) * f(ip->b, i);
+        uint32_t sign = (d < 0) ? 0 : 0x80000000u;
+        COMPONENTWISE(u(ip->a, i) ^ sign);
+    }
+
+    Jump:
+        ip = code + ip->s;
+        DISPATCH();
+    Branch:
+        ip = code + (u(ip->a, 0) ? ip->b : ip->c);
+        DISPATCH();
+    Switch: {
+        auto table = (const uint32_t*)ip->data;
+        auto selector = u(ip->a, 0);
+        auto target = ip->s;
+        for(uint32_t i = 0; i < ip->n; i++){
+            if(table[2 * i] == selector){
+                target = table[2 * i + 1];
+                break;
+            }
+        }
+        ip = code + target;
+        DISPATCH();
+    }
+    Call:
+        stack[depth++] = ip + 1;
+        ip = code + ip->s;
+        DISPATCH();
+    Return:
+        if(depth == 0)
+            return nullptr;
+        ip = stack[--depth];
+        DISPATCH();
+    Kill:
+        frame[FrameLayout::killed_word] = ~0u;
+        return nullptr;
+
+    #undef DISPATCH
+    #undef NEXT
+    #undef COMPONENTWISE
+    #undef MASK
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../jit.hpp"
+#include "frame_layout.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// Baseline execution tier, ready as soon as the module is parsed.
+// Function bodies are decoded once into an array of Instructions, each pointing straight at its handler in execute(), with operands resolved to frame and constant offsets.
+// Dispatch is direct threaded through computed goto: one indirect jump per instruction, nothing is decoded while running.
+// Uses the same FrameLayout as NativeShader, so a frame can be handed to either tier
+class InterpretedShader {
+    public:
+    static constexpr uint32_t constant_bit = 1u << 31; // Operands with this bit set are offsets into the constants, the rest into the frame
+    static constexpr size_t max_call_depth = 64;
+
+    enum class Handler : uint32_t;
+
+    struct Instruction {
+        const void* target; // The handler's label in execute(), set once the whole entry point is decoded
+        Handler handler;
+        uint32_t n; // Components, or words
+        uint32_t dst, a, b, c;
+        uint32_t s; // Jump target, stride, or the runtime offset of a pointer
+        const void* data; // Function or switch table
+    };
+
+    InterpretedShader(const SpirvJit& code, spv::Id entry_point);
+
+    // Switch instructions point into _switch_tables
+    InterpretedShader(const InterpretedShader&) = delete;
+    InterpretedShader(InterpretedShader&&) = default;
+
+    const FrameLayout& layout() const {
+        return _layout;
+    }
+
+    // Decoded entry point, execution starts at the first instruction
+    const std::vector<Instruction>& code() const {
+        return _code;
+    }
+
+    // Same contract as NativeShader::run()
+    bool run(uint32_t* frame) const {
+        frame[FrameLayout::killed_word] = 0;
+        execute(_code.data(), frame, _layout.constants().data());
+        return frame[FrameLayout::killed_word] == 0;
+    }
+
+    private:
+    // Returns the handler labels, indexed by Handler, if `code` is nullptr
+    static const void* const* execute(const Instruction* code, uint32_t* frame, const uint32_t* constants);
+
+    FrameLayout _layout;
+    std::vector<Instruction> _code;
+    std::vector<std::vector<uint32_t>> _switch_tables; // Pairs of literal and target
+};
\ No newline at end of file
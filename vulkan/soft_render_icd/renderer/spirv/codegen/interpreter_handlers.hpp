@@ -0,0 +1,93 @@
+#pragma once
+
+#include "interpreter.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+// Shared by the scalar and the SPMD interpreter, both decode the same Instructions
+
+// Every handler, in the order of the label tables
+#define INTERPRETER_HANDLERS(X) \
+    X(Copy) X(FAdd) X(FSub) X(FMul) X(FDiv) X(FMod) X(FRem) X(FMulScalar) \
+    X(IAdd) X(ISub) X(IMul) X(SDiv) X(SRem) X(SMod) X(UDiv) X(UMod) X(SNegate) \
+    X(Not) X(And) X(Or) X(Xor) X(Xnor) X(AndImmediate) X(XorImmediate) X(ShiftLeft) X(ShiftRightLogical) X(ShiftRightArithmetic) \
+    X(IEqual) X(INotEqual) X(SLess) X(SLessEqual) X(SGreater) X(SGreaterEqual) X(ULess) X(ULessEqual) X(UGreater) X(UGreaterEqual) \
+    X(FOrdEqual) X(FOrdNotEqual) X(FOrdLess) X(FOrdGreater) X(FOrdLessEqual) X(FOrdGreaterEqual) \
+    X(FUnordEqual) X(FUnordNotEqual) X(FUnordLess) X(FUnordGreater) X(FUnordLessEqual) X(FUnordGreaterEqual) \
+    X(Select) X(Any) X(All) X(FToS) X(FToU) X(SToF) X(UToF) \
+    X(Dot) X(ExtractDynamic) X(InsertDynamic) \
+    X(Load) X(Store) X(CopyMemory) X(IndexScale) X(PointerArgument) \
+    X(Map) X(Length) X(Distance) X(Cross) X(Normalize) X(Reflect) X(FaceForward) \
+    X(Jump) X(Branch) X(Switch) X(Call) X(Return) X(Kill)
+
+#define X(name) name,
+enum class InterpretedShader::Handler : uint32_t { INTERPRETER_HANDLERS(X) };
+#undef X
+
+namespace interpreter_handlers {
+    // Component wise GLSL.std.450 functions, unused operands are passed as the first one
+    using MapFunction = uint32_t (*)(uint32_t, uint32_t, uint32_t);
+
+    inline float fl(uint32_t bits){
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    inline uint32_t bits(float f){
+        uint32_t b;
+        memcpy(&b, &f, sizeof(b));
+        return b;
+    }
+
+    // Out of range conversions give what cvttss2si does, like in the native backend
+    inline uint32_t float_to_signed(float f){
+        return (f >= -2147483648.0f && f < 2147483648.0f) ? (uint32_t)(int32_t)f : 0x80000000u;
+    }
+
+    inline uint32_t float_to_unsigned(float f){
+        return (f > -9223372036854775808.0f && f < 9223372036854775808.0f) ? (uint32_t)(int64_t)f : 0;
+    }
+
+    // x - y * floor(x / y) for OpFMod, OpFRem truncates instead. Every step rounds to float, like in the native backend
+    inline float float_mod(float x, float y){
+        float multiple = std::floor(x / y) * y;
+        return x - multiple;
+    }
+
+    inline float float_rem(float x, float y){
+        float multiple = std::trunc(x / y) * y;
+        return x - multiple;
+    }
+
+    // The sign of the divisor, division by zero and x % -1 give 0 like OpSRem
+    inline uint32_t signed_mod(uint32_t a, uint32_t b){
+        if(b == 0 || b == ~0u)
+            return 0;
+
+        int32_t remainder = (int32_t)a % (int32_t)b;
+        if(remainder != 0 && (remainder ^ (int32_t)b) < 0)
+            remainder += (int32_t)b;
+        return (uint32_t)remainder;
+    }
+
+    // minss and maxss return the second operand if either is NaN
+    inline float min_ss(float a, float b){
+        return (a < b) ? a : b;
+    }
+
+    inline float max_ss(float a, float b){
+        return (a > b) ? a : b;
+    }
+
+    // NMin and NMax return the operand that isn't NaN
+    inline float non_nan_min(float a, float b){
+        return std::isnan(b) ? a : min_ss(a, b);
+    }
+
+    inline float non_nan_max(float a, float b){
+        return std::isnan(b) ? a : max_ss(a, b);
+    }
+} // namespace interpreter_handlers
\ No newline at end of file
@@ -0,0 +1,1096 @@
+#include "native_backend.hpp"
+#include "x86_64_assembler.hpp"
+#include "glsl_std_450.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace x86_64;
+
+namespace {
+    // Generated functions keep the frame in rdi and the constants in rsi, and only clobber caller saved registers.
+    // Every function drops rsp by 8 on entry, so the stack is 16 byte aligned in function bodies and C functions can be called directly
+    constexpr Gpr frame_reg = rdi;
+    constexpr Gpr constants_reg = rsi;
+
+    using UnaryFunction = float (*)(float);
+    using BinaryFunction = float (*)(float, float);
+
+    UnaryFunction unary_function(Glsl op){
+        switch (op) {
+            case Glsl::Round: return [](float x){ return std::round(x); };
+            case Glsl::RoundEven: return [](float x){ return std::nearbyint(x); };
+            case Glsl::Trunc: return [](float x){ return std::trunc(x); };
+            case Glsl::Floor: return [](float x){ return std::floor(x); };
+            case Glsl::Ceil: return [](float x){ return std::ceil(x); };
+            case Glsl::Sin: return [](float x){ return std::sin(x); };
+            case Glsl::Cos: return [](float x){ return std::cos(x); };
+            case Glsl::Tan: return [](float x){ return std::tan(x); };
+            case Glsl::Asin: return [](float x){ return std::asin(x); };
+            case Glsl::Acos: return [](float x){ return std::acos(x); };
+            case Glsl::Atan: return [](float x){ return std::atan(x); };
+            case Glsl::Sinh: return [](float x){ return std::sinh(x); };
+            case Glsl::Cosh: return [](float x){ return std::cosh(x); };
+            case Glsl::Tanh: return [](float x){ return std::tanh(x); };
+            case Glsl::Asinh: return [](float x){ return std::asinh(x); };
+            case Glsl::Acosh: return [](float x){ return std::acosh(x); };
+            case Glsl::Atanh: return [](float x){ return std::atanh(x); };
+            case Glsl::Exp: return [](float x){ return std::exp(x); };
+            case Glsl::Log: return [](float x){ return std::log(x); };
+            case Glsl::Exp2: return [](float x){ return std::exp2(x); };
+            case Glsl::Log2: return [](float x){ return std::log2(x); };
+            default: return nullptr;
+        }
+    }
+
+    BinaryFunction binary_function(Glsl op){
+        switch (op) {
+            case Glsl::Atan2: return [](float y, float x){ return std::atan2(y, x); };
+            case Glsl::Pow: return [](float x, float y){ return std::pow(x, y); };
+            default: return nullptr;
+        }
+    }
+
+    uint32_t float_bits(float f){
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+
+    Mem at(Mem m, uint32_t word){
+        m.disp += (int32_t)(word * 4);
+        return m;
+    }
+
+    class Lowering {
+        public:
+        Lowering(const SpirvJit& code, const FrameLayout& layout): _code{code}, _layout{layout} {}
+
+        // Returns the offset of the entry function, which clears the kill flag and initializes module scope variables before running the entry point
+        size_t lower(){
+            for(auto index : _layout.functions()){
+                const auto& function = _code.functions[index];
+                _function_labels[function.id] = _asm.label();
+                for(const auto& block : function.blocks){
+                    _block_labels[block.label] = _asm.label();
+                    _blocks[block.label] = &block;
+                }
+            }
+
+            for(spv::Id id = 0; id < _code.variables.size(); id++){
+                const auto& var = _code.variables[id];
+                if(var.type == SpirvJit::Var::Type::Variable && _layout.slot(id).storage == FrameLayout::Storage::Frame)
+                    _pointers[id] = FramePointer{_layout.slot(id).offset, FrameLayout::none, _layout.pointee(var.variable.type)};
+            }
+
+            auto entry = _asm.label();
+            _asm.bind(entry);
+            _asm.alu64(Alu::Sub, rsp, 8);
+            _asm.mov(frame(FrameLayout::killed_word), 0u);
+            for(const auto& [id, pointer] : _pointers){
+                auto initializer = _code.variables[id].variable.initializer;
+                if(initializer)
+                    copy(frame(pointer.offset), value(initializer), _layout.words(pointer.type));
+            }
+            _asm.call(_function_labels.at(_layout.entry_function()));
+            _asm.alu64(Alu::Add, rsp, 8);
+            _asm.ret();
+
+            for(auto index : _layout.functions())
+                lower_function(index);
+
+            _asm.finish();
+            return _asm.offset(entry);
+        }
+
+        const std::vector<uint8_t>& code() const {
+            return _asm.code();
+        }
+
+        private:
+        Mem frame(uint32_t word) const {
+            return Mem{frame_reg, (int32_t)(word * 4)};
+        }
+
+        Mem value(spv::Id id, uint32_t word = 0) const {
+            const auto& slot = _layout.slot(id);
+            switch (slot.storage) {
+                case FrameLayout::Storage::Frame: return frame(slot.offset + word);
+                case FrameLayout::Storage::Constant: return Mem{constants_reg, (int32_t)((slot.offset + word) * 4)};
+                default:
+                    print("JIT: %{:d} has no value\n", id);
+                    throw std::runtime_error("JIT: Use of a value without storage");
+            }
+        }
+
+        Mem result(const SpirvJit::Instruction& instruction, uint32_t word = 0) const {
+            return value(instruction.result, word);
+        }
+
+        const FramePointer& pointer(spv::Id id) const {
+            auto it = _pointers.find(id);
+            if(it == _pointers.end()){
+                print("JIT: %{:d} points to an unsupported storage class\n", id);
+                throw std::runtime_error("JIT: Unsupported storage class");
+            }
+            return it->second;
+        }
+
+        // Word `word` of what `p` points to, its runtime offset has to be in `index` already, see load_dynamic()
+        Mem pointee(const FramePointer& p, uint32_t word, Gpr index) const {
+            if(p.dynamic == FrameLayout::none)
+                return frame(p.offset + word);
+
+            return Mem{frame_reg, (int32_t)((p.offset + word) * 4), index, 4};
+        }
+
+        void load_dynamic(const FramePointer& p, Gpr index){
+            if(p.dynamic != FrameLayout::none)
+                _asm.mov(index, frame(p.dynamic));
+        }
+
+        void copy(const Mem& dst, const Mem& src, uint32_t words){
+            for(uint32_t i = 0; i < words; i++){
+                _asm.mov(rax, at(src, i));
+                _asm.mov(at(dst, i), rax);
+            }
+        }
+
+        void load_float(Xmm dst, float f){
+            _asm.mov(rax, float_bits(f));
+            _asm.movd(dst, rax);
+        }
+
+        // Takes arguments in xmm0 and xmm1, returns in xmm0
+        void call_c(const void* function){
+            _asm.push(frame_reg);
+            _asm.push(constants_reg);
+            _asm.mov64(rax, (uint64_t)(uintptr_t)function);
+            _asm.call(rax);
+            _asm.pop(constants_reg);
+            _asm.pop(frame_reg);
+        }
+
+        void epilogue(){
+            _asm.alu64(Alu::Add, rsp, 8);
+            _asm.ret();
+        }
+
+        uint32_t words(const SpirvJit::Instruction& instruction) const {
+            return _layout.words(instruction.type);
+        }
+
+        void lower_function(size_t index){
+            const auto& function = _code.functions[index];
+            _function = index;
+
+            _asm.bind(_function_labels.at(function.id));
+            _asm.alu64(Alu::Sub, rsp, 8);
+
+            // The caller stores the absolute word offset of pointer arguments
+            for(size_t i = 0; i < function.parameters.size(); i++){
+                auto type = function.parameter_types[i];
+                if(_layout.is_pointer(type))
+                    _pointers[function.parameters[i]] = FramePointer{0, _layout.slot(function.parameters[i]).offset, _layout.pointee(type)};
+            }
+
+            for(const auto& block : function.blocks){
+                _block = &block;
+                _asm.bind(_block_labels.at(block.label));
+
+                for(const auto& instruction : block.instructions)
+                    lower(instruction);
+            }
+        }
+
+        // Leaves the current block for `target`, setting the phis of `target` on the way
+        void edge(spv::Id target){
+            for(const auto& instruction : _blocks.at(target)->instructions){
+                if(instruction.op != spv::Op::OpPhi)
+                    break;
+
+                for(size_t i = 0; i + 1 < instruction.operands.size(); i += 2){
+                    if(instruction.operands[i + 1] == _block->label)
+                        copy(frame(_layout.phi_shadow(instruction.result)), value(instruction.operands[i]), words(instruction));
+                }
+            }
+
+            _asm.jmp(_block_labels.at(target));
+        }
+
+        void lower(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+
+            switch (in.op) {
+                // Memory
+                case spv::Op::OpVariable: {
+                    auto p = FramePointer{_layout.slot(in.result).offset, FrameLayout::none, _layout.pointee(in.type)};
+                    _pointers[in.result] = p;
+                    if(ops.size() > 1)
+                        copy(frame(p.offset), value(ops[1]), _layout.words(p.type));
+                    break;
+                }
+                case spv::Op::OpUndef:
+                    break;
+                case spv::Op::OpLoad: {
+                    const auto& p = pointer(ops[0]);
+                    load_dynamic(p, rdx);
+                    copy(result(in), pointee(p, 0, rdx), words(in));
+                    break;
+                }
+                case spv::Op::OpStore: {
+                    const auto& p = pointer(ops[0]);
+                    load_dynamic(p, rdx);
+                    copy(pointee(p, 0, rdx), value(ops[1]), _layout.words(p.type));
+                    break;
+                }
+                case spv::Op::OpCopyMemory: {
+                    const auto& dst = pointer(ops[0]);
+                    const auto& src = pointer(ops[1]);
+                    load_dynamic(dst, rdx);
+                    load_dynamic(src, rcx);
+                    copy(pointee(dst, 0, rdx), pointee(src, 0, rcx), _layout.words(dst.type));
+                    break;
+                }
+                case spv::Op::OpCopyObject:
+                    if(_layout.is_pointer(in.type))
+                        _pointers[in.result] = pointer(ops[0]);
+                    else
+                        copy(result(in), value(ops[0]), words(in));
+                    break;
+                case spv::Op::OpAccessChain:
+                case spv::Op::OpInBoundsAccessChain:
+                    access_chain(in);
+                    break;
+
+                // Control flow
+                case spv::Op::OpPhi:
+                    if(_layout.is_pointer(in.type))
+                        throw std::runtime_error("JIT: Phis of pointers are unsupported");
+                    copy(result(in), frame(_layout.phi_shadow(in.result)), words(in));
+                    break;
+                case spv::Op::OpSelectionMerge:
+                case spv::Op::OpLoopMerge:
+                    break;
+                case spv::Op::OpBranch:
+                    edge(ops[0]);
+                    break;
+                case spv::Op::OpBranchConditional: {
+                    auto false_edge = _asm.label();
+                    _asm.mov(rax, value(ops[0]));
+                    _asm.test(rax, rax);
+                    _asm.jcc(Equal, false_edge);
+                    edge(ops[1]);
+                    _asm.bind(false_edge);
+                    edge(ops[2]);
+                    break;
+                }
+                case spv::Op::OpSwitch: {
+                    std::vector<Label> cases;
+                    _asm.mov(rax, value(ops[0]));
+                    for(size_t i = 2; i + 1 < ops.size(); i += 2){
+                        cases.push_back(_asm.label());
+                        _asm.alu(Alu::Cmp, rax, ops[i]);
+                        _asm.jcc(Equal, cases.back());
+                    }
+                    edge(ops[1]);
+                    for(size_t i = 2, c = 0; i + 1 < ops.size(); i += 2, c++){
+                        _asm.bind(cases[c]);
+                        edge(ops[i + 1]);
+                    }
+                    break;
+                }
+                case spv::Op::OpReturn:
+                case spv::Op::OpUnreachable:
+                    epilogue();
+                    break;
+                case spv::Op::OpReturnValue:
+                    copy(frame(_layout.return_slot(_function)), value(ops[0]), _layout.words(_layout.type_of(ops[0])));
+                    epilogue();
+                    break;
+                case spv::Op::OpKill:
+                    _asm.mov(frame(FrameLayout::killed_word), ~0u);
+                    epilogue();
+                    break;
+                case spv::Op::OpFunctionCall:
+                    function_call(in);
+                    break;
+
+                // Arithmetic
+                case spv::Op::OpFAdd: float_binary(in, Sse::Add); break;
+                case spv::Op::OpFSub: float_binary(in, Sse::Sub); break;
+                case spv::Op::OpFMul: float_binary(in, Sse::Mul); break;
+                case spv::Op::OpFDiv: float_binary(in, Sse::Div); break;
+                case spv::Op::OpFMod:
+                case spv::Op::OpFRem:
+                    float_modulo(in);
+                    break;
+                case spv::Op::OpFNegate: int_unary(in, Alu::Xor, 0x80000000u); break;
+                case spv::Op::OpIAdd: int_binary(in, Alu::Add); break;
+                case spv::Op::OpISub: int_binary(in, Alu::Sub); break;
+                case spv::Op::OpIMul:
+                    for(uint32_t c = 0; c < words(in); c++){
+                        _asm.mov(rax, value(ops[0], c));
+                        _asm.mov(rcx, value(ops[1], c));
+                        _asm.imul(rax, rcx);
+                        _asm.mov(result(in, c), rax);
+                    }
+                    break;
+                case spv::Op::OpSDiv:
+                case spv::Op::OpSRem:
+                case spv::Op::OpSMod:
+                case spv::Op::OpUDiv:
+                case spv::Op::OpUMod:
+                    divide(in);
+                    break;
+                case spv::Op::OpSNegate:
+                    for(uint32_t c = 0; c < words(in); c++){
+                        _asm.mov(rax, value(ops[0], c));
+                        _asm.neg(rax);
+                        _asm.mov(result(in, c), rax);
+                    }
+                    break;
+
+                // Bits, booleans are masks so the logical operations are bitwise ones
+                case spv::Op::OpNot:
+                case spv::Op::OpLogicalNot:
+                    for(uint32_t c = 0; c < words(in); c++){
+                        _asm.mov(rax, value(ops[0], c));
+                        _asm.bit_not(rax);
+                        _asm.mov(result(in, c), rax);
+                    }
+                    break;
+                case spv::Op::OpBitwiseAnd:
+                case spv::Op::OpLogicalAnd:
+                    int_binary(in, Alu::And);
+                    break;
+                case spv::Op::OpBitwiseOr:
+                case spv::Op::OpLogicalOr:
+                    int_binary(in, Alu::Or);
+                    break;
+                case spv::Op::OpBitwiseXor:
+                case spv::Op::OpLogicalNotEqual:
+                    int_binary(in, Alu::Xor);
+                    break;
+                case spv::Op::OpLogicalEqual:
+                    int_binary(in, Alu::Xor, true);
+                    break;
+                case spv::Op::OpShiftLeftLogical:
+                case spv::Op::OpShiftRightLogical:
+                case spv::Op::OpShiftRightArithmetic:
+                    for(uint32_t c = 0; c < words(in); c++){
+                        _asm.mov(rax, value(ops[0], c));
+                        _asm.mov(rcx, value(ops[1], c));
+                        if(in.op == spv::Op::OpShiftLeftLogical)
+                            _asm.shl(rax);
+                        else if(in.op == spv::Op::OpShiftRightLogical)
+                            _asm.shr(rax);
+                        else
+                            _asm.sar(rax);
+                        _asm.mov(result(in, c), rax);
+                    }
+                    break;
+
+                // Comparisons
+                case spv::Op::OpIEqual: int_compare(in, Equal); break;
+                case spv::Op::OpINotEqual: int_compare(in, NotEqual); break;
+                case spv::Op::OpSLessThan: int_compare(in, Less); break;
+                case spv::Op::OpSLessThanEqual: int_compare(in, LessEqual); break;
+                case spv::Op::OpSGreaterThan: int_compare(in, Greater); break;
+                case spv::Op::OpSGreaterThanEqual: int_compare(in, GreaterEqual); break;
+                case spv::Op::OpULessThan: int_compare(in, Below); break;
+                case spv::Op::OpULessThanEqual: int_compare(in, BelowEqual); break;
+                case spv::Op::OpUGreaterThan: int_compare(in, Above); break;
+                case spv::Op::OpUGreaterThanEqual: int_compare(in, AboveEqual); break;
+                // cmpss only has ordered less than and its unordered negations, greater than swaps the operands
+                case spv::Op::OpFOrdEqual: float_compare(in, CmpEq, false); break;
+                case spv::Op::OpFOrdNotEqual: float_compare(in, CmpNeq, false, CmpOrd, Sse::And); break;
+                case spv::Op::OpFOrdLessThan: float_compare(in, CmpLt, false); break;
+                case spv::Op::OpFOrdGreaterThan: float_compare(in, CmpLt, true); break;
+                case spv::Op::OpFOrdLessThanEqual: float_compare(in, CmpLe, false); break;
+                case spv::Op::OpFOrdGreaterThanEqual: float_compare(in, CmpLe, true); break;
+                case spv::Op::OpFUnordEqual: float_compare(in, CmpEq, false, CmpUnord, Sse::Or); break;
+                case spv::Op::OpFUnordNotEqual: float_compare(in, CmpNeq, false); break;
+                case spv::Op::OpFUnordLessThan: float_compare(in, CmpNle, true); break;
+                case spv::Op::OpFUnordGreaterThan: float_compare(in, CmpNle, false); break;
+                case spv::Op::OpFUnordLessThanEqual: float_compare(in, CmpNlt, true); break;
+                case spv::Op::OpFUnordGreaterThanEqual: float_compare(in, CmpNlt, false); break;
+
+                case spv::Op::OpSelect: {
+                    if(_layout.is_pointer(in.type))
+                        throw std::runtime_error("JIT: Selecting pointers is unsupported");
+
+                    // A scalar condition selects whole composites
+                    bool scalar = _layout.words(_layout.type_of(ops[0])) == 1;
+                    for(uint32_t c = 0; c < words(in); c++){
+                        _asm.mov(rax, value(ops[0], scalar ? 0 : c));
+                        _asm.mov(rcx, value(ops[1], c));
+                        _asm.alu(Alu::And, rcx, rax);
+                        _asm.bit_not(rax);
+                        _asm.alu(Alu::And, rax, value(ops[2], c));
+                        _asm.alu(Alu::Or, rax, rcx);
+                        _asm.mov(result(in, c), rax);
+                    }
+                    break;
+                }
+                case spv::Op::OpAny:
+                case spv::Op::OpAll: {
+                    auto n = _layout.words(_layout.type_of(ops[0]));
+                    _asm.mov(rax, value(ops[0], 0));
+                    for(uint32_t c = 1; c < n; c++)
+                        _asm.alu((in.op == spv::Op::OpAny) ? Alu::Or : Alu::And, rax, value(ops[0], c));
+                    _asm.mov(result(in), rax);
+                    break;
+                }
+
+                // Conversions
+                case spv::Op::OpConvertFToS:
+                case spv::Op::OpConvertFToU:
+                    for(uint32_t c = 0; c < words(in); c++){
+                        _asm.movss(xmm0, value(ops[0], c));
+                        if(in.op == spv::Op::OpConvertFToS)
+                            _asm.cvttss2si(rax, xmm0);
+                        else
+                            _asm.cvttss2si64(rax, xmm0);
+                        _asm.mov(result(in, c), rax);
+                    }
+                    break;
+                case spv::Op::OpConvertSToF:
+                case spv::Op::OpConvertUToF:
+                    for(uint32_t c = 0; c < words(in); c++){
+                        _asm.mov(rax, value(ops[0], c)); // Zero extends, so the 64 bit conversion is an unsigned 32 bit one
+                        if(in.op == spv::Op::OpConvertSToF)
+                            _asm.cvtsi2ss(xmm0, rax);
+                        else
+                            _asm.cvtsi2ss64(xmm0, rax);
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case spv::Op::OpBitcast:
+                    copy(result(in), value(ops[0]), words(in));
+                    break;
+
+                // Composites
+                case spv::Op::OpCompositeConstruct: {
+                    uint32_t offset = 0;
+                    for(auto constituent : ops){
+                        auto n = _layout.words(_layout.type_of(constituent));
+                        copy(result(in, offset), value(constituent), n);
+                        offset += n;
+                    }
+                    break;
+                }
+                case spv::Op::OpCompositeExtract: {
+                    auto offset = composite_offset(_layout.type_of(ops[0]), ops.begin() + 1, ops.end());
+                    copy(result(in), value(ops[0], offset), words(in));
+                    break;
+                }
+                case spv::Op::OpCompositeInsert: {
+                    copy(result(in), value(ops[1]), words(in));
+                    auto offset = composite_offset(in.type, ops.begin() + 2, ops.end());
+                    copy(result(in, offset), value(ops[0]), _layout.words(_layout.type_of(ops[0])));
+                    break;
+                }
+                case spv::Op::OpVectorShuffle: {
+                    auto n = _layout.words(_layout.type_of(ops[0]));
+                    for(uint32_t c = 0; c < words(in); c++){
+                        auto component = ops[2 + c];
+                        if(component == ~0u)
+                            continue; // Undefined
+                        auto src = (component < n) ? value(ops[0], component) : value(ops[1], component - n);
+                        copy(result(in, c), src, 1);
+                    }
+                    break;
+                }
+                case spv::Op::OpVectorExtractDynamic: {
+                    _asm.mov(rcx, value(ops[1]));
+                    auto vector = value(ops[0]);
+                    copy(result(in), Mem{vector.base, vector.disp, rcx, 4}, 1);
+                    break;
+                }
+                case spv::Op::OpVectorInsertDynamic: {
+                    copy(result(in), value(ops[0]), words(in));
+                    _asm.mov(rcx, value(ops[2]));
+                    auto vector = result(in);
+                    copy(Mem{vector.base, vector.disp, rcx, 4}, value(ops[1]), 1);
+                    break;
+                }
+
+                // Linear algebra
+                case spv::Op::OpVectorTimesScalar:
+                case spv::Op::OpMatrixTimesScalar:
+                    for(uint32_t c = 0; c < words(in); c++){
+                        _asm.movss(xmm0, value(ops[0], c));
+                        _asm.sse(Sse::Mul, xmm0, value(ops[1]));
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case spv::Op::OpMatrixTimesVector: {
+                    auto rows = words(in);
+                    auto columns = _layout.words(_layout.type_of(ops[1]));
+                    for(uint32_t r = 0; r < rows; r++){
+                        dot(xmm0, [&](uint32_t k){ return value(ops[0], k * rows + r); }, [&](uint32_t k){ return value(ops[1], k); }, columns);
+                        _asm.movss(result(in, r), xmm0);
+                    }
+                    break;
+                }
+                case spv::Op::OpVectorTimesMatrix: {
+                    auto rows = _layout.words(_layout.type_of(ops[0]));
+                    for(uint32_t c = 0; c < words(in); c++){
+                        dot(xmm0, [&](uint32_t k){ return value(ops[0], k); }, [&](uint32_t k){ return value(ops[1], c * rows + k); }, rows);
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                }
+                case spv::Op::OpMatrixTimesMatrix: {
+                    auto rows = _layout.words(_layout.member_type(in.type, 0));
+                    auto columns = words(in) / rows;
+                    auto inner = _layout.words(_layout.type_of(ops[0])) / rows;
+                    for(uint32_t c = 0; c < columns; c++){
+                        for(uint32_t r = 0; r < rows; r++){
+                            dot(xmm0, [&](uint32_t k){ return value(ops[0], k * rows + r); }, [&](uint32_t k){ return value(ops[1], c * inner + k); }, inner);
+                            _asm.movss(result(in, c * rows + r), xmm0);
+                        }
+                    }
+                    break;
+                }
+                case spv::Op::OpDot: {
+                    auto n = _layout.words(_layout.type_of(ops[0]));
+                    dot(xmm0, [&](uint32_t k){ return value(ops[0], k); }, [&](uint32_t k){ return value(ops[1], k); }, n);
+                    _asm.movss(result(in), xmm0);
+                    break;
+                }
+
+                case spv::Op::OpExtInst:
+                    extended(in);
+                    break;
+
+                default:
+                    print("JIT: Unsupported instruction in function body: {:d}\n", (uint32_t)in.op);
+                    throw std::runtime_error("JIT: Unsupported instruction");
+            }
+        }
+
+        void access_chain(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            auto base = pointer(ops[0]);
+
+            auto p = FramePointer{base.offset, FrameLayout::none, base.type};
+            bool dynamic = base.dynamic != FrameLayout::none;
+            if(dynamic)
+                _asm.mov(rax, frame(base.dynamic));
+
+            for(size_t i = 1; i < ops.size(); i++){
+                auto index = ops[i];
+                const auto& index_var = _code.variables[index];
+
+                if(index_var.type == SpirvJit::Var::Type::Constant){
+                    p.offset += _layout.member_offset(p.type, index_var.constant.unsigned_int);
+                    p.type = _layout.member_type(p.type, index_var.constant.unsigned_int);
+                    continue;
+                }
+
+                // Struct indices are always constants
+                auto element = _layout.member_type(p.type, 0);
+                _asm.mov(rcx, value(index));
+                _asm.imul(rcx, rcx, _layout.words(element));
+                if(dynamic)
+                    _asm.alu(Alu::Add, rax, rcx);
+                else
+                    _asm.mov(rax, rcx);
+
+                dynamic = true;
+                p.type = element;
+            }
+
+            if(dynamic){
+                p.dynamic = _layout.slot(in.result).offset;
+                _asm.mov(frame(p.dynamic), rax);
+            }
+
+            _pointers[in.result] = p;
+        }
+
+        template<typename It>
+        uint32_t composite_offset(spv::Id type, It begin, It end) const {
+            uint32_t offset = 0;
+            for(auto it = begin; it != end; ++it){
+                offset += _layout.member_offset(type, *it);
+                type = _layout.member_type(type, *it);
+            }
+            return offset;
+        }
+
+        void function_call(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            auto callee_index = _code.variables[ops[0]].function.index;
+            const auto& callee = _code.functions[callee_index];
+
+            for(size_t i = 0; i < callee.parameters.size(); i++){
+                auto arg = ops[1 + i];
+                auto param = frame(_layout.slot(callee.parameters[i]).offset);
+
+                if(_layout.is_pointer(callee.parameter_types[i])){
+                    const auto& p = pointer(arg);
+                    _asm.mov(rax, p.offset);
+                    if(p.dynamic != FrameLayout::none)
+                        _asm.alu(Alu::Add, rax, frame(p.dynamic));
+                    _asm.mov(param, rax);
+                } else {
+                    copy(param, value(arg), _layout.words(callee.parameter_types[i]));
+                }
+            }
+
+            _asm.call(_function_labels.at(callee.id));
+
+            // OpKill ends the whole invocation
+            auto alive = _asm.label();
+            _asm.mov(rax, frame(FrameLayout::killed_word));
+            _asm.test(rax, rax);
+            _asm.jcc(Equal, alive);
+            epilogue();
+            _asm.bind(alive);
+
+            if(_layout.return_slot(callee_index) != FrameLayout::none)
+                copy(result(in), frame(_layout.return_slot(callee_index)), words(in));
+        }
+
+        void float_binary(const SpirvJit::Instruction& in, Sse op){
+            for(uint32_t c = 0; c < words(in); c++){
+                _asm.movss(xmm0, value(in.operands[0], c));
+                _asm.sse(op, xmm0, value(in.operands[1], c));
+                _asm.movss(result(in, c), xmm0);
+            }
+        }
+
+        // x - y * floor(x / y) for OpFMod, OpFRem truncates instead. Every step rounds to float, like in the interpreter
+        void float_modulo(const SpirvJit::Instruction& in){
+            auto round = unary_function((in.op == spv::Op::OpFMod) ? Glsl::Floor : Glsl::Trunc);
+            for(uint32_t c = 0; c < words(in); c++){
+                _asm.movss(xmm0, value(in.operands[0], c));
+                _asm.sse(Sse::Div, xmm0, value(in.operands[1], c));
+                call_c((const void*)round);
+                _asm.sse(Sse::Mul, xmm0, value(in.operands[1], c));
+                _asm.movss(xmm1, value(in.operands[0], c));
+                _asm.sse(Sse::Sub, xmm1, xmm0);
+                _asm.movss(result(in, c), xmm1);
+            }
+        }
+
+        void int_binary(const SpirvJit::Instruction& in, Alu op, bool invert = false){
+            for(uint32_t c = 0; c < words(in); c++){
+                _asm.mov(rax, value(in.operands[0], c));
+                _asm.alu(op, rax, value(in.operands[1], c));
+                if(invert)
+                    _asm.bit_not(rax);
+                _asm.mov(result(in, c), rax);
+            }
+        }
+
+        void int_unary(const SpirvJit::Instruction& in, Alu op, uint32_t imm){
+            for(uint32_t c = 0; c < words(in); c++){
+                _asm.mov(rax, value(in.operands[0], c));
+                _asm.alu(op, rax, imm);
+                _asm.mov(result(in, c), rax);
+            }
+        }
+
+        void int_compare(const SpirvJit::Instruction& in, Condition cc){
+            for(uint32_t c = 0; c < words(in); c++){
+                _asm.mov(rax, value(in.operands[0], c));
+                _asm.alu(Alu::Cmp, rax, value(in.operands[1], c));
+                _asm.set_mask(cc, rax);
+                _asm.mov(result(in, c), rax);
+            }
+        }
+
+        void float_compare(const SpirvJit::Instruction& in, Compare predicate, bool swap){
+            float_compare(in, predicate, swap, predicate, Sse::And);
+        }
+
+        // Some comparisons need a second predicate, combined with `combine`. It is skipped if it is the same as the first one
+        void float_compare(const SpirvJit::Instruction& in, Compare predicate, bool swap, Compare second, Sse combine){
+            auto a = in.operands[swap ? 1 : 0], b = in.operands[swap ? 0 : 1];
+            for(uint32_t c = 0; c < words(in); c++){
+                _asm.movss(xmm0, value(a, c));
+                _asm.movss(xmm1, value(b, c));
+                if(second != predicate){
+                    _asm.movaps(xmm2, xmm0);
+                    _asm.cmpss(second, xmm2, xmm1);
+                }
+                _asm.cmpss(predicate, xmm0, xmm1);
+                if(second != predicate)
+                    _asm.sse(combine, xmm0, xmm2);
+                _asm.movss(result(in, c), xmm0);
+            }
+        }
+
+        // Division by zero and INT_MIN / -1 trap on x86, SPIR-V leaves their results undefined. Both give 0 here, except for the quotient of x / -1 which is -x
+        void divide(const SpirvJit::Instruction& in){
+            bool is_signed = (in.op == spv::Op::OpSDiv || in.op == spv::Op::OpSRem || in.op == spv::Op::OpSMod);
+            bool remainder = (in.op == spv::Op::OpSRem || in.op == spv::Op::OpSMod || in.op == spv::Op::OpUMod);
+
+            for(uint32_t c = 0; c < words(in); c++){
+                auto zero = _asm.label(), done = _asm.label();
+                _asm.mov(rax, value(in.operands[0], c));
+                _asm.mov(rcx, value(in.operands[1], c));
+                _asm.test(rcx, rcx);
+                _asm.jcc(Equal, zero);
+
+                if(is_signed){
+                    auto divide = _asm.label();
+                    _asm.alu(Alu::Cmp, rcx, ~0u);
+                    _asm.jcc(NotEqual, divide);
+                    if(remainder)
+                        _asm.alu(Alu::Xor, rax, rax);
+                    else
+                        _asm.neg(rax);
+                    _asm.jmp(done);
+
+                    _asm.bind(divide);
+                    _asm.cdq();
+                    _asm.idiv(rcx);
+                } else {
+                    _asm.alu(Alu::Xor, rdx, rdx);
+                    _asm.div(rcx);
+                }
+                if(remainder)
+                    _asm.mov(rax, rdx);
+                _asm.jmp(done);
+
+                _asm.bind(zero);
+                _asm.alu(Alu::Xor, rax, rax);
+                _asm.bind(done);
+
+                // OpSMod takes the sign of the divisor: a non zero remainder with the other sign moves by one divisor
+                if(in.op == spv::Op::OpSMod){
+                    auto same_sign = _asm.label();
+                    _asm.mov(rdx, rax);
+                    _asm.alu(Alu::Xor, rdx, rcx);
+                    _asm.test(rax, rax);
+                    _asm.jcc(Equal, same_sign);
+                    _asm.test(rdx, rdx);
+                    _asm.jcc(GreaterEqual, same_sign);
+                    _asm.alu(Alu::Add, rax, rcx);
+                    _asm.bind(same_sign);
+                }
+                _asm.mov(result(in, c), rax);
+            }
+        }
+
+        // dst = sum of a(k) * b(k), clobbers xmm7
+        template<typename A, typename B>
+        void dot(Xmm dst, A a, B b, uint32_t n){
+            assert(dst != xmm7);
+            _asm.movss(dst, a(0));
+            _asm.sse(Sse::Mul, dst, b(0));
+            for(uint32_t k = 1; k < n; k++){
+                _asm.movss(xmm7, a(k));
+                _asm.sse(Sse::Mul, xmm7, b(k));
+                _asm.sse(Sse::Add, dst, xmm7);
+            }
+        }
+
+        // minss and maxss return `b` if either operand is NaN, NMin and NMax want `xmm0` back when it is `b` that is NaN.
+        // Takes the first operand in xmm0 and leaves the result there, clobbers xmm1 to xmm3
+        void non_nan_min_max(Sse op, const Mem& b){
+            _asm.movss(xmm1, b);
+            _asm.movaps(xmm3, xmm0);
+            _asm.movaps(xmm2, xmm1);
+            _asm.cmpss(CmpUnord, xmm2, xmm1);
+            _asm.sse(op, xmm0, xmm1);
+            _asm.sse(Sse::And, xmm3, xmm2);
+            _asm.sse(Sse::AndNot, xmm2, xmm0);
+            _asm.sse(Sse::Or, xmm2, xmm3);
+            _asm.movaps(xmm0, xmm2);
+        }
+
+        void extended(const SpirvJit::Instruction& in){
+            const auto& ops = in.operands;
+            if(_code.variables[ops[0]].extension.name != "GLSL.std.450")
+                throw std::runtime_error("JIT: Unsupported extended instruction set");
+
+            auto op = (Glsl)ops[1];
+            auto arg = [&](size_t i, uint32_t c){ return value(ops[2 + i], c); };
+            auto n = words(in);
+            auto arg_words = _layout.words(_layout.type_of(ops[2]));
+
+            if(auto function = unary_function(op)){
+                for(uint32_t c = 0; c < n; c++){
+                    _asm.movss(xmm0, arg(0, c));
+                    call_c((const void*)function);
+                    _asm.movss(result(in, c), xmm0);
+                }
+                return;
+            }
+
+            if(auto function = binary_function(op)){
+                for(uint32_t c = 0; c < n; c++){
+                    _asm.movss(xmm0, arg(0, c));
+                    _asm.movss(xmm1, arg(1, c));
+                    call_c((const void*)function);
+                    _asm.movss(result(in, c), xmm0);
+                }
+                return;
+            }
+
+            switch (op) {
+                case Glsl::FAbs:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.mov(rax, arg(0, c));
+                        _asm.alu(Alu::And, rax, 0x7FFFFFFFu);
+                        _asm.mov(result(in, c), rax);
+                    }
+                    break;
+                case Glsl::SAbs:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.mov(rax, arg(0, c));
+                        _asm.mov(rcx, rax);
+                        _asm.neg(rcx);
+                        _asm.test(rax, rax);
+                        _asm.cmov(Less, rax, rcx);
+                        _asm.mov(result(in, c), rax);
+                    }
+                    break;
+                case Glsl::FSign:
+                    load_float(xmm4, 1.0f);
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(0, c));
+                        _asm.sse(Sse::Xor, xmm1, xmm1);
+                        _asm.movaps(xmm2, xmm1);
+                        _asm.cmpss(CmpLt, xmm2, xmm0); // 0 < x
+                        _asm.cmpss(CmpLt, xmm0, xmm1); // x < 0
+                        _asm.sse(Sse::And, xmm2, xmm4);
+                        _asm.sse(Sse::And, xmm0, xmm4);
+                        _asm.sse(Sse::Sub, xmm2, xmm0);
+                        _asm.movss(result(in, c), xmm2);
+                    }
+                    break;
+                case Glsl::Fract:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(0, c));
+                        call_c((const void*)unary_function(Glsl::Floor));
+                        _asm.movss(xmm1, arg(0, c));
+                        _asm.sse(Sse::Sub, xmm1, xmm0);
+                        _asm.movss(result(in, c), xmm1);
+                    }
+                    break;
+                case Glsl::Radians:
+                case Glsl::Degrees:
+                    load_float(xmm1, (op == Glsl::Radians) ? (float)(M_PI / 180) : (float)(180 / M_PI));
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(0, c));
+                        _asm.sse(Sse::Mul, xmm0, xmm1);
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case Glsl::Sqrt:
+                case Glsl::InverseSqrt:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.sse(Sse::Sqrt, xmm0, arg(0, c));
+                        if(op == Glsl::InverseSqrt){
+                            load_float(xmm1, 1.0f);
+                            _asm.sse(Sse::Div, xmm1, xmm0);
+                            _asm.movaps(xmm0, xmm1);
+                        }
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                // The result of FMin, FMax and FClamp is undefined for NaN operands, so whatever minss and maxss return will do
+                case Glsl::FMin:
+                case Glsl::FMax:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(0, c));
+                        _asm.sse((op == Glsl::FMin) ? Sse::Min : Sse::Max, xmm0, arg(1, c));
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case Glsl::NMin:
+                case Glsl::NMax:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(0, c));
+                        non_nan_min_max((op == Glsl::NMin) ? Sse::Min : Sse::Max, arg(1, c));
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case Glsl::FClamp:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(0, c));
+                        _asm.sse(Sse::Max, xmm0, arg(1, c));
+                        _asm.sse(Sse::Min, xmm0, arg(2, c));
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case Glsl::NClamp:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(0, c));
+                        non_nan_min_max(Sse::Max, arg(1, c));
+                        non_nan_min_max(Sse::Min, arg(2, c));
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                // cmov picks the other operand if the first one is on the wrong side of it
+                case Glsl::UMin: int_select(in, {Above}); break;
+                case Glsl::SMin: int_select(in, {Greater}); break;
+                case Glsl::UMax: int_select(in, {Below}); break;
+                case Glsl::SMax: int_select(in, {Less}); break;
+                case Glsl::UClamp: int_select(in, {Below, Above}); break;
+                case Glsl::SClamp: int_select(in, {Less, Greater}); break;
+                case Glsl::FMix:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(1, c));
+                        _asm.sse(Sse::Sub, xmm0, arg(0, c));
+                        _asm.sse(Sse::Mul, xmm0, arg(2, c));
+                        _asm.sse(Sse::Add, xmm0, arg(0, c));
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case Glsl::Step:
+                    load_float(xmm1, 1.0f);
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(1, c));
+                        _asm.movss(xmm2, arg(0, c));
+                        _asm.cmpss(CmpLt, xmm0, xmm2);
+                        _asm.sse(Sse::AndNot, xmm0, xmm1);
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case Glsl::SmoothStep:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(2, c));
+                        _asm.sse(Sse::Sub, xmm0, arg(0, c));
+                        _asm.movss(xmm1, arg(1, c));
+                        _asm.sse(Sse::Sub, xmm1, arg(0, c));
+                        _asm.sse(Sse::Div, xmm0, xmm1);
+                        _asm.sse(Sse::Xor, xmm2, xmm2);
+                        _asm.sse(Sse::Max, xmm0, xmm2);
+                        load_float(xmm2, 1.0f);
+                        _asm.sse(Sse::Min, xmm0, xmm2);
+                        // t * t * (3 - 2 * t)
+                        _asm.movaps(xmm1, xmm0);
+                        _asm.sse(Sse::Mul, xmm1, xmm0);
+                        load_float(xmm2, 3.0f);
+                        _asm.sse(Sse::Sub, xmm2, xmm0);
+                        _asm.sse(Sse::Sub, xmm2, xmm0);
+                        _asm.sse(Sse::Mul, xmm1, xmm2);
+                        _asm.movss(result(in, c), xmm1);
+                    }
+                    break;
+                case Glsl::Fma:
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm0, arg(0, c));
+                        _asm.sse(Sse::Mul, xmm0, arg(1, c));
+                        _asm.sse(Sse::Add, xmm0, arg(2, c));
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case Glsl::Length:
+                    dot(xmm0, [&](uint32_t k){ return arg(0, k); }, [&](uint32_t k){ return arg(0, k); }, arg_words);
+                    _asm.sse(Sse::Sqrt, xmm0, xmm0);
+                    _asm.movss(result(in), xmm0);
+                    break;
+                case Glsl::Distance:
+                    _asm.sse(Sse::Xor, xmm0, xmm0);
+                    for(uint32_t k = 0; k < arg_words; k++){
+                        _asm.movss(xmm1, arg(0, k));
+                        _asm.sse(Sse::Sub, xmm1, arg(1, k));
+                        _asm.sse(Sse::Mul, xmm1, xmm1);
+                        _asm.sse(Sse::Add, xmm0, xmm1);
+                    }
+                    _asm.sse(Sse::Sqrt, xmm0, xmm0);
+                    _asm.movss(result(in), xmm0);
+                    break;
+                case Glsl::Cross:
+                    for(uint32_t c = 0; c < 3; c++){
+                        auto i = (c + 1) % 3, j = (c + 2) % 3;
+                        _asm.movss(xmm0, arg(0, i));
+                        _asm.sse(Sse::Mul, xmm0, arg(1, j));
+                        _asm.movss(xmm1, arg(0, j));
+                        _asm.sse(Sse::Mul, xmm1, arg(1, i));
+                        _asm.sse(Sse::Sub, xmm0, xmm1);
+                        _asm.movss(result(in, c), xmm0);
+                    }
+                    break;
+                case Glsl::Normalize:
+                    dot(xmm0, [&](uint32_t k){ return arg(0, k); }, [&](uint32_t k){ return arg(0, k); }, n);
+                    _asm.sse(Sse::Sqrt, xmm0, xmm0);
+                    load_float(xmm1, 1.0f);
+                    _asm.sse(Sse::Div, xmm1, xmm0);
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm2, arg(0, c));
+                        _asm.sse(Sse::Mul, xmm2, xmm1);
+                        _asm.movss(result(in, c), xmm2);
+                    }
+                    break;
+                case Glsl::FaceForward:
+                    // N if dot(Nref, I) < 0, -N otherwise
+                    dot(xmm0, [&](uint32_t k){ return arg(2, k); }, [&](uint32_t k){ return arg(1, k); }, n);
+                    _asm.sse(Sse::Xor, xmm1, xmm1);
+                    _asm.cmpss(CmpLt, xmm0, xmm1);
+                    _asm.movd(rax, xmm0);
+                    _asm.mov(r8, rax);
+                    _asm.bit_not(r8);
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.mov(rcx, arg(0, c));
+                        _asm.mov(rdx, rcx);
+                        _asm.alu(Alu::Xor, rdx, 0x80000000u);
+                        _asm.alu(Alu::And, rcx, rax);
+                        _asm.alu(Alu::And, rdx, r8);
+                        _asm.alu(Alu::Or, rcx, rdx);
+                        _asm.mov(result(in, c), rcx);
+                    }
+                    break;
+                case Glsl::Reflect:
+                    // I - 2 * dot(N, I) * N
+                    dot(xmm0, [&](uint32_t k){ return arg(1, k); }, [&](uint32_t k){ return arg(0, k); }, n);
+                    _asm.sse(Sse::Add, xmm0, xmm0);
+                    for(uint32_t c = 0; c < n; c++){
+                        _asm.movss(xmm1, arg(1, c));
+                        _asm.sse(Sse::Mul, xmm1, xmm0);
+                        _asm.movss(xmm2, arg(0, c));
+                        _asm.sse(Sse::Sub, xmm2, xmm1);
+                        _asm.movss(result(in, c), xmm2);
+                    }
+                    break;
+                default:
+                    print("JIT: Unsupported GLSL.std.450 instruction: {:d}\n", ops[1]);
+                    throw std::runtime_error("JIT: Unsupported extended instruction");
+            }
+        }
+
+        // Starts with the first operand, and for each further operand takes it instead if `conditions[i]` holds between the current value and it
+        void int_select(const SpirvJit::Instruction& in, std::initializer_list<Condition> conditions){
+            for(uint32_t c = 0; c < words(in); c++){
+                _asm.mov(rax, value(in.operands[2], c));
+                size_t i = 1;
+                for(auto cc : conditions){
+                    _asm.mov(rcx, value(in.operands[2 + i++], c));
+                    _asm.alu(Alu::Cmp, rax, rcx);
+                    _asm.cmov(cc, rax, rcx);
+                }
+                _asm.mov(result(in, c), rax);
+            }
+        }
+
+        const SpirvJit& _code;
+        const FrameLayout& _layout;
+        Assembler _asm;
+
+        std::unordered_map<spv::Id, Label> _function_labels;
+        std::unordered_map<spv::Id, Label> _block_labels;
+        std::unordered_map<spv::Id, const SpirvJit::Block*> _blocks;
+        std::unordered_map<spv::Id, FramePointer> _pointers;
+
+        size_t _function = 0;
+        const SpirvJit::Block* _block = nullptr;
+    };
+}
+
+NativeShader::NativeShader(const SpirvJit& code, spv::Id entry_point): _layout{code, entry_point} {
+    Lowering lowering{code, _layout};
+    auto entry = lowering.lower();
+
+    _memory = ExecutableMemory{lowering.code()};
+    _entry = _memory.entry<EntryFunction>(entry);
+}
\ No newline at end of file
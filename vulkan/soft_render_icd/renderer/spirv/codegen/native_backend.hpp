@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../jit.hpp"
+#include "frame_layout.hpp"
+#include "executable_memory.hpp"
+
+#include <cstdint>
+
+// An entry point lowered to x86-64 machine code.
+// Values stay in their frame words between instructions, each instruction loads its operands into scratch registers, computes and stores the result.
+// Only uses baseline SSE, booleans are all ones or all zeroes so they double as masks
+class NativeShader {
+    public:
+    using EntryFunction = void (*)(uint32_t* frame, const uint32_t* constants);
+
+    NativeShader(const SpirvJit& code, spv::Id entry_point);
+
+    const FrameLayout& layout() const {
+        return _layout;
+    }
+
+    // `frame` has to hold layout().size() words, interface inputs are read from it and outputs written to it.
+    // Returns false if the invocation was killed
+    bool run(uint32_t* frame) const {
+        _entry(frame, _layout.constants().data());
+        return frame[FrameLayout::killed_word] == 0;
+    }
+
+    private:
+    FrameLayout _layout;
+    ExecutableMemory _memory;
+    EntryFunction _entry;
+};
\ No newline at end of file
@@ -0,0 +1,446 @@
+#include "spmd_shader.hpp"
+#include "interpreter_handlers.hpp"
+
+#include <cmath>
+
+using namespace interpreter_handlers;
+using Handler = InterpretedShader::Handler;
+
+template<uint32_t Lanes>
+SpmdShader<Lanes>::SpmdShader(const SpirvJit& code, spv::Id entry_point): _scalar{code, entry_point}, _code{_scalar.code()} {
+    auto handlers = execute(nullptr, nullptr, nullptr, 0);
+    for(auto& instruction : _code)
+        instruction.target = handlers[(size_t)instruction.handler];
+
+    for(auto constant : _scalar.layout().constants())
+        _constants.insert(_constants.end(), Lanes, constant);
+}
+
+template<uint32_t Lanes>
+const void* const* SpmdShader<Lanes>::execute(const Instruction* code, uint32_t* frame, const uint32_t* constants, uint32_t lanes){
+    #define X(name) &&name,
+    static const void* const handlers[] = { INTERPRETER_HANDLERS(X) };
+    #undef X
+
+    if(!code)
+        return handlers;
+
+    constexpr uint32_t done = ~0u; // Program counter of lanes that returned from the current function
+    constexpr uint32_t constant_bit = InterpretedShader::constant_bit;
+
+    const uint32_t* const bases[2] = {frame, constants};
+    auto src = [bases](uint32_t operand, uint32_t i){ return bases[operand >> 31] + ((operand & ~constant_bit) + i) * Lanes; };
+    auto word = [frame](uint32_t w){ return frame + w * Lanes; };
+    auto dynamic = [frame](uint32_t w, uint32_t l){ return (w != FrameLayout::none) ? frame[w * Lanes + l] : 0; };
+
+    struct CallSite {
+        uint32_t ret;
+        uint32_t activation;
+    };
+    CallSite stack[InterpretedShader::max_call_depth];
+    size_t depth = 0;
+
+    uint32_t pc[Lanes];
+    uint32_t m[Lanes]; // All ones for the lanes in `mask`, for blending
+    uint32_t mask = lanes; // Lanes running the current instruction
+    uint32_t activation = lanes; // Lanes that entered the current function
+    uint32_t killed = 0;
+    const Instruction* ip = code;
+
+    for(uint32_t l = 0; l < Lanes; l++){
+        pc[l] = 0;
+        m[l] = (lanes & (1u << l)) ? ~0u : 0u;
+    }
+
+    if(!lanes)
+        return nullptr;
+
+    #define DISPATCH() goto *ip->target
+    #define NEXT() do { ip++; DISPATCH(); } while(0)
+    #define ACTIVE(l) (mask & (1u << (l)))
+    #define BLEND(d, l, value) d[l] = ((value) & m[l]) | (d[l] & ~m[l])
+    // `expr` sees lane l of the i-th words of a and b as A[l] and B[l]
+    #define LANEWISE(expr) do { \
+        for(uint32_t i = 0; i < ip->n; i++){ \
+            auto* d = word(ip->dst + i); \
+            const uint32_t* A = src(ip->a, i); \
+            const uint32_t* B = src(ip->b, i); \
+            (void)B; \
+            for(uint32_t l = 0; l < Lanes; l++) \
+                BLEND(d, l, (expr)); \
+        } \
+        NEXT(); \
+    } while(0)
+    #define MASK(condition) ((condition) ? ~0u : 0u)
+    #define FA fl(A[l])
+    #define FB fl(B[l])
+
+    DISPATCH();
+
+    Copy: LANEWISE(A[l]);
+    FAdd: LANEWISE(bits(FA + FB));
+    FSub: LANEWISE(bits(FA - FB));
+    FMul: LANEWISE(bits(FA * FB));
+    FDiv: LANEWISE(bits(FA / FB));
+    FMod: LANEWISE(bits(float_mod(FA, FB)));
+    FRem: LANEWISE(bits(float_rem(FA, FB)));
+    FMulScalar: {
+        const uint32_t* S = src(ip->b, 0);
+        for(uint32_t i = 0; i < ip->n; i++){
+            auto* d = word(ip->dst + i);
+            const uint32_t* A = src(ip->a, i);
+            for(uint32_t l = 0; l < Lanes; l++)
+                BLEND(d, l, bits(FA * fl(S[l])));
+        }
+        NEXT();
+    }
+
+    IAdd: LANEWISE(A[l] + B[l]);
+    ISub: LANEWISE(A[l] - B[l]);
+    IMul: LANEWISE(A[l] * B[l]);
+    SDiv: LANEWISE((B[l] == 0) ? 0u : (B[l] == ~0u) ? 0u - A[l] : (uint32_t)((int32_t)A[l] / (int32_t)B[l]));
+    SRem: LANEWISE((B[l] == 0 || B[l] == ~0u) ? 0u : (uint32_t)((int32_t)A[l] % (int32_t)B[l]));
+    SMod: LANEWISE(signed_mod(A[l], B[l]));
+    UDiv: LANEWISE((B[l] == 0) ? 0u : A[l] / B[l]);
+    UMod: LANEWISE((B[l] == 0) ? 0u : A[l] % B[l]);
+    SNegate: LANEWISE(0u - A[l]);
+
+    Not: LANEWISE(~A[l]);
+    And: LANEWISE(A[l] & B[l]);
+    Or: LANEWISE(A[l] | B[l]);
+    Xor: LANEWISE(A[l] ^ B[l]);
+    Xnor: LANEWISE(~(A[l] ^ B[l]));
+    AndImmediate: LANEWISE(A[l] & ip->c);
+    XorImmediate: LANEWISE(A[l] ^ ip->c);
+    ShiftLeft: LANEWISE(A[l] << (B[l] & 31));
+    ShiftRightLogical: LANEWISE(A[l] >> (B[l] & 31));
+    ShiftRightArithmetic: LANEWISE((uint32_t)((int32_t)A[l] >> (B[l] & 31)));
+
+    IEqual: LANEWISE(MASK(A[l] == B[l]));
+    INotEqual: LANEWISE(MASK(A[l] != B[l]));
+    SLess: LANEWISE(MASK((int32_t)A[l] < (int32_t)B[l]));
+    SLessEqual: LANEWISE(MASK((int32_t)A[l] <= (int32_t)B[l]));
+    SGreater: LANEWISE(MASK((int32_t)A[l] > (int32_t)B[l]));
+    SGreaterEqual: LANEWISE(MASK((int32_t)A[l] >= (int32_t)B[l]));
+    ULess: LANEWISE(MASK(A[l] < B[l]));
+    ULessEqual: LANEWISE(MASK(A[l] <= B[l]));
+    UGreater: LANEWISE(MASK(A[l] > B[l]));
+    UGreaterEqual: LANEWISE(MASK(A[l] >= B[l]));
+    FOrdEqual: LANEWISE(MASK(FA == FB));
+    FOrdNotEqual: LANEWISE(MASK(FA < FB || FA > FB));
+    FOrdLess: LANEWISE(MASK(FA < FB));
+    FOrdGreater: LANEWISE(MASK(FA > FB));
+    FOrdLessEqual: LANEWISE(MASK(FA <= FB));
+    FOrdGreaterEqual: LANEWISE(MASK(FA >= FB));
+    FUnordEqual: LANEWISE(MASK(!(FA < FB || FA > FB)));
+    FUnordNotEqual: LANEWISE(MASK(!(FA == FB)));
+    FUnordLess: LANEWISE(MASK(!(FA >= FB)));
+    FUnordGreater: LANEWISE(MASK(!(FA <= FB)));
+    FUnordLessEqual: LANEWISE(MASK(!(FA > FB)));
+    FUnordGreaterEqual: LANEWISE(MASK(!(FA < FB)));
+
+    Select: {
+        for(uint32_t i = 0; i < ip->n; i++){
+            auto* d = word(ip->dst + i);
+            const uint32_t* C = src(ip->a, i * ip->s);
+            const uint32_t* T = src(ip->b, i);
+            const uint32_t* F = src(ip->c, i);
+            for(uint32_t l = 0; l < Lanes; l++)
+                BLEND(d, l, (C[l] & T[l]) | (~C[l] & F[l]));
+        }
+        NEXT();
+    }
+    Any: {
+        uint32_t any[Lanes] = {};
+        for(uint32_t i = 0; i < ip->n; i++){
+            const uint32_t* A = src(ip->a, i);
+            for(uint32_t l = 0; l < Lanes; l++)
+                any[l] |= A[l];
+        }
+        auto* d = word(ip->dst);
+        for(uint32_t l = 0; l < Lanes; l++)
+            BLEND(d, l, any[l]);
+        NEXT();
+    }
+    All: {
+        uint32_t all[Lanes];
+        for(uint32_t l = 0; l < Lanes; l++)
+            all[l] = ~0u;
+        for(uint32_t i = 0; i < ip->n; i++){
+            const uint32_t* A = src(ip->a, i);
+            for(uint32_t l = 0; l < Lanes; l++)
+                all[l] &= A[l];
+        }
+        auto* d = word(ip->dst);
+        for(uint32_t l = 0; l < Lanes; l++)
+            BLEND(d, l, all[l]);
+        NEXT();
+    }
+    FToS: LANEWISE(float_to_signed(FA));
+    FToU: LANEWISE(float_to_unsigned(FA));
+    SToF: LANEWISE(bits((float)(int32_t)A[l]));
+    UToF: LANEWISE(bits((float)A[l]));
+
+    Dot: {
+        float sum[Lanes];
+        for(uint32_t k = 0; k < ip->n; k++){
+            const uint32_t* A = src(ip->a, k * ip->s);
+            const uint32_t* B = src(ip->b, k * ip->c);
+            for(uint32_t l = 0; l < Lanes; l++)
+                sum[l] = (k == 0) ? FA * FB : sum[l] + FA * FB;
+        }
+        auto* d = word(ip->dst);
+        for(uint32_t l = 0; l < Lanes; l++)
+            BLEND(d, l, bits(sum[l]));
+        NEXT();
+    }
+
+    // Indices and runtime offsets of disabled lanes can be anything, so these only touch enabled lanes
+    ExtractDynamic: {
+        auto* d = word(ip->dst);
+        const uint32_t* I = src(ip->b, 0);
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(ACTIVE(l))
+                d[l] = src(ip->a, I[l])[l];
+        }
+        NEXT();
+    }
+    InsertDynamic: {
+        const uint32_t* A = src(ip->a, 0);
+        const uint32_t* I = src(ip->b, 0);
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(ACTIVE(l))
+                word(ip->dst + I[l])[l] = A[l];
+        }
+        NEXT();
+    }
+    Load: {
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(!ACTIVE(l))
+                continue;
+            auto base = ip->a + dynamic(ip->s, l);
+            for(uint32_t i = 0; i < ip->n; i++)
+                word(ip->dst + i)[l] = word(base + i)[l];
+        }
+        NEXT();
+    }
+    Store: {
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(!ACTIVE(l))
+                continue;
+            auto base = ip->a + dynamic(ip->s, l);
+            for(uint32_t i = 0; i < ip->n; i++)
+                word(base + i)[l] = src(ip->b, i)[l];
+        }
+        NEXT();
+    }
+    CopyMemory: {
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(!ACTIVE(l))
+                continue;
+            auto dst = ip->dst + dynamic(ip->s, l);
+            auto from = ip->a + dynamic(ip->c, l);
+            for(uint32_t i = 0; i < ip->n; i++)
+                word(dst + i)[l] = word(from + i)[l];
+        }
+        NEXT();
+    }
+    IndexScale: {
+        auto* d = word(ip->dst);
+        const uint32_t* I = src(ip->b, 0);
+        for(uint32_t l = 0; l < Lanes; l++)
+            BLEND(d, l, dynamic(ip->a, l) + I[l] * ip->s);
+        NEXT();
+    }
+    PointerArgument: {
+        auto* d = word(ip->dst);
+        for(uint32_t l = 0; l < Lanes; l++)
+            BLEND(d, l, ip->a + dynamic(ip->s, l));
+        NEXT();
+    }
+
+    Map: {
+        auto function = (MapFunction)ip->data;
+        for(uint32_t i = 0; i < ip->n; i++){
+            auto* d = word(ip->dst + i);
+            const uint32_t* A = src(ip->a, i);
+            const uint32_t* B = src(ip->b, i);
+            const uint32_t* C = src(ip->c, i);
+            for(uint32_t l = 0; l < Lanes; l++){
+                if(ACTIVE(l))
+                    d[l] = function(A[l], B[l], C[l]);
+            }
+        }
+        NEXT();
+    }
+    Length:
+    Distance: {
+        bool distance = ip->handler == Handler::Distance;
+        float sum[Lanes] = {};
+        for(uint32_t i = 0; i < ip->n; i++){
+            const uint32_t* A = src(ip->a, i);
+            const uint32_t* B = src(ip->b, i);
+            for(uint32_t l = 0; l < Lanes; l++){
+                float v = distance ? FA - FB : FA;
+                sum[l] += v * v;
+            }
+        }
+        auto* d = word(ip->dst);
+        for(uint32_t l = 0; l < Lanes; l++)
+            BLEND(d, l, bits(std::sqrt(sum[l])));
+        NEXT();
+    }
+    Cross: {
+        for(uint32_t i = 0; i < 3; i++){
+            auto* d = word(ip->dst + i);
+            const uint32_t* A1 = src(ip->a, (i + 1) % 3);
+            const uint32_t* A2 = src(ip->a, (i + 2) % 3);
+            const uint32_t* B1 = src(ip->b, (i + 1) % 3);
+            const uint32_t* B2 = src(ip->b, (i + 2) % 3);
+            for(uint32_t l = 0; l < Lanes; l++)
+                BLEND(d, l, bits(fl(A1[l]) * fl(B2[l]) - fl(A2[l]) * fl(B1[l])));
+        }
+        NEXT();
+    }
+    Normalize: {
+        float scale[Lanes] = {};
+        for(uint32_t i = 0; i < ip->n; i++){
+            const uint32_t* A = src(ip->a, i);
+            for(uint32_t l = 0; l < Lanes; l++)
+                scale[l] += FA * FA;
+        }
+        for(uint32_t l = 0; l < Lanes; l++)
+            scale[l] = 1.0f / std::sqrt(scale[l]);
+        LANEWISE(bits(FA * scale[l]));
+    }
+    Reflect: {
+        float twice_dot[Lanes] = {};
+        for(uint32_t i = 0; i < ip->n; i++){
+            const uint32_t* A = src(ip->a, i);
+            const uint32_t* B = src(ip->b, i);
+            for(uint32_t l = 0; l < Lanes; l++)
+                twice_dot[l] += FB * FA;
+        }
+        for(uint32_t l = 0; l < Lanes; l++)
+            twice_dot[l] += twice_dot[l];
+        LANEWISE(bits(FA - FB * twice_dot[l]));
+    }
+    FaceForward: {
+        uint32_t sign[Lanes];
+        float dot[Lanes] = {};
+        for(uint32_t i = 0; i < ip->n; i++){
+            const uint32_t* B = src(ip->b, i);
+            const uint32_t* C = src(ip->c, i);
+            for(uint32_t l = 0; l < Lanes; l++)
+                dot[l] += fl(C[l]) * FB;
+        }
+        for(uint32_t l = 0; l < Lanes; l++)
+            sign[l] = (dot[l] < 0) ? 0 : 0x80000000u;
+        LANEWISE(A[l] ^ sign[l]);
+    }
+
+    // Control flow only moves the program counters of enabled lanes, schedule picks what runs next
+    Jump: {
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(ACTIVE(l))
+                pc[l] = ip->s;
+        }
+        goto schedule;
+    }
+    Branch: {
+        const uint32_t* A = src(ip->a, 0);
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(ACTIVE(l))
+                pc[l] = A[l] ? ip->b : ip->c;
+        }
+        goto schedule;
+    }
+    Switch: {
+        auto table = (const uint32_t*)ip->data;
+        const uint32_t* A = src(ip->a, 0);
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(!ACTIVE(l))
+                continue;
+
+            pc[l] = ip->s;
+            for(uint32_t i = 0; i < ip->n; i++){
+                if(table[2 * i] == A[l]){
+                    pc[l] = table[2 * i + 1];
+                    break;
+                }
+            }
+        }
+        goto schedule;
+    }
+    Call: {
+        stack[depth++] = CallSite{(uint32_t)(ip + 1 - code), activation};
+        activation = mask;
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(ACTIVE(l))
+                pc[l] = ip->s;
+        }
+        goto schedule;
+    }
+    Return: {
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(ACTIVE(l))
+                pc[l] = done;
+        }
+        goto schedule;
+    }
+    Kill: {
+        killed |= mask;
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(ACTIVE(l)){
+                word(FrameLayout::killed_word)[l] = ~0u;
+                pc[l] = done;
+            }
+        }
+        goto schedule;
+    }
+
+    // Runs the lowest pending instruction of the current function. Once all of its lanes returned, they continue after the call together
+    schedule: {
+        for(;;){
+            auto live = activation & ~killed;
+            uint32_t next = done;
+            for(uint32_t l = 0; l < Lanes; l++){
+                if((live & (1u << l)) && pc[l] < next)
+                    next = pc[l];
+            }
+
+            if(next != done){
+                mask = 0;
+                for(uint32_t l = 0; l < Lanes; l++){
+                    bool enabled = (live & (1u << l)) && pc[l] == next;
+                    mask |= (uint32_t)enabled << l;
+                    m[l] = MASK(enabled);
+                }
+                ip = code + next;
+                DISPATCH();
+            }
+
+            if(depth == 0)
+                return nullptr;
+
+            auto call = stack[--depth];
+            activation = call.activation;
+            for(uint32_t l = 0; l < Lanes; l++){
+                if(live & (1u << l))
+                    pc[l] = call.ret;
+            }
+        }
+    }
+
+    #undef DISPATCH
+    #undef NEXT
+    #undef ACTIVE
+    #undef BLEND
+    #undef LANEWISE
+    #undef MASK
+    #undef FA
+    #undef FB
+}
+
+template class SpmdShader<8>;
+template class SpmdShader<16>;
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../jit.hpp"
+#include "../../simd.hpp"
+#include "frame_layout.hpp"
+#include "interpreter.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// Runs `Lanes` invocations of an entry point with one instruction stream, every frame word becomes a vector of Lanes words.
+// Word w of lane l lives at frame[w * Lanes + l], constants are broadcast to the same layout so both read the same way.
+// Lanes that diverge get their own program counter. Each step runs the lowest pending instruction with only the lanes waiting there enabled,
+// structured SPIR-V lays merge blocks out after their constructs, so lanes wait at merges until the others caught up and run on together.
+// Every write is masked, a lane that left a loop early still sees its values from before
+template<uint32_t Lanes>
+class SpmdShader {
+    public:
+    static_assert(Lanes == 8 || Lanes == 16, "SPMD shaders run 8 or 16 lanes");
+    static constexpr uint32_t all_lanes = (1u << Lanes) - 1;
+
+    SpmdShader(const SpirvJit& code, spv::Id entry_point);
+
+    const FrameLayout& layout() const {
+        return _scalar.layout();
+    }
+
+    // `frame` has to hold layout().size() * Lanes words. Only the lanes in `lanes` run, returns those that weren't killed
+    uint32_t run(uint32_t* frame, uint32_t lanes = all_lanes) const {
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(lanes & (1u << l))
+                frame[FrameLayout::killed_word * Lanes + l] = 0;
+        }
+
+        execute(_code.data(), frame, _constants.data(), lanes);
+
+        uint32_t alive = 0;
+        for(uint32_t l = 0; l < Lanes; l++){
+            if(frame[FrameLayout::killed_word * Lanes + l] == 0)
+                alive |= 1u << l;
+        }
+        return alive & lanes;
+    }
+
+    private:
+    using Instruction = InterpretedShader::Instruction;
+
+    // Returns the handler labels, indexed by Handler, if `code` is nullptr
+    static const void* const* execute(const Instruction* code, uint32_t* frame, const uint32_t* constants, uint32_t lanes);
+
+    InterpretedShader _scalar; // Decodes the entry point and owns the switch tables
+    std::vector<Instruction> _code; // _scalar's code, threaded through the handlers of this execute()
+    std::vector<uint32_t> _constants;
+};
+
+// 16 lanes fill AVX-512 registers, 8 lanes AVX2 ones or two SSE ones
+inline uint32_t spmd_lanes(SimdLevel level = simd_level()){
+    return (level == SimdLevel::AVX512) ? 16 : 8;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../jit.hpp"
+#include "interpreter.hpp"
+#include "native_backend.hpp"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <cstdint>
+
+// What a pipeline holds per shader stage.
+// Starts out interpreted, so the first draw doesn't wait on code generation. Once a shader ran `promotion_threshold` invocations it is lowered to machine code on a background thread,
+// invocations keep going through the interpreter until the native code is published. Both tiers lay out frames the same way, so callers never notice the switch
+class TieredShader {
+    public:
+    static constexpr uint64_t promotion_threshold = 4096;
+
+    TieredShader(std::shared_ptr<const SpirvJit> code, spv::Id entry_point): _code{std::move(code)}, _entry_point{entry_point}, _interpreted{*_code, entry_point} {}
+
+    TieredShader(const TieredShader&) = delete;
+    TieredShader& operator=(const TieredShader&) = delete;
+
+    ~TieredShader(){
+        if(_promotion.valid())
+            _promotion.wait();
+    }
+
+    const FrameLayout& layout() const {
+        return _interpreted.layout();
+    }
+
+    bool native() const {
+        return _native_shader.load(std::memory_order_acquire) != nullptr;
+    }
+
+    // Same contract as NativeShader::run(), safe to call from several threads at once
+    bool run(uint32_t* frame){
+        if(auto shader = _native_shader.load(std::memory_order_acquire))
+            return shader->run(frame);
+
+        if(_invocations.fetch_add(1, std::memory_order_relaxed) + 1 == promotion_threshold)
+            promote();
+
+        return _interpreted.run(frame);
+    }
+
+    private:
+    void promote(){
+        _promotion = std::async(std::launch::async, [this]{
+            try {
+                _native = std::make_unique<NativeShader>(*_code, _entry_point);
+                _native_shader.store(_native.get(), std::memory_order_release);
+            } catch(const std::runtime_error& e){
+                print("JIT: Staying interpreted: {}\n", e.what());
+            }
+        });
+    }
+
+    std::shared_ptr<const SpirvJit> _code;
+    spv::Id _entry_point;
+    InterpretedShader _interpreted;
+
+    std::atomic<uint64_t> _invocations{0};
+    std::future<void> _promotion;
+    std::unique_ptr<NativeShader> _native; // Owned here, only read through _native_shader
+    std::atomic<const NativeShader*> _native_shader{nullptr};
+};
\ No newline at end of file
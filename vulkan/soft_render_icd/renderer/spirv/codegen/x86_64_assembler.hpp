@@ -0,0 +1,255 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <initializer_list>
+
+// Minimal x86-64 encoder for the JIT, only the instructions the backends emit.
+// General purpose instructions are 32 bit unless stated otherwise, SSE instructions are scalar single precision
+namespace x86_64
+{
+    enum Gpr : uint8_t { rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15, no_index = 0xFF };
+    enum Xmm : uint8_t { xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7 };
+
+    enum Condition : uint8_t {
+        Below = 0x2, AboveEqual = 0x3, Equal = 0x4, NotEqual = 0x5, BelowEqual = 0x6, Above = 0x7,
+        Less = 0xC, GreaterEqual = 0xD, LessEqual = 0xE, Greater = 0xF
+    };
+
+    // Predicates of cmpss
+    enum Compare : uint8_t { CmpEq = 0, CmpLt = 1, CmpLe = 2, CmpUnord = 3, CmpNeq = 4, CmpNlt = 5, CmpNle = 6, CmpOrd = 7 };
+
+    // [base + index * scale + disp]
+    struct Mem {
+        Gpr base;
+        int32_t disp = 0;
+        Gpr index = no_index;
+        uint8_t scale = 1;
+    };
+
+    enum class Alu : uint8_t { Add = 0, Or = 1, And = 4, Sub = 5, Xor = 6, Cmp = 7 };
+    enum class Sse : uint8_t { Sqrt = 0x51, And = 0x54, AndNot = 0x55, Or = 0x56, Xor = 0x57, Add = 0x58, Mul = 0x59, Sub = 0x5C, Min = 0x5D, Div = 0x5E, Max = 0x5F };
+
+    struct Label {
+        uint32_t id;
+    };
+
+    class Assembler {
+        public:
+        const std::vector<uint8_t>& code() const {
+            assert(_fixups.empty());
+            return _code;
+        }
+
+        size_t size() const {
+            return _code.size();
+        }
+
+        Label label(){
+            _labels.push_back(-1);
+            return Label{(uint32_t)(_labels.size() - 1)};
+        }
+
+        void bind(Label label){
+            assert(_labels[label.id] < 0);
+            _labels[label.id] = (int64_t)_code.size();
+        }
+
+        size_t offset(Label label) const {
+            assert(_labels[label.id] >= 0);
+            return (size_t)_labels[label.id];
+        }
+
+        // Patches all jumps and calls, every label they refer to has to be bound by now
+        void finish(){
+            for(const auto& fixup : _fixups){
+                auto target = _labels[fixup.label];
+                assert(target >= 0);
+
+                int32_t rel = (int32_t)(target - (int64_t)(fixup.at + 4));
+                for(int i = 0; i < 4; i++)
+                    _code[fixup.at + i] = (uint8_t)(rel >> (8 * i));
+            }
+            _fixups.clear();
+        }
+
+        // Moves
+        void mov(Gpr dst, const Mem& src){ rm({}, false, {0x8B}, dst, src); }
+        void mov(const Mem& dst, Gpr src){ rm({}, false, {0x89}, src, dst); }
+        void mov(Gpr dst, Gpr src){ rr({}, false, {0x89}, src, dst); }
+        void mov(Gpr dst, uint32_t imm){
+            rex(false, 0, 0, dst);
+            byte(0xB8 + (dst & 7));
+            dword(imm);
+        }
+        void mov(const Mem& dst, uint32_t imm){
+            rm({}, false, {0xC7}, 0, dst);
+            dword(imm);
+        }
+        void mov64(Gpr dst, Gpr src){ rr({}, true, {0x89}, src, dst); }
+        void mov64(Gpr dst, uint64_t imm){
+            rex(true, 0, 0, dst);
+            byte(0xB8 + (dst & 7));
+            dword((uint32_t)imm);
+            dword((uint32_t)(imm >> 32));
+        }
+        void lea64(Gpr dst, const Mem& src){ rm({}, true, {0x8D}, dst, src); }
+
+        // Integer arithmetic
+        void alu(Alu op, Gpr dst, Gpr src){ rr({}, false, {(uint8_t)(((uint8_t)op << 3) | 0x01)}, src, dst); }
+        void alu(Alu op, Gpr dst, const Mem& src){ rm({}, false, {(uint8_t)(((uint8_t)op << 3) | 0x03)}, dst, src); }
+        void alu(Alu op, Gpr dst, uint32_t imm){
+            rr({}, false, {0x81}, (uint8_t)op, dst);
+            dword(imm);
+        }
+        void alu64(Alu op, Gpr dst, uint8_t imm){
+            rr({}, true, {0x83}, (uint8_t)op, dst);
+            byte(imm);
+        }
+        void imul(Gpr dst, Gpr src){ rr({}, false, {0x0F, 0xAF}, dst, src); }
+        void imul(Gpr dst, Gpr src, uint32_t imm){
+            rr({}, false, {0x69}, dst, src);
+            dword(imm);
+        }
+        void neg(Gpr reg){ rr({}, false, {0xF7}, 3, reg); }
+        void bit_not(Gpr reg){ rr({}, false, {0xF7}, 2, reg); }
+        void test(Gpr a, Gpr b){ rr({}, false, {0x85}, b, a); }
+        void cdq(){ byte(0x99); }
+        void idiv(Gpr divisor){ rr({}, false, {0xF7}, 7, divisor); }
+        void div(Gpr divisor){ rr({}, false, {0xF7}, 6, divisor); }
+        // Shift counts are in cl
+        void shl(Gpr reg){ rr({}, false, {0xD3}, 4, reg); }
+        void shr(Gpr reg){ rr({}, false, {0xD3}, 5, reg); }
+        void sar(Gpr reg){ rr({}, false, {0xD3}, 7, reg); }
+        // All ones if the condition holds, zero otherwise
+        void set_mask(Condition cc, Gpr reg){
+            rr({}, false, {0x0F, (uint8_t)(0x90 + cc)}, 0, reg, reg >= rsp);
+            rr({}, false, {0x0F, 0xB6}, reg, reg, reg >= rsp);
+            neg(reg);
+        }
+        void cmov(Condition cc, Gpr dst, Gpr src){ rr({}, false, {0x0F, (uint8_t)(0x40 + cc)}, dst, src); }
+
+        // SSE
+        void movss(Xmm dst, const Mem& src){ rm({0xF3}, false, {0x0F, 0x10}, dst, src); }
+        void movss(const Mem& dst, Xmm src){ rm({0xF3}, false, {0x0F, 0x11}, src, dst); }
+        void movaps(Xmm dst, Xmm src){ rr({}, false, {0x0F, 0x28}, dst, src); }
+        void movd(Xmm dst, Gpr src){ rr({0x66}, false, {0x0F, 0x6E}, dst, src); }
+        void movd(Gpr dst, Xmm src){ rr({0x66}, false, {0x0F, 0x7E}, src, dst); }
+        // Bitwise ones work on the whole register, the rest on the lowest float
+        void sse(Sse op, Xmm dst, Xmm src){
+            if(is_bitwise(op))
+                rr({}, false, {0x0F, (uint8_t)op}, dst, src);
+            else
+                rr({0xF3}, false, {0x0F, (uint8_t)op}, dst, src);
+        }
+        void sse(Sse op, Xmm dst, const Mem& src){
+            assert(!is_bitwise(op)); // Would read 16 bytes
+            rm({0xF3}, false, {0x0F, (uint8_t)op}, dst, src);
+        }
+        void cmpss(Compare predicate, Xmm dst, Xmm src){
+            rr({0xF3}, false, {0x0F, 0xC2}, dst, src);
+            byte(predicate);
+        }
+        void cvttss2si(Gpr dst, Xmm src){ rr({0xF3}, false, {0x0F, 0x2C}, dst, src); }
+        void cvttss2si64(Gpr dst, Xmm src){ rr({0xF3}, true, {0x0F, 0x2C}, dst, src); }
+        void cvtsi2ss(Xmm dst, Gpr src){ rr({0xF3}, false, {0x0F, 0x2A}, dst, src); }
+        void cvtsi2ss64(Xmm dst, Gpr src){ rr({0xF3}, true, {0x0F, 0x2A}, dst, src); }
+
+        // Control flow, all with 32 bit displacements
+        void jmp(Label target){
+            byte(0xE9);
+            fixup(target);
+        }
+        void jcc(Condition cc, Label target){
+            byte(0x0F);
+            byte(0x80 + cc);
+            fixup(target);
+        }
+        void call(Label target){
+            byte(0xE8);
+            fixup(target);
+        }
+        void call(Gpr target){ rr({}, false, {0xFF}, 2, target); }
+        void ret(){ byte(0xC3); }
+        void ud2(){ byte(0x0F); byte(0x0B); }
+        void push(Gpr reg){
+            rex(false, 0, 0, reg);
+            byte(0x50 + (reg & 7));
+        }
+        void pop(Gpr reg){
+            rex(false, 0, 0, reg);
+            byte(0x58 + (reg & 7));
+        }
+
+        private:
+        static bool is_bitwise(Sse op){
+            return op == Sse::And || op == Sse::AndNot || op == Sse::Or || op == Sse::Xor;
+        }
+
+        void byte(uint8_t b){
+            _code.push_back(b);
+        }
+
+        void dword(uint32_t d){
+            for(int i = 0; i < 4; i++)
+                byte((uint8_t)(d >> (8 * i)));
+        }
+
+        void fixup(Label target){
+            _fixups.push_back(Fixup{_code.size(), target.id});
+            dword(0);
+        }
+
+        void rex(bool w, uint8_t reg, uint8_t index, uint8_t base, bool force = false){
+            uint8_t bits = (w << 3) | (((reg >> 3) & 1) << 2) | (((index >> 3) & 1) << 1) | ((base >> 3) & 1);
+            if(bits || force)
+                byte(0x40 | bits);
+        }
+
+        // Register to register form, `reg` is a register or an opcode extension. `force_rex` gives access to spl, bpl, sil and dil
+        void rr(std::initializer_list<uint8_t> prefix, bool w, std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t rm, bool force_rex = false){
+            for(auto b : prefix)
+                byte(b);
+            rex(w, reg, 0, rm, force_rex);
+            for(auto b : opcode)
+                byte(b);
+            byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+        }
+
+        // Register to memory form, always with a displacement so rbp and r13 need no special case
+        void rm(std::initializer_list<uint8_t> prefix, bool w, std::initializer_list<uint8_t> opcode, uint8_t reg, const Mem& m){
+            for(auto b : prefix)
+                byte(b);
+
+            bool sib = (m.index != no_index) || ((m.base & 7) == rsp);
+            rex(w, reg, (m.index != no_index) ? m.index : 0, m.base);
+            for(auto b : opcode)
+                byte(b);
+
+            bool disp8 = (m.disp >= -128 && m.disp <= 127);
+            byte(((disp8 ? 1 : 2) << 6) | ((reg & 7) << 3) | (sib ? 4 : (m.base & 7)));
+
+            if(sib){
+                assert(m.index != rsp);
+                uint8_t scale = (m.scale == 8) ? 3 : (m.scale == 4) ? 2 : (m.scale == 2) ? 1 : 0;
+                uint8_t index = (m.index != no_index) ? (m.index & 7) : 4;
+                byte((scale << 6) | (index << 3) | (m.base & 7));
+            }
+
+            if(disp8)
+                byte((uint8_t)(int8_t)m.disp);
+            else
+                dword((uint32_t)m.disp);
+        }
+
+        struct Fixup {
+            size_t at;
+            uint32_t label;
+        };
+
+        std::vector<uint8_t> _code;
+        std::vector<int64_t> _labels;
+        std::vector<Fixup> _fixups;
+    };
+}
\ No newline at end of file
@@ -1,14 +1,15 @@
 #include "jit.hpp"
+#include "opcode_table.hpp"
 
-#include <unordered_map>
 #include <string_view>
 
 using OpcodeFunction = void (*)(SpirvJit&, uint32_t, const uint32_t*);
 
 #include "ops/meta_ops.hpp"
 #include "ops/type_ops.hpp"
+#include "ops/function_ops.hpp"
 
-std::unordered_map<spv::Op, OpcodeFunction> opcode_map = {
+constexpr OpcodeEntry<OpcodeFunction> opcode_entries[] = {
     {spv::Op::OpSource, execute_OpSource},
     {spv::Op::OpSourceExtension, execute_OpSourceExtension},
     {spv::Op::OpName, execute_OpName},
@@ -28,15 +29,134 @@ std::unordered_map<spv::Op, OpcodeFunction> opcode_map = {
     {spv::Op::OpTypeVector, execute_OpTypeVector},
 
     {spv::Op::OpTypeArray, execute_OpTypeArray},
+    {spv::Op::OpTypeMatrix, execute_OpTypeMatrix},
+    {spv::Op::OpTypeStruct, execute_OpTypeStruct},
+    {spv::Op::OpTypePointer, execute_OpTypePointer},
 
     {spv::Op::OpTypeFunction, execute_OpTypeFunction},
 
     {spv::Op::OpConstant, execute_OpConstant},
+    {spv::Op::OpConstantTrue, execute_OpConstantTrue},
+    {spv::Op::OpConstantFalse, execute_OpConstantFalse},
+    {spv::Op::OpConstantComposite, execute_OpConstantComposite},
+    {spv::Op::OpConstantNull, execute_OpConstantNull},
 
     {spv::Op::OpDecorate, execute_OpDecorate},
-    {spv::Op::OpMemberDecorate, execute_OpMemberDecorate}
+    {spv::Op::OpMemberDecorate, execute_OpMemberDecorate},
+
+    {spv::Op::OpExecutionMode, execute_OpExecutionMode},
+
+    {spv::Op::OpNop, execute_OpIgnored},
+    {spv::Op::OpString, execute_OpIgnored},
+    {spv::Op::OpLine, execute_OpIgnored},
+    {spv::Op::OpNoLine, execute_OpIgnored},
+    {spv::Op::OpModuleProcessed, execute_OpIgnored},
+
+    {spv::Op::OpFunction, execute_OpFunction},
+    {spv::Op::OpFunctionParameter, execute_OpFunctionParameter},
+    {spv::Op::OpFunctionEnd, execute_OpFunctionEnd},
+    {spv::Op::OpLabel, execute_OpLabel},
+    {spv::Op::OpVariable, execute_OpVariable},
+    {spv::Op::OpUndef, execute_OpUndef},
+
+    {spv::Op::OpLoad, execute_body<spv::Op::OpLoad>},
+    {spv::Op::OpStore, execute_body<spv::Op::OpStore>},
+    {spv::Op::OpAccessChain, execute_body<spv::Op::OpAccessChain>},
+    {spv::Op::OpInBoundsAccessChain, execute_body<spv::Op::OpInBoundsAccessChain>},
+    {spv::Op::OpCopyMemory, execute_body<spv::Op::OpCopyMemory>},
+    {spv::Op::OpCopyObject, execute_body<spv::Op::OpCopyObject>},
+
+    {spv::Op::OpBranch, execute_body<spv::Op::OpBranch>},
+    {spv::Op::OpBranchConditional, execute_body<spv::Op::OpBranchConditional>},
+    {spv::Op::OpSwitch, execute_body<spv::Op::OpSwitch>},
+    {spv::Op::OpSelectionMerge, execute_body<spv::Op::OpSelectionMerge>},
+    {spv::Op::OpLoopMerge, execute_body<spv::Op::OpLoopMerge>},
+    {spv::Op::OpReturn, execute_body<spv::Op::OpReturn>},
+    {spv::Op::OpReturnValue, execute_body<spv::Op::OpReturnValue>},
+    {spv::Op::OpKill, execute_body<spv::Op::OpKill>},
+    {spv::Op::OpUnreachable, execute_body<spv::Op::OpUnreachable>},
+    {spv::Op::OpPhi, execute_body<spv::Op::OpPhi>},
+    {spv::Op::OpFunctionCall, execute_body<spv::Op::OpFunctionCall>},
+
+    {spv::Op::OpFAdd, execute_body<spv::Op::OpFAdd>},
+    {spv::Op::OpFSub, execute_body<spv::Op::OpFSub>},
+    {spv::Op::OpFMul, execute_body<spv::Op::OpFMul>},
+    {spv::Op::OpFDiv, execute_body<spv::Op::OpFDiv>},
+    {spv::Op::OpFMod, execute_body<spv::Op::OpFMod>},
+    {spv::Op::OpFRem, execute_body<spv::Op::OpFRem>},
+    {spv::Op::OpFNegate, execute_body<spv::Op::OpFNegate>},
+    {spv::Op::OpIAdd, execute_body<spv::Op::OpIAdd>},
+    {spv::Op::OpISub, execute_body<spv::Op::OpISub>},
+    {spv::Op::OpIMul, execute_body<spv::Op::OpIMul>},
+    {spv::Op::OpSDiv, execute_body<spv::Op::OpSDiv>},
+    {spv::Op::OpUDiv, execute_body<spv::Op::OpUDiv>},
+    {spv::Op::OpSRem, execute_body<spv::Op::OpSRem>},
+    {spv::Op::OpSMod, execute_body<spv::Op::OpSMod>},
+    {spv::Op::OpUMod, execute_body<spv::Op::OpUMod>},
+    {spv::Op::OpSNegate, execute_body<spv::Op::OpSNegate>},
+
+    {spv::Op::OpNot, execute_body<spv::Op::OpNot>},
+    {spv::Op::OpBitwiseAnd, execute_body<spv::Op::OpBitwiseAnd>},
+    {spv::Op::OpBitwiseOr, execute_body<spv::Op::OpBitwiseOr>},
+    {spv::Op::OpBitwiseXor, execute_body<spv::Op::OpBitwiseXor>},
+    {spv::Op::OpShiftLeftLogical, execute_body<spv::Op::OpShiftLeftLogical>},
+    {spv::Op::OpShiftRightLogical, execute_body<spv::Op::OpShiftRightLogical>},
+    {spv::Op::OpShiftRightArithmetic, execute_body<spv::Op::OpShiftRightArithmetic>},
+
+    {spv::Op::OpIEqual, execute_body<spv::Op::OpIEqual>},
+    {spv::Op::OpINotEqual, execute_body<spv::Op::OpINotEqual>},
+    {spv::Op::OpSLessThan, execute_body<spv::Op::OpSLessThan>},
+    {spv::Op::OpSLessThanEqual, execute_body<spv::Op::OpSLessThanEqual>},
+    {spv::Op::OpSGreaterThan, execute_body<spv::Op::OpSGreaterThan>},
+    {spv::Op::OpSGreaterThanEqual, execute_body<spv::Op::OpSGreaterThanEqual>},
+    {spv::Op::OpULessThan, execute_body<spv::Op::OpULessThan>},
+    {spv::Op::OpULessThanEqual, execute_body<spv::Op::OpULessThanEqual>},
+    {spv::Op::OpUGreaterThan, execute_body<spv::Op::OpUGreaterThan>},
+    {spv::Op::OpUGreaterThanEqual, execute_body<spv::Op::OpUGreaterThanEqual>},
+    {spv::Op::OpFOrdEqual, execute_body<spv::Op::OpFOrdEqual>},
+    {spv::Op::OpFOrdNotEqual, execute_body<spv::Op::OpFOrdNotEqual>},
+    {spv::Op::OpFOrdLessThan, execute_body<spv::Op::OpFOrdLessThan>},
+    {spv::Op::OpFOrdGreaterThan, execute_body<spv::Op::OpFOrdGreaterThan>},
+    {spv::Op::OpFOrdLessThanEqual, execute_body<spv::Op::OpFOrdLessThanEqual>},
+    {spv::Op::OpFOrdGreaterThanEqual, execute_body<spv::Op::OpFOrdGreaterThanEqual>},
+    {spv::Op::OpFUnordEqual, execute_body<spv::Op::OpFUnordEqual>},
+    {spv::Op::OpFUnordNotEqual, execute_body<spv::Op::OpFUnordNotEqual>},
+    {spv::Op::OpFUnordLessThan, execute_body<spv::Op::OpFUnordLessThan>},
+    {spv::Op::OpFUnordGreaterThan, execute_body<spv::Op::OpFUnordGreaterThan>},
+    {spv::Op::OpFUnordLessThanEqual, execute_body<spv::Op::OpFUnordLessThanEqual>},
+    {spv::Op::OpFUnordGreaterThanEqual, execute_body<spv::Op::OpFUnordGreaterThanEqual>},
+    {spv::Op::OpLogicalAnd, execute_body<spv::Op::OpLogicalAnd>},
+    {spv::Op::OpLogicalOr, execute_body<spv::Op::OpLogicalOr>},
+    {spv::Op::OpLogicalNot, execute_body<spv::Op::OpLogicalNot>},
+    {spv::Op::OpLogicalEqual, execute_body<spv::Op::OpLogicalEqual>},
+    {spv::Op::OpLogicalNotEqual, execute_body<spv::Op::OpLogicalNotEqual>},
+    {spv::Op::OpSelect, execute_body<spv::Op::OpSelect>},
+    {spv::Op::OpAny, execute_body<spv::Op::OpAny>},
+    {spv::Op::OpAll, execute_body<spv::Op::OpAll>},
+
+    {spv::Op::OpConvertFToS, execute_body<spv::Op::OpConvertFToS>},
+    {spv::Op::OpConvertFToU, execute_body<spv::Op::OpConvertFToU>},
+    {spv::Op::OpConvertSToF, execute_body<spv::Op::OpConvertSToF>},
+    {spv::Op::OpConvertUToF, execute_body<spv::Op::OpConvertUToF>},
+    {spv::Op::OpBitcast, execute_body<spv::Op::OpBitcast>},
+
+    {spv::Op::OpCompositeConstruct, execute_body<spv::Op::OpCompositeConstruct>},
+    {spv::Op::OpCompositeExtract, execute_body<spv::Op::OpCompositeExtract>},
+    {spv::Op::OpCompositeInsert, execute_body<spv::Op::OpCompositeInsert>},
+    {spv::Op::OpVectorShuffle, execute_body<spv::Op::OpVectorShuffle>},
+    {spv::Op::OpVectorExtractDynamic, execute_body<spv::Op::OpVectorExtractDynamic>},
+    {spv::Op::OpVectorInsertDynamic, execute_body<spv::Op::OpVectorInsertDynamic>},
+    {spv::Op::OpVectorTimesScalar, execute_body<spv::Op::OpVectorTimesScalar>},
+    {spv::Op::OpMatrixTimesScalar, execute_body<spv::Op::OpMatrixTimesScalar>},
+    {spv::Op::OpMatrixTimesVector, execute_body<spv::Op::OpMatrixTimesVector>},
+    {spv::Op::OpVectorTimesMatrix, execute_body<spv::Op::OpVectorTimesMatrix>},
+    {spv::Op::OpMatrixTimesMatrix, execute_body<spv::Op::OpMatrixTimesMatrix>},
+    {spv::Op::OpDot, execute_body<spv::Op::OpDot>},
+
+    {spv::Op::OpExtInst, execute_body<spv::Op::OpExtInst>}
 };
 
+using Opcodes = OpcodeTable<opcode_entries>;
 
 SpirvJit::SpirvJit(const uint32_t* data, size_t size){
     const auto& header = *(Header*)data;
@@ -51,22 +171,60 @@ SpirvJit::SpirvJit(const uint32_t* data, size_t size){
 
     const uint32_t* instructions = data + 5; // Size of header
     const uint32_t* limit = data + (size / 4);
+
+    analyze_entry_points(instructions, limit);
+
     while(instructions < limit){
         auto opcode = instructions[0];
         auto op = (spv::Op)(opcode & spv::OpCodeMask);
         auto len = (opcode & ~spv::OpCodeMask) >> spv::WordCountShift;
 
-        if(opcode_map.count(op) == 0){
+        auto function = Opcodes::lookup(op);
+        if(!function){
             print_var_list();
             print("Unimplemented Opcode: {:d}\n", (uint32_t)op);
             throw std::runtime_error("JIT: Unimplemented Opcode");
         }
-        opcode_map[op](*this, len, instructions + 1);
+        function(*this, len, instructions + 1);
 
         instructions += len;
     }
 }
 
+void SpirvJit::begin_function(spv::Id id, spv::Id return_type){
+    if(_in_function)
+        throw std::runtime_error("JIT: Nested OpFunction");
+
+    functions.push_back(Function{id, return_type, {}, {}, {}});
+    _in_function = true;
+}
+
+void SpirvJit::end_function(){
+    if(!_in_function)
+        throw std::runtime_error("JIT: OpFunctionEnd outside of a function");
+
+    _in_function = false;
+}
+
+void SpirvJit::record(spv::Op op, uint32_t instruction_len, const uint32_t* data){
+    auto* function = current_function();
+    if(!function || function->blocks.empty())
+        throw std::runtime_error("JIT: Instruction outside of a block");
+
+    bool has_result, has_type;
+    spv::HasResultAndType(op, &has_result, &has_type);
+
+    Instruction instruction{op, 0, 0, {}};
+    const uint32_t* end = data + (instruction_len - 1);
+    if(has_type)
+        instruction.type = *data++;
+    if(has_result)
+        instruction.result = *data++;
+    instruction.operands.assign(data, end);
+
+    function->blocks.back().instructions.push_back(std::move(instruction));
+}
+
 void SpirvJit::load_extension(const std::string& extension){
     print("Unknown extension: {}\n", extension);
 }
@@ -110,6 +268,16 @@ void SpirvJit::print_var_list(){
                 for(const auto id : var.interface)
                     print(" %{:d}", id);
                 print("\n");
+                print("\t- Discards: {}, Writes Depth: {}, Side Effects: {}, Early Fragment Tests: {}\n", var.entry_point.properties.discards, var.entry_point.properties.writes_depth,
+                      var.entry_point.properties.side_effects, var.entry_point.properties.early_fragment_tests);
+                break;
+            case Var::Type::Variable:
+                print("\t- Type: Variable\n");
+                print("\t- Storage Class: {:d}\n", (uint32_t)var.variable.storage);
+                break;
+            case Var::Type::Function:
+                print("\t- Type: Function\n");
+                print("\t- Blocks: {:d}\n", functions[var.function.index].blocks.size());
                 break;
             case Var::Type::Constant:
                 print("\t- Type: Constant\n");
@@ -119,6 +287,7 @@ void SpirvJit::print_var_list(){
                     case Var::TypeVar::Type::UInt: print("\t- Value: {}\n", var.constant.unsigned_int); break;
                     case Var::TypeVar::Type::SInt: print("\t- Value: {}\n", var.constant.signed_int); break;
                     case Var::TypeVar::Type::Float: print("\t- value: //TODO: Float printing\n"); break;
+                    default: break; // Booleans and composites
                 }
         }
     }
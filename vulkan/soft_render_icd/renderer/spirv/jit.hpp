@@ -4,8 +4,10 @@
 #include <cassert>
 #include "../../../../common/print.hpp"
 
+#define SPV_ENABLE_UTILITY_CODE
 #include "spirv.hpp"
 #include "spirv_print.hpp"
+#include "properties.hpp"
 
 #include <vector>
 #include <unordered_map>
@@ -27,14 +29,14 @@ struct SpirvJit {
     };
 
     struct Var {
-        enum class Type { None, EntryPoint, Extension, Type, Constant };
+        enum class Type { None, EntryPoint, Extension, Type, Constant, Variable, Function };
         Type type = Type::None;
         std::string name;
         std::unordered_map<spv::Decoration, Decoration> decorations;
         std::vector<spv::Id> interface;
 
         struct TypeVar {
-            enum class Type { Void, Bool, SInt, UInt, Float, Function, Vector, Array };
+            enum class Type { Void, Bool, SInt, UInt, Float, Function, Vector, Array, Matrix, Struct, Pointer };
             Type type;
             
             union {
@@ -49,13 +51,20 @@ struct SpirvJit {
                 struct {
                     size_t n;
                     uint32_t member_type;
-                } composite;
+                } composite; // Vectors, arrays, and matrices of column vectors. Struct member types are in `interface`
+
+                struct {
+                    spv::StorageClass storage;
+                    uint32_t type;
+                } pointer;
             };
         } type_var;
 
         struct {
             spv::ExecutionModel execution;
             std::string name;
+            EntryPointProperties properties;
+            std::vector<spv::ExecutionMode> modes;
         } entry_point;
 
         struct {
@@ -81,9 +90,55 @@ struct SpirvJit {
                 float vec[4];
                 double dvec[4];
             };
+
+            std::vector<spv::Id> constituents; // OpConstantComposite
         } constant;
+
+        // Module scope OpVariable
+        struct {
+            uint32_t type; // Pointer type
+            spv::StorageClass storage;
+            spv::Id initializer; // 0 if none
+        } variable;
+
+        struct {
+            size_t index; // Into `functions`, entry points have one too
+        } function;
     };
     std::vector<Var> variables;
+
+    // An instruction of a function body as it appears in the module
+    struct Instruction {
+        spv::Op op;
+        spv::Id type; // Result type, 0 if the instruction has none
+        spv::Id result; // 0 if the instruction has none
+        std::vector<uint32_t> operands; // Words after the result id
+    };
+
+    struct Block {
+        spv::Id label;
+        std::vector<Instruction> instructions;
+    };
+
+    struct Function {
+        spv::Id id;
+        spv::Id return_type;
+        std::vector<spv::Id> parameters;
+        std::vector<spv::Id> parameter_types;
+        std::vector<Block> blocks;
+    };
+    std::vector<Function> functions;
+
+    // The function whose body is being parsed, nullptr outside of functions
+    Function* current_function(){
+        return _in_function ? &functions.back() : nullptr;
+    }
+
+    void begin_function(spv::Id id, spv::Id return_type);
+    void end_function();
+
+    // Appends an instruction to the current block, `data` are the words after the opcode
+    void record(spv::Op op, uint32_t instruction_len, const uint32_t* data);
     
     private:
     using Word = uint32_t;
@@ -95,7 +150,10 @@ struct SpirvJit {
         Word reserved;
     };
 
+    void analyze_entry_points(const uint32_t* instructions, const uint32_t* limit);
     void print_var_list();
+
+    bool _in_function = false;
 };
 
 template<>
@@ -108,6 +166,8 @@ struct format::formatter<SpirvJit::Var::Type> {
             case SpirvJit::Var::Type::Extension: it.write("Instruction Extension"); break;
             case SpirvJit::Var::Type::Type: it.write("Type variable"); break;
             case SpirvJit::Var::Type::Constant: it.write("Constant"); break;
+            case SpirvJit::Var::Type::Variable: it.write("Variable"); break;
+            case SpirvJit::Var::Type::Function: it.write("Function"); break;
         }
     }
 };
@@ -125,6 +185,9 @@ struct format::formatter<SpirvJit::Var::TypeVar::Type> {
             case SpirvJit::Var::TypeVar::Type::Vector: it.write("Vector"); break;
             case SpirvJit::Var::TypeVar::Type::Array: it.write("Array"); break;
             case SpirvJit::Var::TypeVar::Type::Function: it.write("Function"); break;
+            case SpirvJit::Var::TypeVar::Type::Matrix: it.write("Matrix"); break;
+            case SpirvJit::Var::TypeVar::Type::Struct: it.write("Struct"); break;
+            case SpirvJit::Var::TypeVar::Type::Pointer: it.write("Pointer"); break;
         }
     }
 };
\ No newline at end of file
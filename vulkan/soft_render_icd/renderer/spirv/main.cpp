@@ -1,10 +1,17 @@
 #include "jit.hpp"
+#include "codegen/tiered_shader.hpp"
+#include "codegen/native_backend.hpp"
+#include "codegen/spmd_shader.hpp"
+#include "opt/passes.hpp"
 
 #include <fstream>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 
 std::vector<std::byte> read_binary_file(const std::string& name){
     std::ifstream file{name, std::ios::ate | std::ios::binary};
@@ -22,7 +29,70 @@ std::vector<std::byte> read_binary_file(const std::string& name){
     return buf;
 }
 
+// Runs a batch through the SPMD tier and each of its lanes through the interpreter, returns the number of lanes that disagree.
+// Every input word of lane l holds the float l, so branches on inputs diverge between lanes
+template<uint32_t Lanes>
+uint32_t compare_spmd(const SpirvJit& jit, spv::Id entry_point){
+    InterpretedShader scalar{jit, entry_point};
+    SpmdShader<Lanes> spmd{jit, entry_point};
+    const auto& layout = scalar.layout();
+
+    std::vector<uint32_t> wide(layout.size() * Lanes, 0);
+    for(const auto& variable : layout.interface()){
+        if(variable.storage != spv::StorageClass::Input)
+            continue;
+
+        for(uint32_t w = 0; w < variable.words; w++){
+            for(uint32_t l = 0; l < Lanes; l++){
+                float value = l;
+                memcpy(&wide[(variable.offset + w) * Lanes + l], &value, sizeof(value));
+            }
+        }
+    }
+
+    auto inputs = wide;
+    uint32_t alive = spmd.run(wide.data());
+
+    uint32_t mismatches = 0;
+    std::vector<uint32_t> frame(layout.size());
+    for(uint32_t l = 0; l < Lanes; l++){
+        for(uint32_t w = 0; w < layout.size(); w++)
+            frame[w] = inputs[w * Lanes + l];
+        bool completed = scalar.run(frame.data());
+
+        bool same = (completed == (((alive >> l) & 1) != 0));
+        for(const auto& variable : layout.interface()){
+            if(variable.storage != spv::StorageClass::Output)
+                continue;
+            for(uint32_t w = variable.offset; w < variable.offset + variable.words; w++)
+                same &= (frame[w] == wide[w * Lanes + l]);
+        }
+        mismatches += !same;
+    }
+    return mismatches;
+}
+
 int main(){
     auto code = read_binary_file("../vulkan/soft_render_icd/renderer/spirv/test.spv");
-    SpirvJit jit{(const uint32_t*)code.data(), code.size()};
+    SpirvJit parsed{(const uint32_t*)code.data(), code.size()};
+    opt::optimize(parsed);
+    auto jit = std::make_shared<const SpirvJit>(std::move(parsed));
+
+    for(spv::Id id = 0; id < jit->variables.size(); id++){
+        if(jit->variables[id].type != SpirvJit::Var::Type::EntryPoint)
+            continue;
+
+        TieredShader shader{jit, id};
+        print("Decoded entry point \"{}\": {:d} frame words, {:d} constants\n", jit->variables[id].entry_point.name, shader.layout().size(), shader.layout().constants().size());
+
+        // Lowered right away rather than on the promotion thread, so instructions the native tier can't handle show up here
+        NativeShader native{*jit, id};
+        std::vector<uint32_t> frame(native.layout().size(), 0);
+        bool completed = native.run(frame.data());
+        print("Ran entry point \"{}\" natively: {}\n", jit->variables[id].entry_point.name, completed ? "completed" : "killed");
+
+        auto lanes = spmd_lanes();
+        auto mismatches = (lanes == 16) ? compare_spmd<16>(*jit, id) : compare_spmd<8>(*jit, id);
+        print("Ran entry point \"{}\" on {:d} SPMD lanes: {:d} differ from the interpreter\n", jit->variables[id].entry_point.name, lanes, mismatches);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "spirv.hpp"
+
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include <cstddef>
+
+template<typename F>
+struct OpcodeEntry {
+    spv::Op op;
+    F function;
+};
+
+// Dense table indexed by opcode, up to the highest opcode in `Entries`. Opcodes without an entry are nullptr.
+// Built at compile time, so a lookup is one bounds check and one load
+template<const auto& Entries>
+struct OpcodeTable {
+    using Function = std::remove_cv_t<decltype(Entries[0].function)>;
+
+    static constexpr size_t size = [](){
+        size_t size = 0;
+        for(const auto& entry : Entries)
+            size = std::max<size_t>(size, (size_t)entry.op + 1);
+        return size;
+    }();
+
+    static constexpr std::array<Function, size> table = [](){
+        std::array<Function, size> table{};
+        for(const auto& entry : Entries)
+            table[(size_t)entry.op] = entry.function;
+        return table;
+    }();
+
+    static constexpr Function lookup(spv::Op op){
+        return ((size_t)op < size) ? table[(size_t)op] : nullptr;
+    }
+};
\ No newline at end of file
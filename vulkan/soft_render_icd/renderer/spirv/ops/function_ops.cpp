@@ -0,0 +1,70 @@
+#include "function_ops.hpp"
+
+void execute_OpFunction(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
+    auto return_type = data[0];
+    auto id = data[1];
+
+    // Entry points keep their type, OpEntryPoint comes first
+    auto& var = code.variables[id];
+    if(var.type != SpirvJit::Var::Type::EntryPoint)
+        var.type = SpirvJit::Var::Type::Function;
+    var.function.index = code.functions.size();
+
+    code.begin_function(id, return_type);
+}
+
+void execute_OpFunctionParameter(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
+    auto type = data[0];
+    auto id = data[1];
+
+    auto* function = code.current_function();
+    assert(function && function->blocks.empty());
+
+    function->parameters.push_back(id);
+    function->parameter_types.push_back(type);
+}
+
+void execute_OpFunctionEnd(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, [[maybe_unused]] const uint32_t* data){
+    code.end_function();
+}
+
+void execute_OpLabel(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
+    auto id = data[0];
+
+    auto* function = code.current_function();
+    if(!function)
+        throw std::runtime_error("JIT: OpLabel outside of a function");
+
+    function->blocks.push_back(SpirvJit::Block{id, {}});
+}
+
+void execute_OpVariable(SpirvJit& code, uint32_t instruction_len, const uint32_t* data){
+    if(code.current_function()){
+        code.record(spv::Op::OpVariable, instruction_len, data);
+        return;
+    }
+
+    auto type = data[0];
+    auto id = data[1];
+    auto storage = (spv::StorageClass)data[2];
+
+    code.variables[id].type = SpirvJit::Var::Type::Variable;
+    code.variables[id].variable.type = type;
+    code.variables[id].variable.storage = storage;
+    code.variables[id].variable.initializer = (instruction_len > 4) ? data[3] : 0;
+}
+
+// Any value will do, module scope ones become null constants
+void execute_OpUndef(SpirvJit& code, uint32_t instruction_len, const uint32_t* data){
+    if(code.current_function()){
+        code.record(spv::Op::OpUndef, instruction_len, data);
+        return;
+    }
+
+    auto type = data[0];
+    auto id = data[1];
+
+    code.variables[id].type = SpirvJit::Var::Type::Constant;
+    code.variables[id].constant.type = type;
+    code.variables[id].constant.unsigned_int = 0;
+}
\ No newline at end of file
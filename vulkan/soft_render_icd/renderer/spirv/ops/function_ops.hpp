@@ -0,0 +1,18 @@
+#pragma once
+
+#include "jit.hpp"
+
+void execute_OpFunction(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpFunctionParameter(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpFunctionEnd(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpLabel(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+
+// Module scope variables are declarations, function scope ones are part of the body
+void execute_OpVariable(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpUndef(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+
+// Everything else in a function body is only recorded while parsing, backends lower it once the whole module is known
+template<spv::Op Op>
+void execute_body(SpirvJit& code, uint32_t instruction_len, const uint32_t* data){
+    code.record(Op, instruction_len, data);
+}
\ No newline at end of file
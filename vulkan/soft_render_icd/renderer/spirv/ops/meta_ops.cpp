@@ -77,6 +77,13 @@ void execute_OpEntryPoint(SpirvJit& code, uint32_t instruction_len, const uint32
         var.interface.push_back(data[off]);
 }
 
+void execute_OpExecutionMode(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
+    auto id = data[0];
+    auto mode = (spv::ExecutionMode)data[1];
+
+    code.variables[id].entry_point.modes.push_back(mode); // TODO: Modes with operands, like LocalSize
+}
+
 void execute_OpCapability(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
     auto cap = (spv::Capability)data[0];
 
@@ -131,3 +138,5 @@ void execute_OpMemberDecorate(SpirvJit& code, [[maybe_unused]] uint32_t instruct
 
     parse_decoration(decorations[decoration], decoration, data + 3);
 }
+
+void execute_OpIgnored([[maybe_unused]] SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, [[maybe_unused]] const uint32_t* data){}
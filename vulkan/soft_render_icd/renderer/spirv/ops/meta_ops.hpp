@@ -13,8 +13,12 @@ void execute_OpExtInstImport(SpirvJit& code, uint32_t instruction_len, const uin
 
 void execute_OpMemoryModel(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
 void execute_OpEntryPoint(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpExecutionMode(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
 
 void execute_OpCapability(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
 
 void execute_OpDecorate(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
-void execute_OpMemberDecorate(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
\ No newline at end of file
+void execute_OpMemberDecorate(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+
+// Debug information, OpLine and friends can show up anywhere
+void execute_OpIgnored(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
\ No newline at end of file
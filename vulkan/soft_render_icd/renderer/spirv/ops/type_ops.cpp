@@ -86,4 +86,76 @@ void execute_OpConstant(SpirvJit& code, [[maybe_unused]] uint32_t instruction_le
         case SpirvJit::Var::TypeVar::Type::Float: code.variables[id].constant.real = *(float*)&data[2]; break;
         default: assert(!"Invalid type in OpConstant");
     }
+}
+
+void execute_OpTypeMatrix(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
+    auto id = data[0];
+    auto column_type = data[1];
+    auto columns = data[2];
+
+    assert(code.variables[column_type].type_var.type == SpirvJit::Var::TypeVar::Type::Vector);
+
+    code.variables[id].type = SpirvJit::Var::Type::Type;
+    code.variables[id].type_var.type = SpirvJit::Var::TypeVar::Type::Matrix;
+    code.variables[id].type_var.composite.n = columns;
+    code.variables[id].type_var.composite.member_type = column_type;
+}
+
+void execute_OpTypeStruct(SpirvJit& code, uint32_t instruction_len, const uint32_t* data){
+    auto id = data[0];
+
+    code.variables[id].type = SpirvJit::Var::Type::Type;
+    code.variables[id].type_var.type = SpirvJit::Var::TypeVar::Type::Struct;
+
+    for(size_t i = 1; i < (instruction_len - 1); i++)
+        code.variables[id].interface.push_back(data[i]);
+}
+
+void execute_OpTypePointer(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
+    auto id = data[0];
+    auto storage = (spv::StorageClass)data[1];
+    auto type = data[2];
+
+    code.variables[id].type = SpirvJit::Var::Type::Type;
+    code.variables[id].type_var.type = SpirvJit::Var::TypeVar::Type::Pointer;
+    code.variables[id].type_var.pointer.storage = storage;
+    code.variables[id].type_var.pointer.type = type;
+}
+
+// Booleans are all ones when true, so they can be used as masks
+void execute_OpConstantTrue(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
+    auto id = data[1];
+    auto type = data[0];
+
+    code.variables[id].type = SpirvJit::Var::Type::Constant;
+    code.variables[id].constant.type = type;
+    code.variables[id].constant.unsigned_int = ~0u;
+}
+
+void execute_OpConstantFalse(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
+    auto id = data[1];
+    auto type = data[0];
+
+    code.variables[id].type = SpirvJit::Var::Type::Constant;
+    code.variables[id].constant.type = type;
+    code.variables[id].constant.unsigned_int = 0;
+}
+
+void execute_OpConstantComposite(SpirvJit& code, uint32_t instruction_len, const uint32_t* data){
+    auto id = data[1];
+    auto type = data[0];
+
+    code.variables[id].type = SpirvJit::Var::Type::Constant;
+    code.variables[id].constant.type = type;
+    code.variables[id].constant.constituents.assign(data + 2, data + (instruction_len - 1));
+}
+
+// A null constant has no constituents, it is all zeroes whatever its type
+void execute_OpConstantNull(SpirvJit& code, [[maybe_unused]] uint32_t instruction_len, const uint32_t* data){
+    auto id = data[1];
+    auto type = data[0];
+
+    code.variables[id].type = SpirvJit::Var::Type::Constant;
+    code.variables[id].constant.type = type;
+    code.variables[id].constant.unsigned_int = 0;
 }
\ No newline at end of file
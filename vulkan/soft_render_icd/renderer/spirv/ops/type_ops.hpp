@@ -10,4 +10,12 @@ void execute_OpTypeVector(SpirvJit& code, uint32_t instruction_len, const uint32
 void execute_OpTypeArray(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
 void execute_OpTypeFunction(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
 
-void execute_OpConstant(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
\ No newline at end of file
+void execute_OpConstant(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpTypeMatrix(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpTypeStruct(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpTypePointer(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+
+void execute_OpConstantTrue(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpConstantFalse(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpConstantComposite(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
+void execute_OpConstantNull(SpirvJit& code, uint32_t instruction_len, const uint32_t* data);
\ No newline at end of file
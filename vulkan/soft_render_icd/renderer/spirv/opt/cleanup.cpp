@@ -0,0 +1,183 @@
+#include "passes.hpp"
+#include "ir.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <tuple>
+#include <unordered_set>
+
+namespace opt {
+    namespace {
+        void remove_nops(Function& function){
+            for(auto& block : function.blocks){
+                auto& instructions = block.instructions;
+                instructions.erase(std::remove_if(instructions.begin(), instructions.end(), [](const Instruction& instruction){ return instruction.op == spv::Op::OpNop; }), instructions.end());
+            }
+        }
+
+        // Drops blocks the first one can't reach, along with their edges into phis and merge instructions naming them
+        bool remove_unreachable_blocks(Function& function){
+            Cfg cfg{function};
+
+            std::unordered_set<spv::Id> removed;
+            for(size_t b = 0; b < function.blocks.size(); b++){
+                if(!cfg.reachable(b))
+                    removed.insert(function.blocks[b].label);
+            }
+
+            if(removed.empty())
+                return false;
+
+            for(auto& block : function.blocks){
+                if(removed.count(block.label))
+                    continue;
+
+                for(auto label : removed)
+                    remove_phi_edges(block, label);
+
+                for(auto& instruction : block.instructions){
+                    if(instruction.op != spv::Op::OpSelectionMerge && instruction.op != spv::Op::OpLoopMerge)
+                        continue;
+
+                    bool dangling = removed.count(instruction.operands[0]) || (instruction.op == spv::Op::OpLoopMerge && removed.count(instruction.operands[1]));
+                    if(dangling)
+                        instruction.op = spv::Op::OpNop;
+                }
+            }
+
+            function.blocks.erase(std::remove_if(function.blocks.begin(), function.blocks.end(), [&](const Block& block){ return removed.count(block.label) > 0; }), function.blocks.end());
+            remove_nops(function);
+            return true;
+        }
+
+        // Only computes a value, so it can go when nothing uses it
+        bool is_removable(spv::Op op){
+            switch (op) {
+                case spv::Op::OpLoad:
+                case spv::Op::OpVariable:
+                case spv::Op::OpPhi:
+                case spv::Op::OpUndef:
+                    return true;
+                default:
+                    return is_pure(op);
+            }
+        }
+    } // namespace
+
+    bool eliminate_common_subexpressions(SpirvJit& code){
+        bool changed = false;
+
+        for(auto& function : code.functions){
+            Cfg cfg{function};
+
+            using Key = std::tuple<spv::Op, spv::Id, std::vector<uint32_t>>;
+            std::map<Key, spv::Id> available;
+            std::unordered_map<spv::Id, spv::Id> replacements;
+
+            auto resolve = [&](uint32_t& id){
+                for(auto it = replacements.find(id); it != replacements.end(); it = replacements.find(id))
+                    id = it->second;
+            };
+
+            // An instruction is available in the blocks its own block dominates. Phis can name values from blocks that come later, replace_uses catches those
+            std::function<void(size_t)> visit = [&](size_t b){
+                std::vector<std::map<Key, spv::Id>::iterator> scope;
+                for(auto& instruction : function.blocks[b].instructions){
+                    for_each_id(instruction, resolve);
+                    if(!instruction.result || !is_pure(instruction.op))
+                        continue;
+
+                    auto [it, inserted] = available.emplace(Key{instruction.op, instruction.type, instruction.operands}, instruction.result);
+                    if(inserted){
+                        scope.push_back(it);
+                    } else {
+                        replacements[instruction.result] = it->second;
+                        instruction.op = spv::Op::OpNop;
+                    }
+                }
+
+                for(auto child : cfg.children[b])
+                    visit(child);
+
+                for(auto it : scope)
+                    available.erase(it);
+            };
+            if(!function.blocks.empty())
+                visit(0);
+
+            if(replacements.empty())
+                continue;
+            changed = true;
+
+            remove_nops(function);
+            replace_uses(function, replacements);
+        }
+
+        return changed;
+    }
+
+    bool eliminate_dead_code(SpirvJit& code){
+        bool changed = false;
+
+        for(auto& function : code.functions){
+            changed |= remove_unreachable_blocks(function);
+
+            std::unordered_set<spv::Id> variables; // Function variables of this function
+            std::unordered_map<spv::Id, const Instruction*> definitions;
+            std::unordered_map<spv::Id, std::vector<const Instruction*>> stores; // Stores straight to one of the variables
+            for(const auto& block : function.blocks){
+                for(const auto& instruction : block.instructions){
+                    if(instruction.op == spv::Op::OpVariable)
+                        variables.insert(instruction.result);
+                    if(instruction.result)
+                        definitions[instruction.result] = &instruction;
+                }
+            }
+
+            std::unordered_set<spv::Id> live;
+            std::vector<const Instruction*> worklist;
+            auto mark = [&](uint32_t id){
+                if(!live.insert(id).second)
+                    return;
+                if(auto it = definitions.find(id); it != definitions.end())
+                    worklist.push_back(it->second);
+                // Stores only matter once something reads the variable
+                if(auto it = stores.find(id); it != stores.end())
+                    worklist.insert(worklist.end(), it->second.begin(), it->second.end());
+            };
+
+            for(const auto& block : function.blocks){
+                for(const auto& instruction : block.instructions){
+                    if(instruction.op == spv::Op::OpStore && variables.count(instruction.operands[0]))
+                        stores[instruction.operands[0]].push_back(&instruction);
+                    else if(!is_removable(instruction.op))
+                        worklist.push_back(&instruction);
+                }
+            }
+
+            while(!worklist.empty()){
+                const auto& instruction = *worklist.back();
+                worklist.pop_back();
+                for_each_id(instruction, mark);
+            }
+
+            for(auto& block : function.blocks){
+                auto& instructions = block.instructions;
+                auto dead = [&](const Instruction& instruction){
+                    if(instruction.op == spv::Op::OpStore)
+                        return variables.count(instruction.operands[0]) > 0 && !live.count(instruction.operands[0]);
+                    return instruction.result && is_removable(instruction.op) && !live.count(instruction.result);
+                };
+
+                auto end = std::remove_if(instructions.begin(), instructions.end(), dead);
+                if(end != instructions.end()){
+                    instructions.erase(end, instructions.end());
+                    changed = true;
+                }
+            }
+        }
+
+        return changed;
+    }
+} // namespace opt
\ No newline at end of file
@@ -0,0 +1,436 @@
+#include "passes.hpp"
+#include "ir.hpp"
+#include "../codegen/interpreter_handlers.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace opt {
+    namespace {
+        using namespace interpreter_handlers;
+
+        // Evaluates like the interpreter does, so folding never changes what a shader computes
+        class Folder {
+            public:
+            explicit Folder(SpirvJit& code): _code{code} {}
+
+            // Folds or simplifies `instruction`, whose operands already went through `replacements`.
+            // Returns true if it can go, then its result is in `replacements`
+            bool fold(Function& function, Instruction& instruction, std::unordered_map<spv::Id, spv::Id>& replacements);
+
+            void set_definitions(const Function& function){
+                _definitions.clear();
+                for(const auto& block : function.blocks){
+                    for(const auto& instruction : block.instructions){
+                        if(instruction.result)
+                            _definitions[instruction.result] = &instruction;
+                    }
+                }
+            }
+
+            private:
+            // Flattened words of a constant, like FrameLayout stores them. False for anything else
+            bool value(spv::Id id, std::vector<uint32_t>& words);
+
+            spv::Id make_constant(spv::Id type, const uint32_t* words);
+
+            bool evaluate(const Instruction& instruction, std::vector<uint32_t>& result);
+            spv::Id simplify(Function& function, Instruction& instruction);
+
+            const Instruction* definition(spv::Id id) const {
+                auto it = _definitions.find(id);
+                return (it != _definitions.end()) ? it->second : nullptr;
+            }
+
+            spv::Id type_of(spv::Id id) const {
+                if(is_constant(_code, id))
+                    return _code.variables[id].constant.type;
+                auto* instruction = definition(id);
+                return instruction ? instruction->type : 0;
+            }
+
+            SpirvJit& _code;
+            std::unordered_map<spv::Id, std::vector<uint32_t>> _values;
+            std::map<std::pair<spv::Id, std::vector<uint32_t>>, spv::Id> _constants;
+            std::unordered_map<spv::Id, const Instruction*> _definitions;
+        };
+
+        bool Folder::value(spv::Id id, std::vector<uint32_t>& words){
+            if(!is_constant(_code, id))
+                return false;
+
+            if(auto it = _values.find(id); it != _values.end()){
+                words = it->second;
+                return true;
+            }
+
+            std::vector<uint32_t> flat;
+            auto type = _code.variables[id].constant.type;
+            auto constituents = _code.variables[id].constant.constituents;
+            if(!constituents.empty()){
+                for(auto constituent : constituents){
+                    std::vector<uint32_t> part;
+                    if(!value(constituent, part))
+                        return false;
+                    flat.insert(flat.end(), part.begin(), part.end());
+                }
+            } else if(type_words(_code, type) == 1){
+                flat.push_back(_code.variables[id].constant.unsigned_int);
+            } else {
+                flat.resize(type_words(_code, type), 0);
+            }
+
+            words = flat;
+            _values.emplace(id, std::move(flat));
+            return true;
+        }
+
+        spv::Id Folder::make_constant(spv::Id type, const uint32_t* words){
+            auto n = type_words(_code, type);
+            auto key = std::make_pair(type, std::vector<uint32_t>(words, words + n));
+            if(auto it = _constants.find(key); it != _constants.end())
+                return it->second;
+
+            std::vector<spv::Id> constituents;
+            for(uint32_t m = 0; m < member_count(_code, type); m++)
+                constituents.push_back(make_constant(member_type(_code, type, m), words + member_offset(_code, type, m)));
+
+            auto id = new_id(_code);
+            auto& var = _code.variables[id];
+            var.type = SpirvJit::Var::Type::Constant;
+            var.constant.type = type;
+            var.constant.unsigned_int = constituents.empty() ? words[0] : 0;
+            var.constant.constituents = std::move(constituents);
+
+            _values.emplace(id, key.second);
+            _constants.emplace(std::move(key), id);
+            return id;
+        }
+
+        bool Folder::evaluate(const Instruction& instruction, std::vector<uint32_t>& result){
+            const auto& ops = instruction.operands;
+            std::vector<uint32_t> a, b, c;
+
+            switch (instruction.op) {
+                case spv::Op::OpCompositeConstruct:
+                    for(auto constituent : ops){
+                        if(!value(constituent, a))
+                            return false;
+                        result.insert(result.end(), a.begin(), a.end());
+                    }
+                    return true;
+                case spv::Op::OpCompositeExtract: {
+                    if(!value(ops[0], a))
+                        return false;
+
+                    uint32_t offset = 0;
+                    auto type = _code.variables[ops[0]].constant.type;
+                    for(size_t i = 1; i < ops.size(); i++){
+                        offset += member_offset(_code, type, ops[i]);
+                        type = member_type(_code, type, ops[i]);
+                    }
+                    result.assign(a.begin() + offset, a.begin() + offset + type_words(_code, instruction.type));
+                    return true;
+                }
+                case spv::Op::OpCompositeInsert: {
+                    if(!value(ops[0], a) || !value(ops[1], result))
+                        return false;
+
+                    uint32_t offset = 0;
+                    auto type = instruction.type;
+                    for(size_t i = 2; i < ops.size(); i++){
+                        offset += member_offset(_code, type, ops[i]);
+                        type = member_type(_code, type, ops[i]);
+                    }
+                    std::copy(a.begin(), a.end(), result.begin() + offset);
+                    return true;
+                }
+                case spv::Op::OpVectorShuffle: {
+                    if(!value(ops[0], a) || !value(ops[1], b))
+                        return false;
+
+                    for(size_t i = 2; i < ops.size(); i++){
+                        auto component = ops[i];
+                        result.push_back((component == ~0u) ? 0 : (component < a.size()) ? a[component] : b[component - a.size()]);
+                    }
+                    return true;
+                }
+                case spv::Op::OpSelect: {
+                    if(!value(ops[0], c) || !value(ops[1], a) || !value(ops[2], b))
+                        return false;
+
+                    for(size_t i = 0; i < a.size(); i++){
+                        auto condition = c[(c.size() == 1) ? 0 : i];
+                        result.push_back((condition & a[i]) | (~condition & b[i]));
+                    }
+                    return true;
+                }
+                case spv::Op::OpDot: {
+                    if(!value(ops[0], a) || !value(ops[1], b))
+                        return false;
+
+                    float sum = fl(a[0]) * fl(b[0]);
+                    for(size_t i = 1; i < a.size(); i++)
+                        sum += fl(a[i]) * fl(b[i]);
+                    result.push_back(bits(sum));
+                    return true;
+                }
+                case spv::Op::OpVectorTimesScalar: {
+                    if(!value(ops[0], a) || !value(ops[1], b))
+                        return false;
+
+                    for(auto x : a)
+                        result.push_back(bits(fl(x) * fl(b[0])));
+                    return true;
+                }
+                default:
+                    break;
+            }
+
+            // Component wise operations
+            if(ops.empty() || ops.size() > 2 || !is_pure(instruction.op) || instruction.op == spv::Op::OpExtInst)
+                return false;
+            if(!value(ops[0], a) || (ops.size() == 2 && !value(ops[1], b)))
+                return false;
+
+            auto unary = [&](auto f){
+                for(auto x : a)
+                    result.push_back(f(x));
+                return true;
+            };
+            auto binary = [&](auto f){
+                if(a.size() != b.size())
+                    return false;
+                for(size_t i = 0; i < a.size(); i++)
+                    result.push_back(f(a[i], b[i]));
+                return true;
+            };
+            auto mask = [](bool condition){
+                return condition ? ~0u : 0u;
+            };
+
+            switch (instruction.op) {
+                case spv::Op::OpCopyObject:
+                case spv::Op::OpBitcast: return unary([](uint32_t x){ return x; });
+                case spv::Op::OpFNegate: return unary([](uint32_t x){ return x ^ 0x80000000u; });
+                case spv::Op::OpSNegate: return unary([](uint32_t x){ return 0u - x; });
+                case spv::Op::OpNot:
+                case spv::Op::OpLogicalNot: return unary([](uint32_t x){ return ~x; });
+                case spv::Op::OpConvertFToS: return unary([](uint32_t x){ return float_to_signed(fl(x)); });
+                case spv::Op::OpConvertFToU: return unary([](uint32_t x){ return float_to_unsigned(fl(x)); });
+                case spv::Op::OpConvertSToF: return unary([](uint32_t x){ return bits((float)(int32_t)x); });
+                case spv::Op::OpConvertUToF: return unary([](uint32_t x){ return bits((float)x); });
+
+                case spv::Op::OpFAdd: return binary([](uint32_t x, uint32_t y){ return bits(fl(x) + fl(y)); });
+                case spv::Op::OpFSub: return binary([](uint32_t x, uint32_t y){ return bits(fl(x) - fl(y)); });
+                case spv::Op::OpFMul: return binary([](uint32_t x, uint32_t y){ return bits(fl(x) * fl(y)); });
+                case spv::Op::OpFDiv: return binary([](uint32_t x, uint32_t y){ return bits(fl(x) / fl(y)); });
+                case spv::Op::OpFMod: return binary([](uint32_t x, uint32_t y){ return bits(float_mod(fl(x), fl(y))); });
+                case spv::Op::OpFRem: return binary([](uint32_t x, uint32_t y){ return bits(float_rem(fl(x), fl(y))); });
+                case spv::Op::OpIAdd: return binary([](uint32_t x, uint32_t y){ return x + y; });
+                case spv::Op::OpISub: return binary([](uint32_t x, uint32_t y){ return x - y; });
+                case spv::Op::OpIMul: return binary([](uint32_t x, uint32_t y){ return x * y; });
+                case spv::Op::OpSDiv: return binary([](uint32_t x, uint32_t y){ return (y == 0) ? 0u : (y == ~0u) ? 0u - x : (uint32_t)((int32_t)x / (int32_t)y); });
+                case spv::Op::OpSRem: return binary([](uint32_t x, uint32_t y){ return (y == 0 || y == ~0u) ? 0u : (uint32_t)((int32_t)x % (int32_t)y); });
+                case spv::Op::OpSMod: return binary(signed_mod);
+                case spv::Op::OpUDiv: return binary([](uint32_t x, uint32_t y){ return (y == 0) ? 0u : x / y; });
+                case spv::Op::OpUMod: return binary([](uint32_t x, uint32_t y){ return (y == 0) ? 0u : x % y; });
+
+                case spv::Op::OpBitwiseAnd:
+                case spv::Op::OpLogicalAnd: return binary([](uint32_t x, uint32_t y){ return x & y; });
+                case spv::Op::OpBitwiseOr:
+                case spv::Op::OpLogicalOr: return binary([](uint32_t x, uint32_t y){ return x | y; });
+                case spv::Op::OpBitwiseXor:
+                case spv::Op::OpLogicalNotEqual: return binary([](uint32_t x, uint32_t y){ return x ^ y; });
+                case spv::Op::OpLogicalEqual: return binary([](uint32_t x, uint32_t y){ return ~(x ^ y); });
+                case spv::Op::OpShiftLeftLogical: return binary([](uint32_t x, uint32_t y){ return x << (y & 31); });
+                case spv::Op::OpShiftRightLogical: return binary([](uint32_t x, uint32_t y){ return x >> (y & 31); });
+                case spv::Op::OpShiftRightArithmetic: return binary([](uint32_t x, uint32_t y){ return (uint32_t)((int32_t)x >> (y & 31)); });
+
+                case spv::Op::OpIEqual: return binary([&](uint32_t x, uint32_t y){ return mask(x == y); });
+                case spv::Op::OpINotEqual: return binary([&](uint32_t x, uint32_t y){ return mask(x != y); });
+                case spv::Op::OpSLessThan: return binary([&](uint32_t x, uint32_t y){ return mask((int32_t)x < (int32_t)y); });
+                case spv::Op::OpSLessThanEqual: return binary([&](uint32_t x, uint32_t y){ return mask((int32_t)x <= (int32_t)y); });
+                case spv::Op::OpSGreaterThan: return binary([&](uint32_t x, uint32_t y){ return mask((int32_t)x > (int32_t)y); });
+                case spv::Op::OpSGreaterThanEqual: return binary([&](uint32_t x, uint32_t y){ return mask((int32_t)x >= (int32_t)y); });
+                case spv::Op::OpULessThan: return binary([&](uint32_t x, uint32_t y){ return mask(x < y); });
+                case spv::Op::OpULessThanEqual: return binary([&](uint32_t x, uint32_t y){ return mask(x <= y); });
+                case spv::Op::OpUGreaterThan: return binary([&](uint32_t x, uint32_t y){ return mask(x > y); });
+                case spv::Op::OpUGreaterThanEqual: return binary([&](uint32_t x, uint32_t y){ return mask(x >= y); });
+                case spv::Op::OpFOrdEqual: return binary([&](uint32_t x, uint32_t y){ return mask(fl(x) == fl(y)); });
+                case spv::Op::OpFOrdNotEqual: return binary([&](uint32_t x, uint32_t y){ return mask(fl(x) < fl(y) || fl(x) > fl(y)); });
+                case spv::Op::OpFOrdLessThan: return binary([&](uint32_t x, uint32_t y){ return mask(fl(x) < fl(y)); });
+                case spv::Op::OpFOrdGreaterThan: return binary([&](uint32_t x, uint32_t y){ return mask(fl(x) > fl(y)); });
+                case spv::Op::OpFOrdLessThanEqual: return binary([&](uint32_t x, uint32_t y){ return mask(fl(x) <= fl(y)); });
+                case spv::Op::OpFOrdGreaterThanEqual: return binary([&](uint32_t x, uint32_t y){ return mask(fl(x) >= fl(y)); });
+                case spv::Op::OpFUnordEqual: return binary([&](uint32_t x, uint32_t y){ return mask(!(fl(x) < fl(y) || fl(x) > fl(y))); });
+                case spv::Op::OpFUnordNotEqual: return binary([&](uint32_t x, uint32_t y){ return mask(!(fl(x) == fl(y))); });
+                case spv::Op::OpFUnordLessThan: return binary([&](uint32_t x, uint32_t y){ return mask(!(fl(x) >= fl(y))); });
+                case spv::Op::OpFUnordGreaterThan: return binary([&](uint32_t x, uint32_t y){ return mask(!(fl(x) <= fl(y))); });
+                case spv::Op::OpFUnordLessThanEqual: return binary([&](uint32_t x, uint32_t y){ return mask(!(fl(x) > fl(y))); });
+                case spv::Op::OpFUnordGreaterThanEqual: return binary([&](uint32_t x, uint32_t y){ return mask(!(fl(x) < fl(y))); });
+                default:
+                    return false;
+            }
+        }
+
+        // Returns what `instruction`'s result can be replaced with, or 0. May rewrite the instruction in place instead
+        spv::Id Folder::simplify(Function& function, Instruction& instruction){
+            auto& ops = instruction.operands;
+            switch (instruction.op) {
+                case spv::Op::OpCopyObject:
+                    return ops[0];
+                case spv::Op::OpPhi: {
+                    spv::Id same = 0;
+                    for(size_t i = 0; i < ops.size(); i += 2){
+                        if(ops[i] == instruction.result || ops[i] == same)
+                            continue;
+                        if(same)
+                            return 0;
+                        same = ops[i];
+                    }
+                    return same;
+                }
+                case spv::Op::OpCompositeExtract: {
+                    auto* composite = definition(ops[0]);
+                    if(!composite)
+                        return 0;
+
+                    // Constructs with one constituent per member, which leaves out vectors built from smaller vectors
+                    if(composite->op == spv::Op::OpCompositeConstruct && composite->operands.size() == member_count(_code, composite->type)){
+                        auto constituent = composite->operands[ops[1]];
+                        if(ops.size() == 2)
+                            return constituent;
+                        ops.erase(ops.begin());
+                        ops[0] = constituent;
+                        return 0;
+                    }
+
+                    if(composite->op == spv::Op::OpCompositeInsert){
+                        std::vector<uint32_t> inserted{composite->operands.begin() + 2, composite->operands.end()};
+                        std::vector<uint32_t> extracted{ops.begin() + 1, ops.end()};
+                        if(inserted == extracted)
+                            return composite->operands[0];
+                        if(inserted[0] != extracted[0]) // The insert didn't touch this member
+                            ops[0] = composite->operands[1];
+                    }
+                    return 0;
+                }
+                case spv::Op::OpCompositeConstruct: {
+                    // Taking a composite apart and putting it back together
+                    spv::Id source = 0;
+                    for(uint32_t i = 0; i < ops.size(); i++){
+                        auto* part = definition(ops[i]);
+                        if(!part || part->op != spv::Op::OpCompositeExtract || part->operands.size() != 2 || part->operands[1] != i)
+                            return 0;
+                        if(i > 0 && part->operands[0] != source)
+                            return 0;
+                        source = part->operands[0];
+                    }
+                    return (type_of(source) == instruction.type && member_count(_code, instruction.type) == ops.size()) ? source : 0;
+                }
+                case spv::Op::OpBranchConditional:
+                case spv::Op::OpSwitch: {
+                    std::vector<uint32_t> selector;
+                    if(!value(ops[0], selector))
+                        return 0;
+
+                    spv::Id taken = 0;
+                    if(instruction.op == spv::Op::OpBranchConditional){
+                        taken = selector[0] ? ops[1] : ops[2];
+                    } else {
+                        taken = ops[1];
+                        for(size_t i = 2; i + 1 < ops.size(); i += 2){
+                            if(ops[i] == selector[0]){
+                                taken = ops[i + 1];
+                                break;
+                            }
+                        }
+                    }
+
+                    // The block branching here is the one holding `instruction`
+                    for(auto& block : function.blocks){
+                        if(block.instructions.empty() || &block.instructions.back() != &instruction)
+                            continue;
+
+                        for(auto label : successors(block)){
+                            if(label == taken)
+                                continue;
+                            for(auto& target : function.blocks){
+                                if(target.label == label)
+                                    remove_phi_edges(target, block.label);
+                            }
+                        }
+
+                        // A selection merge has to be followed by a conditional branch or a switch
+                        if(block.instructions.size() > 1 && block.instructions[block.instructions.size() - 2].op == spv::Op::OpSelectionMerge)
+                            block.instructions[block.instructions.size() - 2].op = spv::Op::OpNop;
+                    }
+
+                    instruction.op = spv::Op::OpBranch;
+                    ops = {taken};
+                    return 0;
+                }
+                default:
+                    return 0;
+            }
+        }
+
+        bool Folder::fold(Function& function, Instruction& instruction, std::unordered_map<spv::Id, spv::Id>& replacements){
+            std::vector<uint32_t> result;
+            if(instruction.result && instruction.type && evaluate(instruction, result) && result.size() == type_words(_code, instruction.type)){
+                replacements[instruction.result] = make_constant(instruction.type, result.data());
+                return true;
+            }
+
+            if(auto replacement = simplify(function, instruction); replacement && replacement != instruction.result){
+                replacements[instruction.result] = replacement;
+                return true;
+            }
+            return false;
+        }
+    } // namespace
+
+    bool fold_constants(SpirvJit& code){
+        bool changed = false;
+        Folder folder{code};
+
+        for(auto& function : code.functions){
+            folder.set_definitions(function);
+
+            std::unordered_map<spv::Id, spv::Id> replacements;
+            auto resolve = [&](uint32_t& id){
+                for(auto it = replacements.find(id); it != replacements.end(); it = replacements.find(id))
+                    id = it->second;
+            };
+
+            // Folded instructions become OpNop first, so the definitions stay where they are until the function is done
+            bool folded = false;
+            for(auto& block : function.blocks){
+                for(auto& instruction : block.instructions){
+                    for_each_id(instruction, resolve);
+
+                    auto op = instruction.op;
+                    if(folder.fold(function, instruction, replacements)){
+                        instruction.op = spv::Op::OpNop;
+                        folded = true;
+                    } else if(instruction.op != op){
+                        folded = true; // Branch on a constant
+                    }
+                }
+            }
+
+            if(!folded)
+                continue;
+            changed = true;
+
+            for(auto& block : function.blocks){
+                auto& instructions = block.instructions;
+                instructions.erase(std::remove_if(instructions.begin(), instructions.end(), [](const Instruction& instruction){ return instruction.op == spv::Op::OpNop; }), instructions.end());
+            }
+            replace_uses(function, replacements);
+        }
+
+        return changed;
+    }
+} // namespace opt
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "passes.hpp"
+#include "ir.hpp"
+
+namespace opt {
+    namespace {
+        // Replaces the call at `blocks[b].instructions[i]` of `caller` with a copy of the callee's blocks.
+        // The block is split at the call, the part after it continues in a new block that the copied returns branch to
+        void inline_call(SpirvJit& code, size_t caller, size_t b, size_t i){
+            auto call = code.functions[caller].blocks[b].instructions[i];
+            const auto callee = code.functions[code.variables[call.operands[0]].function.index];
+
+            std::unordered_map<spv::Id, spv::Id> ids; // Callee ids to their copies
+            for(size_t p = 0; p < callee.parameters.size(); p++)
+                ids[callee.parameters[p]] = call.operands[1 + p];
+            for(const auto& block : callee.blocks){
+                ids[block.label] = new_id(code);
+                for(const auto& instruction : block.instructions){
+                    if(instruction.result)
+                        ids[instruction.result] = new_id(code);
+                }
+            }
+            auto continuation_label = new_id(code);
+
+            auto map = [&](uint32_t& id){
+                if(auto it = ids.find(id); it != ids.end())
+                    id = it->second;
+            };
+
+            std::vector<Instruction> variables;
+            std::vector<Block> copies;
+            std::vector<uint32_t> returns; // Pairs of value and block for the result phi
+            for(const auto& block : callee.blocks){
+                Block copy{ids.at(block.label), {}};
+                for(auto instruction : block.instructions){
+                    if(instruction.result)
+                        instruction.result = ids.at(instruction.result);
+                    for_each_id(instruction, map);
+
+                    switch (instruction.op) {
+                        case spv::Op::OpVariable:
+                            // Variables have to be in the first block, initializers run where the callee started
+                            if(instruction.operands.size() > 1){
+                                copy.instructions.push_back(Instruction{spv::Op::OpStore, 0, 0, {instruction.result, instruction.operands[1]}});
+                                instruction.operands.resize(1);
+                            }
+                            variables.push_back(std::move(instruction));
+                            break;
+                        case spv::Op::OpReturnValue:
+                            returns.insert(returns.end(), {instruction.operands[0], copy.label});
+                            copy.instructions.push_back(Instruction{spv::Op::OpBranch, 0, 0, {continuation_label}});
+                            break;
+                        case spv::Op::OpReturn:
+                            copy.instructions.push_back(Instruction{spv::Op::OpBranch, 0, 0, {continuation_label}});
+                            break;
+                        default:
+                            copy.instructions.push_back(std::move(instruction));
+                            break;
+                    }
+                }
+                copies.push_back(std::move(copy));
+            }
+
+            auto& function = code.functions[caller];
+            auto& block = function.blocks[b];
+
+            Block continuation{continuation_label, {block.instructions.begin() + i + 1, block.instructions.end()}};
+            block.instructions.resize(i);
+            block.instructions.push_back(Instruction{spv::Op::OpBranch, 0, 0, {copies.front().label}});
+
+            // The terminator moved, successors now come from the continuation
+            for(auto label : successors(continuation)){
+                for(auto& target : function.blocks){
+                    if(target.label != label)
+                        continue;
+
+                    for(auto& instruction : target.instructions){
+                        if(instruction.op != spv::Op::OpPhi)
+                            break;
+                        for(size_t k = 1; k < instruction.operands.size(); k += 2){
+                            if(instruction.operands[k] == block.label)
+                                instruction.operands[k] = continuation_label;
+                        }
+                    }
+                }
+            }
+
+            std::unordered_map<spv::Id, spv::Id> result;
+            if(call.result && type_words(code, call.type) > 0){
+                if(returns.size() == 2)
+                    result[call.result] = returns[0];
+                else if(returns.empty()) // Never returns, nothing after the call runs
+                    continuation.instructions.insert(continuation.instructions.begin(), Instruction{spv::Op::OpUndef, call.type, call.result, {}});
+                else
+                    continuation.instructions.insert(continuation.instructions.begin(), Instruction{spv::Op::OpPhi, call.type, call.result, std::move(returns)});
+            }
+
+            copies.push_back(std::move(continuation));
+            function.blocks.insert(function.blocks.begin() + b + 1, std::make_move_iterator(copies.begin()), std::make_move_iterator(copies.end()));
+
+            auto& first = function.blocks.front().instructions;
+            first.insert(first.begin(), std::make_move_iterator(variables.begin()), std::make_move_iterator(variables.end()));
+
+            replace_uses(function, result);
+        }
+    } // namespace
+
+    bool inline_calls(SpirvJit& code){
+        bool changed = false;
+
+        // Copies of callees can contain calls themselves, they are reached when the scan gets to the copied blocks. SPIR-V has no recursion, so this ends
+        for(size_t f = 0; f < code.functions.size(); f++){
+            for(size_t b = 0; b < code.functions[f].blocks.size(); b++){
+                const auto& instructions = code.functions[f].blocks[b].instructions;
+                for(size_t i = 0; i < instructions.size(); i++){
+                    if(instructions[i].op == spv::Op::OpFunctionCall){
+                        inline_call(code, f, b, i);
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        return changed;
+    }
+} // namespace opt
\ No newline at end of file
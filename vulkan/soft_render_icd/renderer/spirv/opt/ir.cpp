@@ -0,0 +1,291 @@
+#include "ir.hpp"
+
+#include <algorithm>
+
+namespace opt {
+    bool is_id_operand(spv::Op op, size_t index){
+        switch (op) {
+            case spv::Op::OpCompositeExtract:
+            case spv::Op::OpLoad:
+            case spv::Op::OpSelectionMerge:
+            case spv::Op::OpLine:
+                return index == 0;
+            case spv::Op::OpCompositeInsert:
+            case spv::Op::OpVectorShuffle:
+            case spv::Op::OpStore:
+            case spv::Op::OpCopyMemory:
+            case spv::Op::OpLoopMerge:
+                return index < 2;
+            case spv::Op::OpBranchConditional:
+                return index < 3; // Branch weights follow
+            case spv::Op::OpSwitch:
+                return index == 0 || index % 2 == 1; // Selector, default, then pairs of literal and label
+            case spv::Op::OpExtInst:
+                return index != 1;
+            case spv::Op::OpVariable:
+                return index == 1;
+            case spv::Op::OpImageSampleImplicitLod:
+            case spv::Op::OpImageSampleExplicitLod:
+            case spv::Op::OpImageSampleProjImplicitLod:
+            case spv::Op::OpImageSampleProjExplicitLod:
+            case spv::Op::OpImageFetch:
+            case spv::Op::OpImageRead:
+                return index != 2; // Image operands mask
+            case spv::Op::OpImageSampleDrefImplicitLod:
+            case spv::Op::OpImageSampleDrefExplicitLod:
+            case spv::Op::OpImageSampleProjDrefImplicitLod:
+            case spv::Op::OpImageSampleProjDrefExplicitLod:
+            case spv::Op::OpImageGather:
+            case spv::Op::OpImageDrefGather:
+            case spv::Op::OpImageWrite:
+                return index != 3;
+            default:
+                return true;
+        }
+    }
+
+    bool is_pure(spv::Op op){
+        switch (op) {
+            case spv::Op::OpAccessChain:
+            case spv::Op::OpInBoundsAccessChain:
+            case spv::Op::OpCopyObject:
+            case spv::Op::OpBitcast:
+            case spv::Op::OpCompositeConstruct:
+            case spv::Op::OpCompositeExtract:
+            case spv::Op::OpCompositeInsert:
+            case spv::Op::OpVectorShuffle:
+            case spv::Op::OpVectorExtractDynamic:
+            case spv::Op::OpVectorInsertDynamic:
+            case spv::Op::OpFNegate:
+            case spv::Op::OpSNegate:
+            case spv::Op::OpFAdd:
+            case spv::Op::OpFSub:
+            case spv::Op::OpFMul:
+            case spv::Op::OpFDiv:
+            case spv::Op::OpFMod:
+            case spv::Op::OpFRem:
+            case spv::Op::OpIAdd:
+            case spv::Op::OpISub:
+            case spv::Op::OpIMul:
+            case spv::Op::OpSDiv:
+            case spv::Op::OpSRem:
+            case spv::Op::OpSMod:
+            case spv::Op::OpUDiv:
+            case spv::Op::OpUMod:
+            case spv::Op::OpVectorTimesScalar:
+            case spv::Op::OpMatrixTimesScalar:
+            case spv::Op::OpMatrixTimesVector:
+            case spv::Op::OpVectorTimesMatrix:
+            case spv::Op::OpMatrixTimesMatrix:
+            case spv::Op::OpDot:
+            case spv::Op::OpNot:
+            case spv::Op::OpBitwiseAnd:
+            case spv::Op::OpBitwiseOr:
+            case spv::Op::OpBitwiseXor:
+            case spv::Op::OpShiftLeftLogical:
+            case spv::Op::OpShiftRightLogical:
+            case spv::Op::OpShiftRightArithmetic:
+            case spv::Op::OpIEqual:
+            case spv::Op::OpINotEqual:
+            case spv::Op::OpSLessThan:
+            case spv::Op::OpSLessThanEqual:
+            case spv::Op::OpSGreaterThan:
+            case spv::Op::OpSGreaterThanEqual:
+            case spv::Op::OpULessThan:
+            case spv::Op::OpULessThanEqual:
+            case spv::Op::OpUGreaterThan:
+            case spv::Op::OpUGreaterThanEqual:
+            case spv::Op::OpFOrdEqual:
+            case spv::Op::OpFOrdNotEqual:
+            case spv::Op::OpFOrdLessThan:
+            case spv::Op::OpFOrdGreaterThan:
+            case spv::Op::OpFOrdLessThanEqual:
+            case spv::Op::OpFOrdGreaterThanEqual:
+            case spv::Op::OpFUnordEqual:
+            case spv::Op::OpFUnordNotEqual:
+            case spv::Op::OpFUnordLessThan:
+            case spv::Op::OpFUnordGreaterThan:
+            case spv::Op::OpFUnordLessThanEqual:
+            case spv::Op::OpFUnordGreaterThanEqual:
+            case spv::Op::OpLogicalAnd:
+            case spv::Op::OpLogicalOr:
+            case spv::Op::OpLogicalNot:
+            case spv::Op::OpLogicalEqual:
+            case spv::Op::OpLogicalNotEqual:
+            case spv::Op::OpSelect:
+            case spv::Op::OpAny:
+            case spv::Op::OpAll:
+            case spv::Op::OpConvertFToS:
+            case spv::Op::OpConvertFToU:
+            case spv::Op::OpConvertSToF:
+            case spv::Op::OpConvertUToF:
+            case spv::Op::OpExtInst: // Only GLSL.std.450 is supported, which has no side effects
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_terminator(spv::Op op){
+        switch (op) {
+            case spv::Op::OpBranch:
+            case spv::Op::OpBranchConditional:
+            case spv::Op::OpSwitch:
+            case spv::Op::OpReturn:
+            case spv::Op::OpReturnValue:
+            case spv::Op::OpKill:
+            case spv::Op::OpUnreachable:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    std::vector<spv::Id> successors(const Block& block){
+        if(block.instructions.empty())
+            return {};
+
+        const auto& terminator = block.instructions.back();
+        const auto& ops = terminator.operands;
+        switch (terminator.op) {
+            case spv::Op::OpBranch:
+                return {ops[0]};
+            case spv::Op::OpBranchConditional:
+                return {ops[1], ops[2]};
+            case spv::Op::OpSwitch: {
+                std::vector<spv::Id> labels{ops[1]};
+                for(size_t i = 3; i < ops.size(); i += 2)
+                    labels.push_back(ops[i]);
+                return labels;
+            }
+            default:
+                return {};
+        }
+    }
+
+    void replace_uses(Function& function, const std::unordered_map<spv::Id, spv::Id>& replacements){
+        if(replacements.empty())
+            return;
+
+        auto resolve = [&](uint32_t& id){
+            for(auto it = replacements.find(id); it != replacements.end(); it = replacements.find(id))
+                id = it->second;
+        };
+
+        for(auto& block : function.blocks){
+            for(auto& instruction : block.instructions)
+                for_each_id(instruction, resolve);
+        }
+    }
+
+    void remove_phi_edges(Block& target, spv::Id predecessor){
+        for(auto& instruction : target.instructions){
+            if(instruction.op != spv::Op::OpPhi)
+                break;
+
+            auto& ops = instruction.operands;
+            for(size_t i = 0; i + 1 < ops.size();){
+                if(ops[i + 1] == predecessor)
+                    ops.erase(ops.begin() + i, ops.begin() + i + 2);
+                else
+                    i += 2;
+            }
+        }
+    }
+
+    Cfg::Cfg(const Function& function){
+        auto n = function.blocks.size();
+        for(size_t b = 0; b < n; b++)
+            index[function.blocks[b].label] = b;
+
+        successors.resize(n);
+        predecessors.resize(n);
+        for(size_t b = 0; b < n; b++){
+            for(auto label : opt::successors(function.blocks[b])){
+                auto s = index.at(label);
+                if(std::find(successors[b].begin(), successors[b].end(), s) != successors[b].end())
+                    continue; // Switch cases sharing a target
+                successors[b].push_back(s);
+                predecessors[s].push_back(b);
+            }
+        }
+
+        // Postorder without recursion, a block is done once all of its successors are
+        std::vector<size_t> postorder;
+        std::vector<bool> visited(n, false);
+        std::vector<std::pair<size_t, size_t>> stack;
+        if(n > 0){
+            stack.emplace_back(0, 0);
+            visited[0] = true;
+        }
+        while(!stack.empty()){
+            auto& [block, next] = stack.back();
+            if(next < successors[block].size()){
+                auto s = successors[block][next++];
+                if(!visited[s]){
+                    visited[s] = true;
+                    stack.emplace_back(s, 0);
+                }
+            } else {
+                postorder.push_back(block);
+                stack.pop_back();
+            }
+        }
+        order.assign(postorder.rbegin(), postorder.rend());
+
+        std::vector<size_t> position(n, none);
+        for(size_t i = 0; i < order.size(); i++)
+            position[order[i]] = i;
+
+        idom.assign(n, none);
+        if(n > 0)
+            idom[0] = 0;
+
+        auto intersect = [&](size_t a, size_t b){
+            while(a != b){
+                while(position[a] > position[b])
+                    a = idom[a];
+                while(position[b] > position[a])
+                    b = idom[b];
+            }
+            return a;
+        };
+
+        for(bool changed = true; changed;){
+            changed = false;
+            for(size_t i = 1; i < order.size(); i++){
+                auto block = order[i];
+                auto dominator = none;
+                for(auto p : predecessors[block]){
+                    if(idom[p] == none)
+                        continue;
+                    dominator = (dominator == none) ? p : intersect(p, dominator);
+                }
+
+                if(idom[block] != dominator){
+                    idom[block] = dominator;
+                    changed = true;
+                }
+            }
+        }
+
+        children.resize(n);
+        frontier.resize(n);
+        for(size_t i = 1; i < order.size(); i++)
+            children[idom[order[i]]].push_back(order[i]);
+
+        for(auto block : order){
+            if(predecessors[block].size() < 2)
+                continue;
+
+            for(auto p : predecessors[block]){
+                for(auto runner = p; reachable(runner) && runner != idom[block]; runner = idom[runner]){
+                    if(std::find(frontier[runner].begin(), frontier[runner].end(), block) == frontier[runner].end())
+                        frontier[runner].push_back(block);
+                    if(runner == 0)
+                        break;
+                }
+            }
+        }
+    }
+} // namespace opt
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../jit.hpp"
+#include "../type_info.hpp"
+
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// Helpers shared by the passes. Passes rewrite SpirvJit::Function bodies in place, so there is nothing to convert back before code generation
+namespace opt {
+    using Instruction = SpirvJit::Instruction;
+    using Block = SpirvJit::Block;
+    using Function = SpirvJit::Function;
+
+    constexpr size_t none = ~size_t{0};
+
+    // A fresh id past the module's bound
+    inline spv::Id new_id(SpirvJit& code){
+        code.variables.emplace_back();
+        return (spv::Id)(code.variables.size() - 1);
+    }
+
+    inline bool is_constant(const SpirvJit& code, spv::Id id){
+        return id < code.variables.size() && code.variables[id].type == SpirvJit::Var::Type::Constant;
+    }
+
+    // Whether operand `index` of `op` is an id rather than a literal
+    bool is_id_operand(spv::Op op, size_t index);
+
+    template<typename I, typename F>
+    void for_each_id(I& instruction, F&& f){
+        for(size_t i = 0; i < instruction.operands.size(); i++){
+            if(is_id_operand(instruction.op, i))
+                f(instruction.operands[i]);
+        }
+    }
+
+    // No side effects and the result only depends on the operands, so unused ones can go and equal ones can be merged
+    bool is_pure(spv::Op op);
+
+    bool is_terminator(spv::Op op);
+
+    // Labels the block's terminator can branch to
+    std::vector<spv::Id> successors(const Block& block);
+
+    // Rewrites every use of a key to its value, following chains of replacements
+    void replace_uses(Function& function, const std::unordered_map<spv::Id, spv::Id>& replacements);
+
+    // Drops the incoming values of `target`'s phis that come from `predecessor`
+    void remove_phi_edges(Block& target, spv::Id predecessor);
+
+    // Blocks by index into Function::blocks. Dominators after Cooper, Harvey and Kennedy, only covering blocks reachable from the first one
+    struct Cfg {
+        explicit Cfg(const Function& function);
+
+        bool reachable(size_t block) const {
+            return idom[block] != none;
+        }
+
+        std::unordered_map<spv::Id, size_t> index; // By label
+        std::vector<std::vector<size_t>> successors;
+        std::vector<std::vector<size_t>> predecessors;
+        std::vector<size_t> order; // Reverse postorder
+        std::vector<size_t> idom; // The first block is its own
+        std::vector<std::vector<size_t>> children; // Dominator tree
+        std::vector<std::vector<size_t>> frontier;
+    };
+} // namespace opt
\ No newline at end of file
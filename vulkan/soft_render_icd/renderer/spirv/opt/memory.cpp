@@ -0,0 +1,286 @@
+#include "passes.hpp"
+#include "ir.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace opt {
+    namespace {
+        constexpr uint32_t max_split_members = 64;
+
+        bool is_function_variable(const Instruction& instruction){
+            return instruction.op == spv::Op::OpVariable && (spv::StorageClass)instruction.operands[0] == spv::StorageClass::Function;
+        }
+
+        // Pointer type to `pointee` in Function storage, created if the module has none
+        spv::Id function_pointer_type(SpirvJit& code, std::unordered_map<spv::Id, spv::Id>& cache, spv::Id pointee){
+            if(cache.empty()){
+                for(spv::Id id = 0; id < code.variables.size(); id++){
+                    const auto& var = code.variables[id];
+                    if(var.type == SpirvJit::Var::Type::Type && var.type_var.type == SpirvJit::Var::TypeVar::Type::Pointer && var.type_var.pointer.storage == spv::StorageClass::Function)
+                        cache.emplace(var.type_var.pointer.type, id);
+                }
+            }
+
+            if(auto it = cache.find(pointee); it != cache.end())
+                return it->second;
+
+            auto id = new_id(code);
+            auto& var = code.variables[id];
+            var.type = SpirvJit::Var::Type::Type;
+            var.type_var.type = SpirvJit::Var::TypeVar::Type::Pointer;
+            var.type_var.pointer.storage = spv::StorageClass::Function;
+            var.type_var.pointer.type = pointee;
+            cache.emplace(pointee, id);
+            return id;
+        }
+
+        struct Variable {
+            spv::Id type; // Pointee
+            bool has_initializer;
+            bool whole = true; // Only loaded and stored as a whole
+            bool splittable = true; // Loaded and stored as a whole, or reached through access chains with a constant first index
+        };
+
+        // Function variables of `function` and how they are used
+        std::unordered_map<spv::Id, Variable> function_variables(const SpirvJit& code, const Function& function){
+            std::unordered_map<spv::Id, Variable> variables;
+            for(const auto& block : function.blocks){
+                for(const auto& instruction : block.instructions){
+                    if(is_function_variable(instruction))
+                        variables.emplace(instruction.result, Variable{pointee_type(code, instruction.type), instruction.operands.size() > 1});
+                }
+            }
+
+            for(const auto& block : function.blocks){
+                for(const auto& instruction : block.instructions){
+                    for(size_t i = 0; i < instruction.operands.size(); i++){
+                        if(!is_id_operand(instruction.op, i))
+                            continue;
+
+                        auto it = variables.find(instruction.operands[i]);
+                        if(it == variables.end())
+                            continue;
+
+                        bool access = (instruction.op == spv::Op::OpLoad || instruction.op == spv::Op::OpStore) && i == 0;
+                        bool chain = (instruction.op == spv::Op::OpAccessChain || instruction.op == spv::Op::OpInBoundsAccessChain) && i == 0 &&
+                            instruction.operands.size() > 1 && is_constant(code, instruction.operands[1]) &&
+                            code.variables[instruction.operands[1]].constant.unsigned_int < member_count(code, it->second.type);
+
+                        if(!access)
+                            it->second.whole = false;
+                        if(!access && !chain)
+                            it->second.splittable = false;
+                    }
+                }
+            }
+
+            return variables;
+        }
+    } // namespace
+
+    bool replace_scalars(SpirvJit& code){
+        bool changed = false;
+        std::unordered_map<spv::Id, spv::Id> pointer_types;
+
+        for(auto& function : code.functions){
+            // Variables only used as a whole are left to forward_memory
+            struct Split {
+                spv::Id type;
+                std::vector<spv::Id> members;
+            };
+
+            std::unordered_map<spv::Id, Split> splits;
+            for(const auto& [id, variable] : function_variables(code, function)){
+                auto count = member_count(code, variable.type);
+                if(variable.whole || !variable.splittable || variable.has_initializer || count == 0 || count > max_split_members)
+                    continue;
+
+                auto& split = splits[id];
+                split.type = variable.type;
+                for(uint32_t m = 0; m < count; m++)
+                    split.members.push_back(new_id(code));
+            }
+
+            if(splits.empty())
+                continue;
+            changed = true;
+
+            std::unordered_map<spv::Id, spv::Id> replacements;
+            for(auto& block : function.blocks){
+                std::vector<Instruction> instructions;
+                for(auto& instruction : block.instructions){
+                    auto& ops = instruction.operands;
+                    auto split = splits.end();
+                    if(instruction.op == spv::Op::OpVariable)
+                        split = splits.find(instruction.result);
+                    else if(instruction.op == spv::Op::OpLoad || instruction.op == spv::Op::OpStore || instruction.op == spv::Op::OpAccessChain || instruction.op == spv::Op::OpInBoundsAccessChain)
+                        split = splits.find(ops[0]);
+
+                    if(split == splits.end()){
+                        instructions.push_back(std::move(instruction));
+                        continue;
+                    }
+
+                    auto type = split->second.type;
+                    const auto& ids = split->second.members;
+                    switch (instruction.op) {
+                        case spv::Op::OpVariable: {
+                            for(uint32_t m = 0; m < ids.size(); m++){
+                                auto pointer = function_pointer_type(code, pointer_types, member_type(code, type, m));
+                                instructions.push_back(Instruction{spv::Op::OpVariable, pointer, ids[m], {(uint32_t)spv::StorageClass::Function}});
+                            }
+                            break;
+                        }
+                        case spv::Op::OpAccessChain:
+                        case spv::Op::OpInBoundsAccessChain: {
+                            auto member = ids.at(code.variables[ops[1]].constant.unsigned_int);
+                            if(ops.size() == 2){
+                                replacements[instruction.result] = member;
+                            } else {
+                                ops.erase(ops.begin());
+                                ops[0] = member;
+                                instructions.push_back(std::move(instruction));
+                            }
+                            break;
+                        }
+                        case spv::Op::OpLoad: {
+                            Instruction construct{spv::Op::OpCompositeConstruct, instruction.type, instruction.result, {}};
+                            for(uint32_t m = 0; m < ids.size(); m++){
+                                auto value = new_id(code);
+                                instructions.push_back(Instruction{spv::Op::OpLoad, member_type(code, type, m), value, {ids[m]}});
+                                construct.operands.push_back(value);
+                            }
+                            instructions.push_back(std::move(construct));
+                            break;
+                        }
+                        case spv::Op::OpStore: {
+                            for(uint32_t m = 0; m < ids.size(); m++){
+                                auto value = new_id(code);
+                                instructions.push_back(Instruction{spv::Op::OpCompositeExtract, member_type(code, type, m), value, {ops[1], m}});
+                                instructions.push_back(Instruction{spv::Op::OpStore, 0, 0, {ids[m], value}});
+                            }
+                            break;
+                        }
+                        default:
+                            break;
+                    }
+                }
+                block.instructions = std::move(instructions);
+            }
+
+            replace_uses(function, replacements);
+        }
+
+        return changed;
+    }
+
+    bool forward_memory(SpirvJit& code){
+        bool changed = false;
+
+        for(auto& function : code.functions){
+            std::unordered_map<spv::Id, Variable> promoted;
+            for(const auto& [id, variable] : function_variables(code, function)){
+                if(variable.whole)
+                    promoted.emplace(id, variable);
+            }
+
+            if(promoted.empty())
+                continue;
+            changed = true;
+
+            Cfg cfg{function};
+            auto n = function.blocks.size();
+
+            // What a load sees before any store, and the blocks with stores to each variable
+            std::unordered_map<spv::Id, spv::Id> initial;
+            std::vector<Instruction> undefs;
+            std::unordered_map<spv::Id, std::vector<size_t>> stores;
+            for(size_t b = 0; b < n; b++){
+                for(const auto& instruction : function.blocks[b].instructions){
+                    if(instruction.op == spv::Op::OpVariable && promoted.count(instruction.result)){
+                        if(instruction.operands.size() > 1){
+                            initial[instruction.result] = instruction.operands[1];
+                        } else {
+                            undefs.push_back(Instruction{spv::Op::OpUndef, promoted.at(instruction.result).type, new_id(code), {}});
+                            initial[instruction.result] = undefs.back().result;
+                        }
+                    } else if(instruction.op == spv::Op::OpStore && promoted.count(instruction.operands[0]) && cfg.reachable(b)){
+                        stores[instruction.operands[0]].push_back(b);
+                    }
+                }
+            }
+
+            // Phis on the iterated dominance frontier of the stores
+            std::vector<std::vector<std::pair<spv::Id, Instruction>>> phis(n); // Variable and its phi
+            for(auto& [id, blocks] : stores){
+                std::vector<bool> has_phi(n, false);
+                std::vector<bool> queued(n, false);
+                for(auto b : blocks)
+                    queued[b] = true;
+
+                for(size_t next = 0; next < blocks.size(); next++){
+                    for(auto f : cfg.frontier[blocks[next]]){
+                        if(has_phi[f])
+                            continue;
+                        has_phi[f] = true;
+                        phis[f].emplace_back(id, Instruction{spv::Op::OpPhi, promoted.at(id).type, new_id(code), {}});
+                        if(!queued[f]){
+                            queued[f] = true;
+                            blocks.push_back(f);
+                        }
+                    }
+                }
+            }
+
+            // Values flow down the dominator tree, each block sees the last store of the blocks dominating it
+            std::unordered_map<spv::Id, spv::Id> replacements;
+            std::function<void(size_t, std::unordered_map<spv::Id, spv::Id>)> rename = [&](size_t b, std::unordered_map<spv::Id, spv::Id> current){
+                for(const auto& [id, phi] : phis[b])
+                    current[id] = phi.result;
+
+                for(const auto& instruction : function.blocks[b].instructions){
+                    if(instruction.op == spv::Op::OpLoad && promoted.count(instruction.operands[0]))
+                        replacements[instruction.result] = current.at(instruction.operands[0]);
+                    else if(instruction.op == spv::Op::OpStore && promoted.count(instruction.operands[0]))
+                        current[instruction.operands[0]] = instruction.operands[1];
+                }
+
+                for(auto s : cfg.successors[b]){
+                    for(auto& [id, phi] : phis[s])
+                        phi.operands.insert(phi.operands.end(), {current.at(id), function.blocks[b].label});
+                }
+
+                for(auto child : cfg.children[b])
+                    rename(child, current);
+            };
+            if(n > 0)
+                rename(0, initial);
+
+            for(size_t b = 0; b < n; b++){
+                auto& block = function.blocks[b];
+                std::vector<Instruction> instructions;
+                for(auto& [id, phi] : phis[b])
+                    instructions.push_back(std::move(phi));
+
+                for(auto& instruction : block.instructions){
+                    bool access = (instruction.op == spv::Op::OpLoad || instruction.op == spv::Op::OpStore) && promoted.count(instruction.operands[0]);
+                    if(access && instruction.op == spv::Op::OpLoad && !cfg.reachable(b))
+                        replacements[instruction.result] = initial.at(instruction.operands[0]);
+                    if(!access && !(instruction.op == spv::Op::OpVariable && promoted.count(instruction.result)))
+                        instructions.push_back(std::move(instruction));
+                }
+                block.instructions = std::move(instructions);
+            }
+
+            // Undefined initial values go after the variables that have to start the first block
+            auto& first = function.blocks.front().instructions;
+            auto position = std::find_if(first.begin(), first.end(), [](const Instruction& instruction){ return instruction.op != spv::Op::OpVariable; });
+            first.insert(position, std::make_move_iterator(undefs.begin()), std::make_move_iterator(undefs.end()));
+
+            replace_uses(function, replacements);
+        }
+
+        return changed;
+    }
+} // namespace opt
\ No newline at end of file
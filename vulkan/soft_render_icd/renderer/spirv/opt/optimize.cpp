@@ -0,0 +1,23 @@
+#include "passes.hpp"
+
+namespace opt {
+    namespace {
+        // Each round mostly cleans up after the one before, shaders settle after a few
+        constexpr int max_rounds = 8;
+    } // namespace
+
+    void optimize(SpirvJit& code){
+        inline_calls(code);
+
+        for(int round = 0; round < max_rounds; round++){
+            bool changed = replace_scalars(code);
+            changed |= forward_memory(code);
+            changed |= fold_constants(code);
+            changed |= eliminate_common_subexpressions(code);
+            changed |= eliminate_dead_code(code);
+
+            if(!changed)
+                break;
+        }
+    }
+} // namespace opt
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../jit.hpp"
+
+// Cleanups between parsing and code generation. glslang emits every local as a Function variable, keeps every call and folds nothing,
+// each pass works on all function bodies of the module and returns whether it changed anything
+namespace opt {
+    // Copies callees into their callers. Callee locals move to the caller's first block, and return values become phis
+    bool inline_calls(SpirvJit& code);
+
+    // Splits Function variables of composite type into one variable per member, when every access uses a constant first index
+    bool replace_scalars(SpirvJit& code);
+
+    // Turns Function variables that are only loaded and stored as a whole into SSA values, with phis where stores meet
+    bool forward_memory(SpirvJit& code);
+
+    // Evaluates instructions with constant operands the same way the backends would, and simplifies extracts of constructs and trivial phis
+    bool fold_constants(SpirvJit& code);
+
+    // Reuses equal pure instructions that dominate each other
+    bool eliminate_common_subexpressions(SpirvJit& code);
+
+    // Removes unreachable blocks, unused pure instructions and variables that are never read
+    bool eliminate_dead_code(SpirvJit& code);
+
+    // Inlines, then runs the other passes until nothing changes anymore
+    void optimize(SpirvJit& code);
+} // namespace opt
\ No newline at end of file
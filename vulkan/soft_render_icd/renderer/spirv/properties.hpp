@@ -0,0 +1,9 @@
+#pragma once
+
+// What an entry point does besides computing its outputs. For fragment shaders this decides whether the per fragment tests may run before it
+struct EntryPointProperties {
+    bool discards = false; // OpKill or OpDemoteToHelperInvocation
+    bool writes_depth = false; // Stores to the FragDepth built-in, or the DepthReplacing execution mode
+    bool side_effects = false; // Stores to buffers or images, image writes and atomics
+    bool early_fragment_tests = false; // EarlyFragmentTests execution mode, the tests run first whatever the shader does
+};
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "type_info.hpp"
+
+uint32_t type_words(const SpirvJit& code, spv::Id type){
+    const auto& var = code.variables[type].type_var;
+    switch (var.type) {
+        case SpirvJit::Var::TypeVar::Type::Void:
+            return 0;
+        case SpirvJit::Var::TypeVar::Type::Bool:
+        case SpirvJit::Var::TypeVar::Type::Pointer:
+            return 1;
+        case SpirvJit::Var::TypeVar::Type::SInt:
+        case SpirvJit::Var::TypeVar::Type::UInt:
+        case SpirvJit::Var::TypeVar::Type::Float:
+            if(var.real.width != 32)
+                throw std::runtime_error("JIT: Only 32 bit scalars are supported"); // TODO: 16 and 64 bit types
+            return 1;
+        case SpirvJit::Var::TypeVar::Type::Vector:
+        case SpirvJit::Var::TypeVar::Type::Array:
+        case SpirvJit::Var::TypeVar::Type::Matrix:
+            return (uint32_t)var.composite.n * type_words(code, var.composite.member_type);
+        case SpirvJit::Var::TypeVar::Type::Struct: {
+            uint32_t total = 0;
+            for(auto member : code.variables[type].interface)
+                total += type_words(code, member);
+            return total;
+        }
+        default:
+            throw std::runtime_error("JIT: Type has no size");
+    }
+}
+
+bool is_pointer_type(const SpirvJit& code, spv::Id type){
+    return code.variables[type].type_var.type == SpirvJit::Var::TypeVar::Type::Pointer;
+}
+
+spv::Id pointee_type(const SpirvJit& code, spv::Id pointer_type){
+    assert(is_pointer_type(code, pointer_type));
+    return code.variables[pointer_type].type_var.pointer.type;
+}
+
+ScalarKind scalar_kind(const SpirvJit& code, spv::Id type){
+    const auto& var = code.variables[type].type_var;
+    switch (var.type) {
+        case SpirvJit::Var::TypeVar::Type::Bool: return ScalarKind::Bool;
+        case SpirvJit::Var::TypeVar::Type::SInt: return ScalarKind::SInt;
+        case SpirvJit::Var::TypeVar::Type::UInt: return ScalarKind::UInt;
+        case SpirvJit::Var::TypeVar::Type::Float: return ScalarKind::Float;
+        case SpirvJit::Var::TypeVar::Type::Vector:
+        case SpirvJit::Var::TypeVar::Type::Array:
+        case SpirvJit::Var::TypeVar::Type::Matrix:
+            return scalar_kind(code, var.composite.member_type);
+        default:
+            throw std::runtime_error("JIT: Type has no scalar kind");
+    }
+}
+
+uint32_t type_components(const SpirvJit& code, spv::Id type){
+    const auto& var = code.variables[type].type_var;
+    return (var.type == SpirvJit::Var::TypeVar::Type::Vector) ? (uint32_t)var.composite.n : 1;
+}
+
+spv::Id member_type(const SpirvJit& code, spv::Id type, uint32_t index){
+    const auto& var = code.variables[type];
+    if(var.type_var.type == SpirvJit::Var::TypeVar::Type::Struct)
+        return var.interface.at(index);
+
+    return var.type_var.composite.member_type;
+}
+
+uint32_t member_offset(const SpirvJit& code, spv::Id type, uint32_t index){
+    const auto& var = code.variables[type];
+    if(var.type_var.type == SpirvJit::Var::TypeVar::Type::Struct){
+        uint32_t offset = 0;
+        for(uint32_t i = 0; i < index; i++)
+            offset += type_words(code, var.interface.at(i));
+        return offset;
+    }
+
+    return index * type_words(code, var.type_var.composite.member_type);
+}
+
+uint32_t member_count(const SpirvJit& code, spv::Id type){
+    const auto& var = code.variables[type];
+    switch (var.type_var.type) {
+        case SpirvJit::Var::TypeVar::Type::Struct:
+            return (uint32_t)var.interface.size();
+        case SpirvJit::Var::TypeVar::Type::Vector:
+        case SpirvJit::Var::TypeVar::Type::Array:
+        case SpirvJit::Var::TypeVar::Type::Matrix:
+            return (uint32_t)var.type_var.composite.n;
+        default:
+            return 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "jit.hpp"
+
+#include <cstdint>
+
+enum class ScalarKind { Float, SInt, UInt, Bool };
+
+// Sizes and members of types in 32 bit words, shared by the frame layout and the optimizer. Only 32 bit scalars are supported
+uint32_t type_words(const SpirvJit& code, spv::Id type);
+bool is_pointer_type(const SpirvJit& code, spv::Id type);
+spv::Id pointee_type(const SpirvJit& code, spv::Id pointer_type);
+ScalarKind scalar_kind(const SpirvJit& code, spv::Id type); // Of the innermost member
+uint32_t type_components(const SpirvJit& code, spv::Id type); // 1 for scalars
+spv::Id member_type(const SpirvJit& code, spv::Id type, uint32_t index);
+uint32_t member_offset(const SpirvJit& code, spv::Id type, uint32_t index);
+uint32_t member_count(const SpirvJit& code, spv::Id type); // 0 for scalars
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+class ThreadPool {
+    public:
+    ThreadPool(size_t n_threads = std::max(1u, std::thread::hardware_concurrency())) {
+        // The thread calling parallel_for() also does work, so spawn one less
+        for(size_t i = 1; i < n_threads; i++)
+            _workers.emplace_back([this]{ worker(); });
+    }
+
+    ~ThreadPool(){
+        {
+            std::lock_guard lock{_mutex};
+            _quit = true;
+        }
+        _wake.notify_all();
+
+        for(auto& worker : _workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t n_threads() const {
+        return _workers.size() + 1;
+    }
+
+    // Runs f(i) for every i in [0, n) on all threads, returns when every call has finished
+    template<typename F>
+    void parallel_for(size_t n, F&& f){
+        if(n == 0)
+            return;
+
+        auto batch = std::make_shared<Batch>();
+        batch->f = [&f](size_t i){ f(i); };
+        batch->n = n;
+
+        {
+            std::lock_guard lock{_mutex};
+            _batch = batch;
+            _generation++;
+        }
+        _wake.notify_all();
+
+        run(*batch);
+
+        std::unique_lock lock{_mutex};
+        _finished.wait(lock, [&batch]{ return batch->done == batch->n; });
+        _batch = nullptr;
+    }
+
+    private:
+    struct Batch {
+        std::function<void(size_t)> f;
+        size_t n;
+
+        std::atomic<size_t> next{0}, done{0};
+    };
+
+    void run(Batch& batch){
+        size_t i;
+        while((i = batch.next.fetch_add(1)) < batch.n){
+            batch.f(i);
+
+            if((batch.done.fetch_add(1) + 1) == batch.n){
+                std::lock_guard lock{_mutex};
+                _finished.notify_all();
+            }
+        }
+    }
+
+    void worker(){
+        uint64_t seen = 0;
+
+        std::unique_lock lock{_mutex};
+        while(true){
+            _wake.wait(lock, [this, &seen]{ return _quit || _generation != seen; });
+            if(_quit)
+                return;
+
+            seen = _generation;
+            auto batch = _batch; // Keep our own reference, a late worker must not touch the next batch
+            lock.unlock();
+
+            if(batch)
+                run(*batch);
+
+            lock.lock();
+        }
+    }
+
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _wake, _finished;
+
+    std::shared_ptr<Batch> _batch;
+    uint64_t _generation = 0;
+    bool _quit = false;
+};
+
+inline ThreadPool& render_thread_pool(){
+    static ThreadPool pool{};
+    return pool;
+}
\ No newline at end of file
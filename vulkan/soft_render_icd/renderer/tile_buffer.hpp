@@ -0,0 +1,273 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+#include "../../../vulkan-headers/include/vulkan/vulkan.h"
+
+#include "binner.hpp"
+#include "image.hpp"
+#include "hiz.hpp"
+#include "multisample.hpp"
+#include "render_pass.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+static_assert(HiZBuffer::tile_size == tile_size, "A tile's HiZ needs to cover exactly the tile");
+static_assert(Image::tile_size == tile_size, "Tiles need to line up with the tiles of images");
+
+// An attachment of the tile a thread is working on: `samples` planes of tile_size x tile_size texels, all supported formats are 32 bits.
+// Everything takes framebuffer coordinates within the tile
+class TileAttachment {
+    public:
+    void configure(uint32_t* texels, VkFormat format, uint32_t samples){
+        _texels = texels;
+        _format = format;
+        _samples = samples;
+        _compressible = (samples != VK_SAMPLE_COUNT_1_BIT) && !Image::format_is_depth(format);
+
+        if(Image::format_is_depth(format))
+            _hiz = HiZBuffer{tile_size, tile_size, samples};
+    }
+
+    // Moves the attachment to the tile whose top left pixel is (x0, y0)
+    void begin(int32_t x0, int32_t y0){
+        _x0 = x0;
+        _y0 = y0;
+    }
+
+    uint32_t* addr(int32_t x, int32_t y, uint32_t sample = 0){
+        return _texels + (sample * tile_size + (y - _y0)) * tile_size + (x - _x0);
+    }
+
+    uint32_t samples() const {
+        return _samples;
+    }
+
+    // Same as Image::compressed(), only multisampled colour is ever compressed
+    bool compressed(int32_t x, int32_t y) const {
+        return (_compressed[y - _y0] >> (x - _x0)) & 1;
+    }
+
+    void set_compressed(int32_t x, int32_t y){
+        _compressed[y - _y0] |= uint64_t{1} << (x - _x0);
+    }
+
+    void decompress(int32_t x, int32_t y){
+        if(!compressed(x, y))
+            return;
+
+        auto texel = *addr(x, y);
+        for(uint32_t s = 1; s < _samples; s++)
+            *addr(x, y, s) = texel;
+
+        _compressed[y - _y0] &= ~(uint64_t{1} << (x - _x0));
+    }
+
+    // Depth only
+    HiZBuffer::Range tile_range(){
+        return _hiz.tile_range(0, 0, (const float*)_texels);
+    }
+
+    HiZBuffer::Range block_range(int32_t x, int32_t y){
+        return _hiz.block_range(x - _x0, y - _y0, (const float*)_texels);
+    }
+
+    void mark_dirty(int32_t x, int32_t y){
+        _hiz.mark_dirty(x - _x0, y - _y0);
+    }
+
+    // Something other than a clear is about to write the attachment
+    void mark_written(){
+        _cleared = false;
+    }
+
+    // VK_ATTACHMENT_LOAD_OP_LOAD. Rows of compressed pixels only need sample 0, tiles the image only has marked as cleared aren't read at all
+    void load(Image& image, const VkRect2D& region){
+        assert(image.samples() == _samples && image.format() == _format);
+
+        uint32_t texel;
+        if(image.cleared(region.offset.x, region.offset.y, texel)){
+            clear(texel, region);
+            return;
+        }
+
+        auto columns = column_mask(region);
+        for(uint32_t row = 0; row < region.extent.height; row++){
+            int32_t x = region.offset.x, y = region.offset.y + row;
+
+            uint64_t compressed = _compressible ? image.compressed_bits(_x0, y) : 0;
+            _compressed[y - _y0] = compressed;
+
+            for(uint32_t s = 0; s < _samples; s++){
+                if(s > 0 && (compressed & columns) == columns)
+                    break;
+
+                image.read_row(x, y, s, addr(x, y, s), region.extent.width);
+            }
+        }
+
+        _cleared = false;
+        _hiz.invalidate();
+    }
+
+    // VK_ATTACHMENT_LOAD_OP_CLEAR, multisampled colour only clears sample 0 and compresses the pixels
+    void clear(uint32_t texel, const VkRect2D& region){
+        uint32_t planes = _compressible ? 1 : _samples;
+        for(uint32_t row = 0; row < region.extent.height; row++){
+            int32_t x = region.offset.x, y = region.offset.y + row;
+            _compressed[y - _y0] = ~uint64_t{0};
+
+            for(uint32_t s = 0; s < planes; s++)
+                std::fill(addr(x, y, s), addr(x, y, s) + region.extent.width, texel);
+        }
+
+        _cleared = true;
+        _clear_texel = texel;
+        _hiz.invalidate();
+    }
+
+    // VK_ATTACHMENT_LOAD_OP_DONT_CARE, nothing is read. The contents are undefined, sample 0 may as well stand for every sample
+    void discard(){
+        std::fill(std::begin(_compressed), std::end(_compressed), ~uint64_t{0});
+        _cleared = false;
+        _hiz.invalidate();
+    }
+
+    // VK_ATTACHMENT_STORE_OP_STORE. A tile that is still cleared and covers the image's whole clear tile only marks it as cleared
+    void store(Image& image, const VkRect2D& region){
+        auto tile = image.clear_tile_rect(region.offset.x, region.offset.y);
+        if(_cleared && tile.offset.x == region.offset.x && tile.offset.y == region.offset.y && tile.extent.width == region.extent.width && tile.extent.height == region.extent.height){
+            image.set_cleared(region.offset.x, region.offset.y, _clear_texel);
+            return;
+        }
+
+        image.prepare_write(region);
+        auto columns = column_mask(region);
+        for(uint32_t row = 0; row < region.extent.height; row++){
+            int32_t x = region.offset.x, y = region.offset.y + row;
+
+            uint64_t compressed = _compressible ? _compressed[y - _y0] : 0;
+            if(_compressible)
+                image.set_compressed_bits(_x0, y, compressed, columns);
+
+            for(uint32_t s = 0; s < _samples; s++){
+                if(s > 0 && (compressed & columns) == columns)
+                    break;
+
+                image.write_row(x, y, s, addr(x, y, s), region.extent.width);
+            }
+        }
+    }
+
+    // Subpass resolve into the single sampled `dst` of the same tile, compressed pixels are copied and the others averaged
+    void resolve(TileAttachment& dst, const VkRect2D& region){
+        assert(_compressible && dst._samples == VK_SAMPLE_COUNT_1_BIT);
+
+        if(_cleared){
+            dst.clear(_clear_texel, region);
+            return;
+        }
+        dst.mark_written();
+
+        auto resolve_run = select_resolve(_samples);
+        for(uint32_t row = 0; row < region.extent.height; row++){
+            int32_t y = region.offset.y + row;
+
+            for(int32_t x = region.offset.x; x < region.offset.x + (int32_t)region.extent.width;){
+                bool run_compressed = compressed(x, y);
+                int32_t end = x + 1;
+                while(end < region.offset.x + (int32_t)region.extent.width && compressed(end, y) == run_compressed)
+                    end++;
+
+                if(run_compressed)
+                    memcpy(dst.addr(x, y), addr(x, y), (end - x) * sizeof(uint32_t));
+                else
+                    resolve_run(addr(x, y), tile_size * tile_size, dst.addr(x, y), end - x);
+
+                x = end;
+            }
+        }
+    }
+
+    private:
+    // Bits of the pixels of `region` within a tile row
+    uint64_t column_mask(const VkRect2D& region) const {
+        uint64_t ones = (region.extent.width == 64) ? ~uint64_t{0} : (uint64_t{1} << region.extent.width) - 1;
+        return ones << (region.offset.x - _x0);
+    }
+
+    uint32_t* _texels = nullptr;
+    VkFormat _format = VK_FORMAT_UNDEFINED;
+    uint32_t _samples = 1;
+    bool _compressible = false;
+
+    int32_t _x0 = 0, _y0 = 0;
+
+    // Holds nothing but `_clear_texel` within the region of the tile
+    bool _cleared = false;
+    uint32_t _clear_texel = 0;
+
+    uint64_t _compressed[tile_size] = {};
+    HiZBuffer _hiz;
+};
+static_assert(tile_size <= 64, "Tile rows need to fit a 64-bit mask");
+
+// Every attachment of a render pass for a single tile. A thread keeps using its TileBuffer for all the tiles it works on,
+// so the attachments stay in L2 from the load at the start of the render pass to the store at its end: 4 colour attachments and depth are 80KB at 1x
+class TileBuffer {
+    public:
+    // Lays out the attachments of `render_pass`, reused as long as it stays the same render pass instance
+    void configure(const RenderPass& render_pass, uint64_t instance){
+        if(instance == _instance)
+            return;
+        _instance = instance;
+
+        size_t texels = 0;
+        for(size_t i = 0; i < render_pass.n_attachments(); i++)
+            texels += render_pass.attachment(i).samples * tile_size * tile_size;
+
+        _storage.resize(texels);
+        _attachments.resize(render_pass.n_attachments());
+
+        size_t offset = 0;
+        for(size_t i = 0; i < render_pass.n_attachments(); i++){
+            const auto& attachment = render_pass.attachment(i);
+            _attachments[i].configure(&_storage[offset], attachment.format, attachment.samples);
+
+            offset += attachment.samples * tile_size * tile_size;
+        }
+    }
+
+    TileAttachment& operator[](size_t i){
+        assert(i < _attachments.size());
+
+        return _attachments[i];
+    }
+
+    size_t n_attachments() const {
+        return _attachments.size();
+    }
+
+    private:
+    uint64_t _instance = 0;
+
+    std::vector<uint32_t> _storage;
+    std::vector<TileAttachment> _attachments;
+};
+
+constexpr size_t max_colour_attachments = 8;
+constexpr size_t max_input_attachments = 8;
+
+// The attachments of the current subpass within a TileBuffer, what draws of the subpass render to and read from
+struct TileTargets {
+    // By fragment shader output location, null where the subpass leaves a location unused
+    TileAttachment* colour[max_colour_attachments];
+    uint32_t n_colour;
+    TileAttachment* depth;
+
+    // Read straight from the tile by subpassLoad(), the fragment shader only ever reads its own pixel
+    TileAttachment* inputs[max_input_attachments];
+    uint32_t n_inputs;
+};
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+#include "../../../vulkan-headers/include/vulkan/vulkan.h"
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+// Post-transform vertex cache for indexed draws.
+// Index buffers are split into batches, within a batch every distinct vertex index is shaded once and all triangles
+// referencing it share the result. Lookups go through an open addressed table, stale entries of earlier batches are told apart by their generation
+class VertexCache {
+    public:
+    static constexpr size_t batch_size = 3 * 1024; // Indices per batch, whole triangles
+
+    struct Batch {
+        std::vector<uint32_t> vertices; // Distinct vertex indices in order of first use, these need to be shaded
+        std::vector<uint32_t> corners; // Per index of the batch, the position of its vertex in `vertices`
+    };
+
+    VertexCache(): _entries(table_size) {}
+
+    // `indices` points to `count` (<= batch_size) indices of type I, `vertex_offset` is added to each of them like vkCmdDrawIndexed does
+    template<typename I>
+    const Batch& assemble(const I* indices, size_t count, int32_t vertex_offset){
+        assert(count <= batch_size);
+
+        _generation++;
+        _batch.vertices.clear();
+        _batch.corners.resize(count);
+
+        for(size_t i = 0; i < count; i++){
+            uint32_t index = (uint32_t)((int64_t)indices[i] + vertex_offset);
+
+            for(size_t slot = hash(index);; slot = (slot + 1) & (table_size - 1)){
+                auto& entry = _entries[slot];
+                if(entry.generation != _generation){
+                    entry = Entry{index, (uint32_t)_batch.vertices.size(), _generation};
+                    _batch.vertices.push_back(index);
+                }
+
+                if(entry.index == index){
+                    _batch.corners[i] = entry.vertex;
+                    break;
+                }
+            }
+        }
+
+        return _batch;
+    }
+
+    private:
+    static constexpr size_t table_size = 8192; // Power of two
+    static_assert(table_size >= 2 * batch_size, "Keep the table at most half full");
+
+    static size_t hash(uint32_t index){
+        return (index * 0x9E3779B1u) >> (32 - __builtin_ctzll(table_size));
+    }
+
+    struct Entry {
+        uint32_t index;
+        uint32_t vertex;
+        uint64_t generation = 0;
+    };
+
+    std::vector<Entry> _entries;
+    uint64_t _generation = 0;
+
+    Batch _batch;
+};
\ No newline at end of file
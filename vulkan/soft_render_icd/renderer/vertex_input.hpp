@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../../../common/print.hpp"
+#include "core.hpp"
+#include "../../../vulkan-headers/include/vulkan/vulkan.h"
+
+#include "buffer.hpp"
+#include "interpolation.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+constexpr size_t max_vertex_attributes = 16;
+
+// Inputs and outputs of up to `lanes` vertices in structure of arrays layout, every component is an array over the lanes.
+// A shader instance can run across all lanes at once, without shuffling vertices in and out of registers
+struct VertexBatch {
+    static constexpr size_t lanes = 16;
+
+    uint32_t count;
+    alignas(64) uint32_t vertex_index[lanes];
+
+    alignas(64) float attributes[max_vertex_attributes][4][lanes]; // [location][component][lane]
+    alignas(64) float position[4][lanes]; // gl_Position
+    alignas(64) float outputs[max_varyings][4][lanes];
+};
+
+struct VertexBufferBinding {
+    Buffer* buffer;
+    VkDeviceSize offset;
+};
+
+struct VertexInput {
+    VertexInput() = default;
+    VertexInput(const VkPipelineVertexInputStateCreateInfo& info) {
+        assert(info.sType == VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO);
+        assert(info.flags == 0);
+
+        for(size_t i = 0; i < info.vertexBindingDescriptionCount; i++){
+            const auto& binding = info.pVertexBindingDescriptions[i];
+            assert(binding.inputRate == VK_VERTEX_INPUT_RATE_VERTEX); // TODO: Support Instancing
+
+            if(binding.binding >= _strides.size())
+                _strides.resize(binding.binding + 1);
+            _strides[binding.binding] = binding.stride;
+        }
+
+        for(size_t i = 0; i < info.vertexAttributeDescriptionCount; i++){
+            const auto& attribute = info.pVertexAttributeDescriptions[i];
+            assert(attribute.location < max_vertex_attributes);
+            assert(attribute.binding < _strides.size());
+
+            _attributes.push_back(Attribute{attribute.location, attribute.binding, attribute.offset, attribute.format, format_components(attribute.format)});
+        }
+    }
+
+    // Gathers the attributes of batch.vertex_index[0, batch.count) into batch.attributes, components the format doesn't have are (0, 0, 0, 1)
+    void fetch(const std::vector<VertexBufferBinding>& buffers, VertexBatch& batch) const {
+        for(const auto& attribute : _attributes){
+            assert(attribute.binding < buffers.size());
+            const auto& binding = buffers[attribute.binding];
+
+            const auto* base = (const uint8_t*)binding.buffer->addr(binding.offset + attribute.offset);
+            auto stride = _strides[attribute.binding];
+
+            auto& out = batch.attributes[attribute.location];
+            for(uint32_t c = 0; c < 4; c++){
+                if(c >= attribute.components){
+                    std::fill(out[c], out[c] + VertexBatch::lanes, (c == 3) ? 1.0f : 0.0f);
+                    continue;
+                }
+
+                for(uint32_t lane = 0; lane < batch.count; lane++){
+                    const auto* element = base + (size_t)batch.vertex_index[lane] * stride;
+
+                    if(attribute.format == VK_FORMAT_R8G8B8A8_UNORM)
+                        out[c][lane] = element[c] / 255.0f;
+                    else
+                        memcpy(&out[c][lane], element + c * sizeof(float), sizeof(float));
+                }
+            }
+        }
+    }
+
+    private:
+    static uint32_t format_components(VkFormat format){
+        switch (format) {
+            case VK_FORMAT_R32_SFLOAT: return 1;
+            case VK_FORMAT_R32G32_SFLOAT: return 2;
+            case VK_FORMAT_R32G32B32_SFLOAT: return 3;
+            case VK_FORMAT_R32G32B32A32_SFLOAT: return 4;
+            case VK_FORMAT_R8G8B8A8_UNORM: return 4;
+            default:
+                print("Granite/VertexInput: Unsupported vertex attribute format: {:d}\n", (uint32_t)format);
+                assert(!"Granite/VertexInput: Error");
+                return 0;
+        }
+    }
+
+    struct Attribute {
+        uint32_t location, binding, offset;
+        VkFormat format;
+        uint32_t components;
+    };
+
+    std::vector<uint32_t> _strides;
+    std::vector<Attribute> _attributes;
+};
\ No newline at end of file